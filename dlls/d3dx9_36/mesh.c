@@ -1221,6 +1221,172 @@ static int compare_vertex_keys(const void *a, const void *b)
     return left->key < right->key ? -1 : 1;
 }
 
+static int compare_dwords(const void *a, const void *b)
+{
+    const DWORD *left = a;
+    const DWORD *right = b;
+    if (*left == *right)
+        return 0;
+    return *left < *right ? -1 : 1;
+}
+
+/* Uniform grid used to find coincident vertices without comparing every
+ * vertex against every other one. Vertices are hashed into cells slightly
+ * larger than epsilon, so all vertices within epsilon of a given vertex are
+ * found in the 27 surrounding cells. For epsilon == 0 the cell is the exact
+ * position and only a single cell has to be searched. */
+struct vertex_grid
+{
+    const BYTE *vertices;
+    DWORD vertex_size;
+    float epsilon;
+    int range;
+    DWORD bucket_mask;
+    DWORD *buckets;
+    DWORD *next;
+    int (*cells)[3];
+};
+
+static void vertex_grid_get_cell(const struct vertex_grid *grid, const D3DXVECTOR3 *vertex, int cell[3])
+{
+    const float *coords = &vertex->x;
+    unsigned int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (grid->epsilon == 0.0f)
+        {
+            /* Adding 0.0f folds -0.0f into +0.0f, they compare equal. */
+            float value = coords[i] + 0.0f;
+            memcpy(&cell[i], &value, sizeof(value));
+        }
+        else
+        {
+            /* Clamping only makes distant cells share a bucket, the exact
+             * comparison is done by the caller. NaN ends up in the lowest cell. */
+            double value = floor(coords[i] / (grid->epsilon * 1.001));
+            if (!(value >= -1.0e9))
+                value = -1.0e9;
+            else if (value > 1.0e9)
+                value = 1.0e9;
+            cell[i] = (int)value;
+        }
+    }
+}
+
+static DWORD vertex_grid_hash(const struct vertex_grid *grid, const int cell[3])
+{
+    DWORD hash = (DWORD)cell[0] * 73856093u ^ (DWORD)cell[1] * 19349663u ^ (DWORD)cell[2] * 83492791u;
+
+    /* Exact cells are float bit patterns whose low bits are mostly zero, mix
+     * the high bits down before masking. */
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash & grid->bucket_mask;
+}
+
+static HRESULT vertex_grid_init(struct vertex_grid *grid, const BYTE *vertices,
+        DWORD vertex_count, DWORD vertex_size, float epsilon)
+{
+    DWORD bucket_count = 1;
+    DWORD i;
+
+    grid->vertices = vertices;
+    grid->vertex_size = vertex_size;
+    grid->epsilon = epsilon;
+    grid->range = epsilon == 0.0f ? 0 : 1;
+
+    while (bucket_count < vertex_count && bucket_count < 0x40000000)
+        bucket_count <<= 1;
+    grid->bucket_mask = bucket_count - 1;
+
+    grid->buckets = HeapAlloc(GetProcessHeap(), 0, bucket_count * sizeof(*grid->buckets));
+    grid->next = HeapAlloc(GetProcessHeap(), 0, vertex_count * sizeof(*grid->next));
+    grid->cells = HeapAlloc(GetProcessHeap(), 0, vertex_count * sizeof(*grid->cells));
+    if (!grid->buckets || !grid->next || !grid->cells)
+        return E_OUTOFMEMORY;
+
+    memset(grid->buckets, 0xff, bucket_count * sizeof(*grid->buckets));
+    for (i = 0; i < vertex_count; i++)
+    {
+        DWORD hash;
+
+        vertex_grid_get_cell(grid, (const D3DXVECTOR3 *)(vertices + i * vertex_size), grid->cells[i]);
+        hash = vertex_grid_hash(grid, grid->cells[i]);
+        grid->next[i] = grid->buckets[hash];
+        grid->buckets[hash] = i;
+    }
+
+    return D3D_OK;
+}
+
+static void vertex_grid_cleanup(struct vertex_grid *grid)
+{
+    HeapFree(GetProcessHeap(), 0, grid->buckets);
+    HeapFree(GetProcessHeap(), 0, grid->next);
+    HeapFree(GetProcessHeap(), 0, grid->cells);
+}
+
+/* Collects the sorted positions, greater than the position of vertex_index,
+ * of all vertices whose components are within epsilon of vertex_index. The
+ * result is returned in ascending order. */
+static HRESULT vertex_grid_find_coincident(const struct vertex_grid *grid, DWORD vertex_index,
+        const DWORD *sorted_position, DWORD **positions, DWORD *capacity, DWORD *count)
+{
+    const D3DXVECTOR3 *vertex_a = (const D3DXVECTOR3 *)(grid->vertices + vertex_index * grid->vertex_size);
+    const int *cell_a = grid->cells[vertex_index];
+    DWORD position_a = sorted_position[vertex_index];
+    int cell[3];
+    int x, y, z;
+
+    *count = 0;
+    for (x = -grid->range; x <= grid->range; x++)
+    for (y = -grid->range; y <= grid->range; y++)
+    for (z = -grid->range; z <= grid->range; z++)
+    {
+        DWORD vertex_b;
+
+        cell[0] = cell_a[0] + x;
+        cell[1] = cell_a[1] + y;
+        cell[2] = cell_a[2] + z;
+        for (vertex_b = grid->buckets[vertex_grid_hash(grid, cell)]; vertex_b != ~0u; vertex_b = grid->next[vertex_b])
+        {
+            const D3DXVECTOR3 *vertex = (const D3DXVECTOR3 *)(grid->vertices + vertex_b * grid->vertex_size);
+
+            if (sorted_position[vertex_b] <= position_a
+                    || memcmp(grid->cells[vertex_b], cell, sizeof(cell)))
+                continue;
+            if (!(fabsf(vertex_a->x - vertex->x) <= grid->epsilon
+                    && fabsf(vertex_a->y - vertex->y) <= grid->epsilon
+                    && fabsf(vertex_a->z - vertex->z) <= grid->epsilon))
+                continue;
+
+            if (*count == *capacity)
+            {
+                DWORD new_capacity = max(*capacity * 2, 16);
+                DWORD *new_positions;
+
+                if (!*positions)
+                    new_positions = HeapAlloc(GetProcessHeap(), 0, new_capacity * sizeof(**positions));
+                else
+                    new_positions = HeapReAlloc(GetProcessHeap(), 0, *positions, new_capacity * sizeof(**positions));
+                if (!new_positions)
+                    return E_OUTOFMEMORY;
+                *positions = new_positions;
+                *capacity = new_capacity;
+            }
+            (*positions)[(*count)++] = sorted_position[vertex_b];
+        }
+    }
+    if (*count > 1)
+        qsort(*positions, *count, sizeof(**positions), compare_dwords);
+
+    return D3D_OK;
+}
+
 static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsilon, DWORD *adjacency)
 {
     struct d3dx9_mesh *This = impl_from_ID3DXMesh(iface);
@@ -1229,11 +1395,18 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
     const DWORD *indices = NULL;
     DWORD vertex_size;
     DWORD buffer_size;
-    /* sort the vertices by (x + y + z) to quickly find coincident vertices */
+    /* sort the vertices by (x + y + z), this defines the order in which
+     * coincident vertices are matched */
     struct vertex_metadata *sorted_vertices;
     /* shared_indices links together identical indices in the index buffer so
      * that adjacency checks can be limited to faces sharing a vertex */
     DWORD *shared_indices = NULL;
+    /* coincident vertices are looked up in a spatial hash */
+    struct vertex_grid grid = {0};
+    DWORD *sorted_position = NULL;
+    DWORD *coincident = NULL;
+    DWORD coincident_capacity = 0;
+    DWORD coincident_count;
     const FLOAT epsilon_sq = epsilon * epsilon;
     DWORD i;
 
@@ -1278,13 +1451,30 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
     }
     qsort(sorted_vertices, This->numvertices, sizeof(*sorted_vertices), compare_vertex_keys);
 
+    if (epsilon >= 0.0f) {
+        if (!(sorted_position = HeapAlloc(GetProcessHeap(), 0, This->numvertices * sizeof(*sorted_position)))) {
+            hr = E_OUTOFMEMORY;
+            goto cleanup;
+        }
+        for (i = 0; i < This->numvertices; i++)
+            sorted_position[sorted_vertices[i].vertex_index] = i;
+        if (FAILED(hr = vertex_grid_init(&grid, vertices, This->numvertices, vertex_size, epsilon)))
+            goto cleanup;
+    }
+
     for (i = 0; i < This->numvertices; i++) {
         struct vertex_metadata *sorted_vertex_a = &sorted_vertices[i];
-        D3DXVECTOR3 *vertex_a = (D3DXVECTOR3*)(vertices + sorted_vertex_a->vertex_index * vertex_size);
         DWORD shared_index_a = sorted_vertex_a->first_shared_index;
 
+        coincident_count = 0;
+        if (shared_index_a != -1 && epsilon >= 0.0f) {
+            hr = vertex_grid_find_coincident(&grid, sorted_vertex_a->vertex_index, sorted_position,
+                    &coincident, &coincident_capacity, &coincident_count);
+            if (FAILED(hr)) goto cleanup;
+        }
+
         while (shared_index_a != -1) {
-            DWORD j = i;
+            DWORD j = 0;
             DWORD shared_index_b = shared_indices[shared_index_a];
             struct vertex_metadata *sorted_vertex_b = sorted_vertex_a;
 
@@ -1331,26 +1521,9 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
 
                     shared_index_b = shared_indices[shared_index_b];
                 }
-                while (++j < This->numvertices) {
-                    D3DXVECTOR3 *vertex_b;
-
-                    sorted_vertex_b++;
-                    if (sorted_vertex_b->key - sorted_vertex_a->key > epsilon * 3.0f) {
-                        /* no more coincident vertices to try */
-                        j = This->numvertices;
-                        break;
-                    }
-                    /* check for coincidence */
-                    vertex_b = (D3DXVECTOR3*)(vertices + sorted_vertex_b->vertex_index * vertex_size);
-                    if (fabsf(vertex_a->x - vertex_b->x) <= epsilon &&
-                        fabsf(vertex_a->y - vertex_b->y) <= epsilon &&
-                        fabsf(vertex_a->z - vertex_b->z) <= epsilon)
-                    {
-                        break;
-                    }
-                }
-                if (j >= This->numvertices)
+                if (j >= coincident_count)
                     break;
+                sorted_vertex_b = &sorted_vertices[coincident[j++]];
                 shared_index_b = sorted_vertex_b->first_shared_index;
             }
 
@@ -1363,6 +1536,9 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
 cleanup:
     if (indices) iface->lpVtbl->UnlockIndexBuffer(iface);
     if (vertices) iface->lpVtbl->UnlockVertexBuffer(iface);
+    vertex_grid_cleanup(&grid);
+    HeapFree(GetProcessHeap(), 0, coincident);
+    HeapFree(GetProcessHeap(), 0, sorted_position);
     HeapFree(GetProcessHeap(), 0, shared_indices);
     return hr;
 }
@@ -1640,6 +1816,383 @@ static HRESULT remap_faces_for_attrsort(struct d3dx9_mesh *This, const DWORD *in
     return D3D_OK;
 }
 
+/* Size of the simulated post-transform vertex cache used for face reordering. */
+#define VCACHE_SIZE 32
+
+struct vcache_vertex
+{
+    DWORD tri_start;
+    DWORD tri_count; /* triangles not yet emitted */
+    int cache_pos;
+    float score;
+};
+
+static float vcache_vertex_score(const float *cache_scores, const struct vcache_vertex *vertex)
+{
+    float score;
+
+    /* Vertices without remaining triangles must never attract new ones. */
+    if (!vertex->tri_count)
+        return -1.0f;
+
+    score = vertex->cache_pos < 0 ? 0.0f : cache_scores[vertex->cache_pos];
+    /* Boost vertices with few remaining triangles, so that they get finished
+     * off instead of leaving lone triangles behind. */
+    return score + 2.0f / sqrtf(vertex->tri_count);
+}
+
+/* Reorders the faces of a triangle list for a LRU post-transform vertex
+ * cache, using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+ * heuristic. The indices must be in the range [0, vertex_count). On return
+ * face_order contains the new face order as indices into the input. */
+static HRESULT optimize_faces_for_vcache(const DWORD *indices, DWORD face_count, DWORD vertex_count,
+        DWORD *face_order)
+{
+    float cache_scores[VCACHE_SIZE], *tri_scores = NULL;
+    DWORD cache[VCACHE_SIZE + 3], new_cache[VCACHE_SIZE + 3];
+    DWORD cache_count = 0, new_cache_count;
+    struct vcache_vertex *vertices = NULL;
+    DWORD *vertex_tris = NULL;
+    BYTE *tri_added = NULL;
+    DWORD best_tri, scan_pos = 0;
+    HRESULT hr = E_OUTOFMEMORY;
+    DWORD i, j, k, emitted;
+
+    if (!face_count)
+        return D3D_OK;
+
+    if (!(vertices = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, vertex_count * sizeof(*vertices)))
+            || !(vertex_tris = HeapAlloc(GetProcessHeap(), 0, face_count * 3 * sizeof(*vertex_tris)))
+            || !(tri_scores = HeapAlloc(GetProcessHeap(), 0, face_count * sizeof(*tri_scores)))
+            || !(tri_added = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, face_count * sizeof(*tri_added))))
+        goto done;
+
+    /* The three most recently used vertices are scored equally, since the
+     * triangle that used them was just drawn. */
+    for (i = 0; i < VCACHE_SIZE; ++i)
+    {
+        if (i < 3)
+            cache_scores[i] = 0.75f;
+        else
+            cache_scores[i] = powf(1.0f - (float)(i - 3) / (VCACHE_SIZE - 3), 1.5f);
+    }
+
+    for (i = 0; i < face_count * 3; ++i)
+        ++vertices[indices[i]].tri_count;
+    for (i = 0, j = 0; i < vertex_count; ++i)
+    {
+        vertices[i].tri_start = j;
+        j += vertices[i].tri_count;
+        vertices[i].tri_count = 0;
+        vertices[i].cache_pos = -1;
+    }
+    for (i = 0; i < face_count * 3; ++i)
+    {
+        struct vcache_vertex *vertex = &vertices[indices[i]];
+        vertex_tris[vertex->tri_start + vertex->tri_count++] = i / 3;
+    }
+    for (i = 0; i < vertex_count; ++i)
+        vertices[i].score = vcache_vertex_score(cache_scores, &vertices[i]);
+
+    best_tri = 0;
+    for (i = 0; i < face_count; ++i)
+    {
+        tri_scores[i] = vertices[indices[i * 3]].score + vertices[indices[i * 3 + 1]].score
+                + vertices[indices[i * 3 + 2]].score;
+        if (tri_scores[i] > tri_scores[best_tri])
+            best_tri = i;
+    }
+
+    for (emitted = 0; emitted < face_count; ++emitted)
+    {
+        float best_score;
+
+        if (best_tri == ~0u)
+        {
+            /* Nothing in the cache is connected to a remaining triangle.
+             * Restart from the next unused triangle in input order; a full
+             * rescan would make the algorithm quadratic. */
+            while (tri_added[scan_pos])
+                ++scan_pos;
+            best_tri = scan_pos;
+        }
+
+        face_order[emitted] = best_tri;
+        tri_added[best_tri] = 1;
+
+        /* Move the triangle's vertices to the front of the cache and remove
+         * the triangle from their lists of remaining triangles. */
+        new_cache_count = 0;
+        for (i = 0; i < 3; ++i)
+        {
+            DWORD index = indices[best_tri * 3 + i];
+            struct vcache_vertex *vertex = &vertices[index];
+            DWORD *tris = &vertex_tris[vertex->tri_start];
+
+            for (j = 0; j < vertex->tri_count; ++j)
+            {
+                if (tris[j] == best_tri)
+                {
+                    tris[j] = tris[--vertex->tri_count];
+                    break;
+                }
+            }
+
+            for (j = 0; j < new_cache_count; ++j)
+            {
+                if (new_cache[j] == index)
+                    break;
+            }
+            if (j == new_cache_count)
+                new_cache[new_cache_count++] = index;
+        }
+        for (i = 0; i < cache_count; ++i)
+        {
+            for (j = 0; j < new_cache_count; ++j)
+            {
+                if (new_cache[j] == cache[i])
+                    break;
+            }
+            if (j == new_cache_count)
+                new_cache[new_cache_count++] = cache[i];
+        }
+
+        /* Update the scores of everything that is or was in the cache and
+         * pick the best triangle connected to the cache. */
+        best_tri = ~0u;
+        best_score = -1.0f;
+        for (i = 0; i < new_cache_count; ++i)
+        {
+            struct vcache_vertex *vertex = &vertices[new_cache[i]];
+
+            vertex->cache_pos = i < VCACHE_SIZE ? i : -1;
+            vertex->score = vcache_vertex_score(cache_scores, vertex);
+        }
+        for (i = 0; i < new_cache_count; ++i)
+        {
+            const struct vcache_vertex *vertex = &vertices[new_cache[i]];
+            const DWORD *tris = &vertex_tris[vertex->tri_start];
+
+            for (j = 0; j < vertex->tri_count; ++j)
+            {
+                DWORD tri = tris[j];
+                float score = 0.0f;
+
+                for (k = 0; k < 3; ++k)
+                    score += vertices[indices[tri * 3 + k]].score;
+                tri_scores[tri] = score;
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best_tri = tri;
+                }
+            }
+        }
+
+        cache_count = min(new_cache_count, VCACHE_SIZE);
+        memcpy(cache, new_cache, cache_count * sizeof(*cache));
+    }
+
+    hr = D3D_OK;
+
+done:
+    HeapFree(GetProcessHeap(), 0, tri_added);
+    HeapFree(GetProcessHeap(), 0, tri_scores);
+    HeapFree(GetProcessHeap(), 0, vertex_tris);
+    HeapFree(GetProcessHeap(), 0, vertices);
+    return hr;
+}
+
+/* Reorders the faces of each attribute range for the vertex cache. face_remap
+ * holds the old -> new mapping produced by remap_faces_for_attrsort() and is
+ * updated in place. */
+static HRESULT remap_faces_for_vcache(const struct d3dx9_mesh *mesh, const DWORD *indices,
+        const DWORD *sorted_attrib_buffer, DWORD *face_remap)
+{
+    DWORD *face_order = NULL, *local_indices = NULL, *local_order = NULL, *vertex_map = NULL;
+    DWORD range_start, range_end, vertex_count, i;
+    HRESULT hr = E_OUTOFMEMORY;
+
+    if (!(face_order = HeapAlloc(GetProcessHeap(), 0, mesh->numfaces * sizeof(*face_order)))
+            || !(local_indices = HeapAlloc(GetProcessHeap(), 0, mesh->numfaces * 3 * sizeof(*local_indices)))
+            || !(local_order = HeapAlloc(GetProcessHeap(), 0, mesh->numfaces * sizeof(*local_order)))
+            || !(vertex_map = HeapAlloc(GetProcessHeap(), 0, mesh->numvertices * sizeof(*vertex_map))))
+        goto done;
+
+    for (i = 0; i < mesh->numfaces; ++i)
+        face_order[face_remap[i]] = i;
+    for (i = 0; i < mesh->numvertices; ++i)
+        vertex_map[i] = ~0u;
+
+    for (range_start = 0; range_start < mesh->numfaces; range_start = range_end)
+    {
+        for (range_end = range_start + 1; range_end < mesh->numfaces; ++range_end)
+        {
+            if (sorted_attrib_buffer[range_end] != sorted_attrib_buffer[range_start])
+                break;
+        }
+
+        /* Renumber the vertices of the range densely, so that the work done
+         * per range does not depend on the size of the whole mesh. */
+        vertex_count = 0;
+        for (i = 0; i < (range_end - range_start) * 3; ++i)
+        {
+            DWORD index = indices[face_order[range_start + i / 3] * 3 + i % 3];
+
+            if (vertex_map[index] == ~0u)
+                vertex_map[index] = vertex_count++;
+            local_indices[i] = vertex_map[index];
+        }
+        for (i = 0; i < (range_end - range_start) * 3; ++i)
+            vertex_map[indices[face_order[range_start + i / 3] * 3 + i % 3]] = ~0u;
+
+        if (FAILED(hr = optimize_faces_for_vcache(local_indices, range_end - range_start,
+                vertex_count, local_order)))
+            goto done;
+
+        for (i = 0; i < range_end - range_start; ++i)
+            face_remap[face_order[range_start + local_order[i]]] = range_start + i;
+    }
+
+    hr = D3D_OK;
+
+done:
+    HeapFree(GetProcessHeap(), 0, vertex_map);
+    HeapFree(GetProcessHeap(), 0, local_order);
+    HeapFree(GetProcessHeap(), 0, local_indices);
+    HeapFree(GetProcessHeap(), 0, face_order);
+    return hr;
+}
+
+/* Reorders the faces of each attribute range into long runs of adjacent
+ * faces, walking the adjacency information. */
+static HRESULT remap_faces_for_strips(const struct d3dx9_mesh *mesh, const DWORD *attrib_buffer,
+        const DWORD *adjacency, DWORD *face_remap)
+{
+    DWORD *face_order;
+    BYTE *visited;
+    DWORD i, next;
+
+    if (!(face_order = HeapAlloc(GetProcessHeap(), 0, mesh->numfaces * sizeof(*face_order))))
+        return E_OUTOFMEMORY;
+    if (!(visited = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, mesh->numfaces * sizeof(*visited))))
+    {
+        HeapFree(GetProcessHeap(), 0, face_order);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < mesh->numfaces; ++i)
+        face_order[face_remap[i]] = i;
+
+    /* Faces that have already been assigned keep their attribute range, since
+     * a walk never crosses into faces with a different attribute. */
+    next = 0;
+    for (i = 0; i < mesh->numfaces; ++i)
+    {
+        DWORD face = face_order[i];
+
+        while (!visited[face])
+        {
+            DWORD best_face = ~0u, best_count = ~0u;
+            DWORD j, k;
+
+            visited[face] = 1;
+            face_remap[face] = next++;
+
+            /* Continue with the neighbour that has the fewest remaining
+             * neighbours itself, so that the walk doesn't cut the remaining
+             * faces into isolated islands. */
+            for (j = 0; j < 3; ++j)
+            {
+                DWORD neighbor = adjacency[face * 3 + j], count = 0;
+
+                if (neighbor >= mesh->numfaces || visited[neighbor]
+                        || attrib_buffer[neighbor] != attrib_buffer[face])
+                    continue;
+
+                for (k = 0; k < 3; ++k)
+                {
+                    DWORD n = adjacency[neighbor * 3 + k];
+
+                    if (n < mesh->numfaces && !visited[n] && attrib_buffer[n] == attrib_buffer[neighbor])
+                        ++count;
+                }
+                if (count < best_count)
+                {
+                    best_count = count;
+                    best_face = neighbor;
+                }
+            }
+
+            if (best_face == ~0u)
+                break;
+            face = best_face;
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, visited);
+    HeapFree(GetProcessHeap(), 0, face_order);
+    return D3D_OK;
+}
+
+/* Reorders the vertices in the order they are first referenced by the faces
+ * in their new order, dropping unused vertices. This keeps vertex fetches
+ * sequential when the faces are drawn. */
+static HRESULT remap_vertices_by_first_use(struct d3dx9_mesh *mesh, DWORD *indices, const DWORD *face_remap,
+        DWORD *new_num_vertices, ID3DXBuffer **vertex_remap)
+{
+    DWORD *face_order, *vertex_remap_ptr, *new_index;
+    DWORD num_used_vertices = 0;
+    HRESULT hr;
+    DWORD i;
+
+    if (!(face_order = HeapAlloc(GetProcessHeap(), 0, mesh->numfaces * sizeof(*face_order))))
+        return E_OUTOFMEMORY;
+    if (!(new_index = HeapAlloc(GetProcessHeap(), 0, mesh->numvertices * sizeof(*new_index))))
+    {
+        HeapFree(GetProcessHeap(), 0, face_order);
+        return E_OUTOFMEMORY;
+    }
+
+    hr = D3DXCreateBuffer(mesh->numvertices * sizeof(DWORD), vertex_remap);
+    if (FAILED(hr))
+    {
+        HeapFree(GetProcessHeap(), 0, new_index);
+        HeapFree(GetProcessHeap(), 0, face_order);
+        return hr;
+    }
+    vertex_remap_ptr = ID3DXBuffer_GetBufferPointer(*vertex_remap);
+
+    for (i = 0; i < mesh->numfaces; ++i)
+        face_order[face_remap[i]] = i;
+    for (i = 0; i < mesh->numvertices; ++i)
+        new_index[i] = ~0u;
+
+    /* create new->old vertex mapping */
+    for (i = 0; i < mesh->numfaces * 3; ++i)
+    {
+        DWORD index = indices[face_order[i / 3] * 3 + i % 3];
+
+        if (new_index[index] == ~0u)
+        {
+            new_index[index] = num_used_vertices;
+            vertex_remap_ptr[num_used_vertices++] = index;
+        }
+    }
+    for (i = num_used_vertices; i < mesh->numvertices; ++i)
+        vertex_remap_ptr[i] = -1;
+
+    /* convert indices */
+    for (i = 0; i < mesh->numfaces * 3; ++i)
+        indices[i] = new_index[indices[i]];
+
+    *new_num_vertices = num_used_vertices;
+
+    HeapFree(GetProcessHeap(), 0, new_index);
+    HeapFree(GetProcessHeap(), 0, face_order);
+    return D3D_OK;
+}
+
 static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags, const DWORD *adjacency_in,
         DWORD *adjacency_out, DWORD *face_remap_out, ID3DXBuffer **vertex_remap_out)
 {
@@ -1654,7 +2207,7 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
     DWORD new_num_alloc_vertices = 0;
     IDirect3DVertexBuffer9 *vertex_buffer = NULL;
     DWORD *sorted_attrib_buffer = NULL;
-    DWORD i;
+    DWORD i, j;
 
     TRACE("iface %p, flags %#x, adjacency_in %p, adjacency_out %p, face_remap_out %p, vertex_remap_out %p.\n",
             iface, flags, adjacency_in, adjacency_out, face_remap_out, vertex_remap_out);
@@ -1666,15 +2219,6 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
     if ((flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) == (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
         return D3DERR_INVALIDCALL;
 
-    if (flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
-    {
-        if (flags & D3DXMESHOPT_VERTEXCACHE)
-            FIXME("D3DXMESHOPT_VERTEXCACHE not implemented.\n");
-        if (flags & D3DXMESHOPT_STRIPREORDER)
-            FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
-        return E_NOTIMPL;
-    }
-
     hr = iface->lpVtbl->LockIndexBuffer(iface, 0, &indices);
     if (FAILED(hr)) goto cleanup;
 
@@ -1688,13 +2232,14 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             dword_indices[i] = *word_indices++;
     }
 
-    if ((flags & (D3DXMESHOPT_COMPACT | D3DXMESHOPT_IGNOREVERTS | D3DXMESHOPT_ATTRSORT)) == D3DXMESHOPT_COMPACT)
+    if ((flags & (D3DXMESHOPT_COMPACT | D3DXMESHOPT_IGNOREVERTS | D3DXMESHOPT_ATTRSORT
+            | D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) == D3DXMESHOPT_COMPACT)
     {
         new_num_alloc_vertices = This->numvertices;
         hr = compact_mesh(This, dword_indices, &new_num_vertices, &vertex_remap);
         if (FAILED(hr)) goto cleanup;
-    } else if (flags & D3DXMESHOPT_ATTRSORT) {
-        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
+    } else if (flags & (D3DXMESHOPT_ATTRSORT | D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) {
+        if (!(flags & (D3DXMESHOPT_IGNOREVERTS | D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)))
         {
             FIXME("D3DXMESHOPT_ATTRSORT vertex reordering not implemented.\n");
             hr = E_NOTIMPL;
@@ -1704,8 +2249,23 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
         hr = iface->lpVtbl->LockAttributeBuffer(iface, 0, &attrib_buffer);
         if (FAILED(hr)) goto cleanup;
 
+        /* Vertex cache and strip reordering imply attribute sorting, faces
+         * are only reordered within their attribute range. */
         hr = remap_faces_for_attrsort(This, dword_indices, attrib_buffer, &sorted_attrib_buffer, &face_remap);
         if (FAILED(hr)) goto cleanup;
+
+        if (flags & D3DXMESHOPT_VERTEXCACHE)
+            hr = remap_faces_for_vcache(This, dword_indices, sorted_attrib_buffer, face_remap);
+        else if (flags & D3DXMESHOPT_STRIPREORDER)
+            hr = remap_faces_for_strips(This, attrib_buffer, adjacency_in, face_remap);
+        if (FAILED(hr)) goto cleanup;
+
+        if ((flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) && !(flags & D3DXMESHOPT_IGNOREVERTS))
+        {
+            new_num_alloc_vertices = This->numvertices;
+            hr = remap_vertices_by_first_use(This, dword_indices, face_remap, &new_num_vertices, &vertex_remap);
+            if (FAILED(hr)) goto cleanup;
+        }
     }
 
     if (vertex_remap)
@@ -1748,7 +2308,7 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             *vertex_remap_ptr++ = i;
     }
 
-    if (flags & D3DXMESHOPT_ATTRSORT)
+    if (face_remap)
     {
         D3DXATTRIBUTERANGE *attrib_table;
         DWORD attrib_table_size;
@@ -1798,9 +2358,11 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             for (i = 0; i < This->numfaces; i++) {
                 DWORD old_pos = i * 3;
                 DWORD new_pos = face_remap[i] * 3;
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
+                for (j = 0; j < 3; j++, old_pos++, new_pos++) {
+                    /* edges without a neighbour are marked with ~0u */
+                    DWORD face = adjacency_in[old_pos];
+                    adjacency_out[new_pos] = face == ~0u ? ~0u : face_remap[face];
+                }
             }
         } else {
             memcpy(adjacency_out, adjacency_in, This->numfaces * 3 * sizeof(*adjacency_out));
@@ -7249,6 +7811,79 @@ error:
     return hr;
 }
 
+/*************************************************************************
+ * D3DXOptimizeVertices    (D3DX9_36.@)
+ *
+ * Generates a vertex remap that places the vertices in the order they are
+ * first referenced by the faces.
+ *
+ * PARAMS
+ *   indices           [I] Pointer to an index buffer belonging to a mesh.
+ *   num_faces         [I] Number of faces in the mesh.
+ *   num_vertices      [I] Number of vertices in the mesh.
+ *   indices_are_32bit [I] Specifies whether indices are 32- or 16-bit.
+ *   vertex_remap      [O] For each new vertex position, the old vertex index.
+ *
+ * RETURNS
+ *   Success: D3D_OK.
+ *   Failure: D3DERR_INVALIDCALL.
+ *
+ * NOTES
+ *   Vertices that are not referenced by any face are placed at the end, in
+ *   their original order.
+ */
+HRESULT WINAPI D3DXOptimizeVertices(const void *indices, UINT num_faces,
+        UINT num_vertices, BOOL indices_are_32bit, DWORD *vertex_remap)
+{
+    UINT limit_16_bit = 2 << 15; /* According to MSDN */
+    UINT num_used_vertices = 0;
+    BYTE *used;
+    UINT i;
+
+    TRACE("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, vertex_remap %p.\n",
+            indices, num_faces, num_vertices, indices_are_32bit, vertex_remap);
+
+    if (!indices_are_32bit && num_faces >= limit_16_bit)
+    {
+        WARN("Number of faces must be less than %d when using 16-bit indices.\n",
+             limit_16_bit);
+        return D3DERR_INVALIDCALL;
+    }
+
+    if (!indices || !vertex_remap)
+    {
+        WARN("Invalid index buffer or vertex remap pointer.\n");
+        return D3DERR_INVALIDCALL;
+    }
+
+    if (!(used = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_vertices)))
+        return E_OUTOFMEMORY;
+
+    for (i = 0; i < num_faces * 3; i++)
+    {
+        DWORD index = indices_are_32bit ? ((const DWORD *)indices)[i] : ((const WORD *)indices)[i];
+
+        if (index >= num_vertices)
+        {
+            WARN("Index %u at position %u is out of range.\n", index, i);
+            HeapFree(GetProcessHeap(), 0, used);
+            return D3DERR_INVALIDCALL;
+        }
+        if (used[index])
+            continue;
+        used[index] = 1;
+        vertex_remap[num_used_vertices++] = index;
+    }
+    for (i = 0; i < num_vertices; i++)
+    {
+        if (!used[i])
+            vertex_remap[num_used_vertices++] = i;
+    }
+
+    HeapFree(GetProcessHeap(), 0, used);
+    return D3D_OK;
+}
+
 static D3DXVECTOR3 *vertex_element_vec3(BYTE *vertices, const D3DVERTEXELEMENT9 *declaration,
         DWORD vertex_stride, DWORD index)
 {
@@ -206,6 +206,14 @@ struct d3dx_pres_ins
     struct d3dx_pres_operand output;
 };
 
+struct d3dx_pres_output
+{
+    enum pres_reg_tables table;
+    unsigned int offset;
+    /* All the output tables have 32 bit components. */
+    DWORD value;
+};
+
 static unsigned int get_reg_offset(unsigned int table, unsigned int offset)
 {
     return offset / table_info[table].reg_component_count;
@@ -214,6 +222,7 @@ static unsigned int get_reg_offset(unsigned int table, unsigned int offset)
 #define PRES_BITMASK_BLOCK_SIZE (sizeof(unsigned int) * 8)
 
 static HRESULT init_set_constants(struct d3dx_const_tab *const_tab, ID3DXConstantTable *ctab);
+static HRESULT execute_preshader(struct d3dx_preshader *pres, unsigned int start, unsigned int end);
 
 static HRESULT regstore_alloc_table(struct d3dx_regstore *rs, unsigned int table)
 {
@@ -620,6 +629,172 @@ static void dump_preshader(struct d3dx_preshader *pres)
         dump_ins(&pres->regs, &pres->ins[i]);
 }
 
+static unsigned int get_ins_input_comp(const struct d3dx_pres_ins *ins, unsigned int input, unsigned int comp)
+{
+    return ins->scalar_op && !input ? 0 : comp;
+}
+
+static unsigned int get_ins_output_count(const struct d3dx_pres_ins *ins)
+{
+    return pres_op_info[ins->op].func_all_comps ? 1 : ins->component_count;
+}
+
+enum pres_ins_state
+{
+    PRES_INS_DEAD,
+    PRES_INS_RUN,
+    PRES_INS_FOLDED,
+};
+
+/* Removes the instructions whose results are never used, and moves the
+ * instructions only depending on literals in front, so that they are
+ * evaluated once instead of on every execution. A temporary register
+ * component is only considered constant if it is written exactly once. */
+static HRESULT optimize_preshader(struct d3dx_preshader *pres)
+{
+    unsigned int temp_count = pres->regs.table_sizes[PRES_REGTAB_TEMP]
+            * table_info[PRES_REGTAB_TEMP].reg_component_count;
+    unsigned int i, j, k, run_count, folded_count, output_count;
+    struct d3dx_pres_ins *ins, *new_ins;
+    BYTE *live, *write_count, *folded, *state;
+    HRESULT hr = D3D_OK;
+
+    if (!pres->ins_count)
+        return D3D_OK;
+
+    live = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, temp_count * 3 + pres->ins_count);
+    new_ins = HeapAlloc(GetProcessHeap(), 0, sizeof(*new_ins) * pres->ins_count);
+    if (!live || !new_ins)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+    write_count = live + temp_count;
+    folded = write_count + temp_count;
+    state = folded + temp_count;
+
+    for (i = pres->ins_count; i--;)
+    {
+        ins = &pres->ins[i];
+        output_count = get_ins_output_count(ins);
+
+        state[i] = PRES_INS_DEAD;
+        if (ins->output.table != PRES_REGTAB_TEMP)
+            state[i] = PRES_INS_RUN;
+        for (j = 0; j < output_count && state[i] == PRES_INS_DEAD; ++j)
+            if (live[ins->output.offset + j])
+                state[i] = PRES_INS_RUN;
+        if (state[i] == PRES_INS_DEAD)
+            continue;
+
+        if (ins->output.table == PRES_REGTAB_TEMP)
+            for (j = 0; j < output_count; ++j)
+                live[ins->output.offset + j] = 0;
+        for (k = 0; k < pres_op_info[ins->op].input_count; ++k)
+        {
+            if (ins->inputs[k].table != PRES_REGTAB_TEMP)
+                continue;
+            for (j = 0; j < ins->component_count; ++j)
+                live[ins->inputs[k].offset + get_ins_input_comp(ins, k, j)] = 1;
+        }
+    }
+
+    for (i = 0; i < pres->ins_count; ++i)
+    {
+        ins = &pres->ins[i];
+        if (state[i] == PRES_INS_DEAD || ins->output.table != PRES_REGTAB_TEMP)
+            continue;
+        for (j = 0; j < get_ins_output_count(ins); ++j)
+            write_count[ins->output.offset + j] = min(write_count[ins->output.offset + j] + 1, 2);
+    }
+
+    for (i = 0; i < pres->ins_count; ++i)
+    {
+        BOOL constant = TRUE;
+
+        ins = &pres->ins[i];
+        if (state[i] == PRES_INS_DEAD || ins->output.table != PRES_REGTAB_TEMP)
+            continue;
+        output_count = get_ins_output_count(ins);
+        for (j = 0; j < output_count && constant; ++j)
+            constant = write_count[ins->output.offset + j] == 1;
+        for (k = 0; k < pres_op_info[ins->op].input_count && constant; ++k)
+        {
+            if (ins->inputs[k].table == PRES_REGTAB_IMMED)
+                continue;
+            if (ins->inputs[k].table != PRES_REGTAB_TEMP)
+            {
+                constant = FALSE;
+                break;
+            }
+            for (j = 0; j < ins->component_count && constant; ++j)
+                constant = folded[ins->inputs[k].offset + get_ins_input_comp(ins, k, j)];
+        }
+        if (!constant)
+            continue;
+
+        state[i] = PRES_INS_FOLDED;
+        for (j = 0; j < output_count; ++j)
+            folded[ins->output.offset + j] = 1;
+    }
+
+    folded_count = 0;
+    for (i = 0; i < pres->ins_count; ++i)
+        if (state[i] == PRES_INS_FOLDED)
+            new_ins[folded_count++] = pres->ins[i];
+    run_count = folded_count;
+    output_count = 0;
+    for (i = 0; i < pres->ins_count; ++i)
+    {
+        if (state[i] != PRES_INS_RUN)
+            continue;
+        new_ins[run_count++] = pres->ins[i];
+        if (pres->ins[i].output.table != PRES_REGTAB_TEMP)
+            output_count += get_ins_output_count(&pres->ins[i]);
+    }
+
+    TRACE("%u instructions, %u removed, %u folded, %u output components.\n", pres->ins_count,
+            pres->ins_count - run_count, folded_count, output_count);
+
+    if (output_count && !(pres->outputs = HeapAlloc(GetProcessHeap(), 0, sizeof(*pres->outputs) * output_count)))
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+    /* Skipping the execution is only safe when the inputs can't be
+     * overwritten by the preshader itself. */
+    pres->skip_unchanged = TRUE;
+    for (i = 0; i < pres->inputs.const_set_count; ++i)
+        if (pres->inputs.const_set[i].table != PRES_REGTAB_CONST)
+            pres->skip_unchanged = FALSE;
+    pres->output_count = 0;
+    for (i = folded_count; i < run_count; ++i)
+    {
+        ins = &new_ins[i];
+        if (ins->output.table == PRES_REGTAB_CONST)
+            pres->skip_unchanged = FALSE;
+        if (ins->output.table == PRES_REGTAB_TEMP)
+            continue;
+        for (j = 0; j < get_ins_output_count(ins); ++j)
+        {
+            pres->outputs[pres->output_count].table = ins->output.table;
+            pres->outputs[pres->output_count].offset = ins->output.offset + j;
+            ++pres->output_count;
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, pres->ins);
+    pres->ins = new_ins;
+    new_ins = NULL;
+    pres->ins_count = run_count;
+    pres->folded_ins_count = folded_count;
+
+done:
+    HeapFree(GetProcessHeap(), 0, new_ins);
+    HeapFree(GetProcessHeap(), 0, live);
+    return hr;
+}
+
 static HRESULT parse_preshader(struct d3dx_preshader *pres, unsigned int *ptr, unsigned int count, struct d3dx9_base_effect *base)
 {
     unsigned int *p;
@@ -706,6 +881,8 @@ static HRESULT parse_preshader(struct d3dx_preshader *pres, unsigned int *ptr, u
                 pres->ins[i].output.offset + pres->ins[i].component_count - 1));
     }
     update_table_sizes_consts(pres->regs.table_sizes, &pres->inputs);
+    if (FAILED(hr = optimize_preshader(pres)))
+        return hr;
     if (FAILED(regstore_alloc_table(&pres->regs, PRES_REGTAB_IMMED)))
         return E_OUTOFMEMORY;
     regstore_set_values(&pres->regs, PRES_REGTAB_IMMED, dconst, 0, const_count);
@@ -788,6 +965,9 @@ void d3dx_create_param_eval(struct d3dx9_base_effect *base_effect, void *byte_co
             goto err_out;
     }
 
+    if (FAILED(execute_preshader(&peval->pres, 0, peval->pres.folded_ins_count)))
+        goto err_out;
+
     if (TRACE_ON(d3dx))
     {
         dump_bytecode(byte_code, byte_code_size);
@@ -818,6 +998,7 @@ static void d3dx_free_const_tab(struct d3dx_const_tab *ctab)
 static void d3dx_free_preshader(struct d3dx_preshader *pres)
 {
     HeapFree(GetProcessHeap(), 0, pres->ins);
+    HeapFree(GetProcessHeap(), 0, pres->outputs);
 
     regstore_free_tables(&pres->regs);
     d3dx_free_const_tab(&pres->inputs);
@@ -835,9 +1016,11 @@ void d3dx_free_param_eval(struct d3dx_param_eval *peval)
     HeapFree(GetProcessHeap(), 0, peval);
 }
 
-static void set_constants(struct d3dx_regstore *rs, struct d3dx_const_tab *const_tab)
+/* Returns TRUE if any of the register values changed. */
+static BOOL set_constants(struct d3dx_regstore *rs, struct d3dx_const_tab *const_tab)
 {
     unsigned int const_idx;
+    BOOL changed = FALSE;
 
     for (const_idx = 0; const_idx < const_tab->const_set_count; ++const_idx)
     {
@@ -874,6 +1057,9 @@ static void set_constants(struct d3dx_regstore *rs, struct d3dx_const_tab *const
                 && count == table_info[table].reg_component_count * const_set->register_count
                 && count * sizeof(unsigned int) <= param->bytes)
         {
+            if (!changed && memcmp((BYTE *)rs->tables[table] + start_offset * table_info[table].component_size,
+                    param->data, count * table_info[table].component_size))
+                changed = TRUE;
             regstore_set_values(rs, table, param->data, start_offset, count);
             continue;
         }
@@ -914,10 +1100,14 @@ static void set_constants(struct d3dx_regstore *rs, struct d3dx_const_tab *const
                         FIXME("Unexpected type %#x.\n", table_info[table].type);
                         break;
                 }
+                if (!changed && memcmp((BYTE *)rs->tables[table] + offset * table_info[table].component_size,
+                        &out, sizeof(out)))
+                    changed = TRUE;
                 regstore_set_values(rs, table, &out, offset, 1);
             }
         }
     }
+    return changed;
 }
 
 #define INITIAL_CONST_SET_SIZE 16
@@ -1105,13 +1295,13 @@ static void exec_set_arg(struct d3dx_regstore *rs, const struct d3dx_pres_operan
 }
 
 #define ARGS_ARRAY_SIZE 8
-static HRESULT execute_preshader(struct d3dx_preshader *pres)
+static HRESULT execute_preshader(struct d3dx_preshader *pres, unsigned int start, unsigned int end)
 {
     unsigned int i, j, k;
     double args[ARGS_ARRAY_SIZE];
     double res;
 
-    for (i = 0; i < pres->ins_count; ++i)
+    for (i = start; i < end; ++i)
     {
         const struct d3dx_pres_ins *ins;
         const struct op_info *oi;
@@ -1148,6 +1338,30 @@ static HRESULT execute_preshader(struct d3dx_preshader *pres)
     return D3D_OK;
 }
 
+static HRESULT update_preshader(struct d3dx_preshader *pres)
+{
+    struct d3dx_regstore *rs = &pres->regs;
+    unsigned int i;
+    HRESULT hr;
+
+    if (!set_constants(rs, &pres->inputs) && pres->outputs_valid && pres->skip_unchanged)
+    {
+        for (i = 0; i < pres->output_count; ++i)
+            regstore_set_values(rs, pres->outputs[i].table, &pres->outputs[i].value, pres->outputs[i].offset, 1);
+        return D3D_OK;
+    }
+
+    if (FAILED(hr = execute_preshader(pres, pres->folded_ins_count, pres->ins_count)))
+        return hr;
+
+    for (i = 0; i < pres->output_count; ++i)
+        memcpy(&pres->outputs[i].value, (BYTE *)rs->tables[pres->outputs[i].table]
+                + pres->outputs[i].offset * table_info[pres->outputs[i].table].component_size,
+                sizeof(pres->outputs[i].value));
+    pres->outputs_valid = TRUE;
+    return D3D_OK;
+}
+
 HRESULT d3dx_evaluate_parameter(struct d3dx_param_eval *peval, const struct d3dx_parameter *param, void *param_value)
 {
     HRESULT hr;
@@ -1157,9 +1371,7 @@ HRESULT d3dx_evaluate_parameter(struct d3dx_param_eval *peval, const struct d3dx
 
     TRACE("peval %p, param %p, param_value %p.\n", peval, param, param_value);
 
-    set_constants(&peval->pres.regs, &peval->pres.inputs);
-
-    if (FAILED(hr = execute_preshader(&peval->pres)))
+    if (FAILED(hr = update_preshader(&peval->pres)))
         return hr;
 
     elements_table = table_info[PRES_REGTAB_OCONST].reg_component_count
@@ -1257,8 +1469,7 @@ HRESULT d3dx_param_eval_set_shader_constants(struct IDirect3DDevice9 *device, st
 
     TRACE("device %p, peval %p, param_type %u.\n", device, peval, peval->param_type);
 
-    set_constants(rs, &pres->inputs);
-    if (FAILED(hr = execute_preshader(pres)))
+    if (FAILED(hr = update_preshader(pres)))
         return hr;
 
     set_constants(rs, &peval->shader_inputs);
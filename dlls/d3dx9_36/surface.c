@@ -1715,6 +1715,283 @@ void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slic
     }
 }
 
+struct filter_tap
+{
+    UINT index;
+    float weight;
+};
+
+/* Per destination pixel list of the source pixels contributing to it along
+ * one axis, with normalized weights. */
+struct filter_axis
+{
+    UINT max_taps;
+    UINT *counts;
+    struct filter_tap *taps;
+};
+
+static void free_filter_axis(struct filter_axis *axis)
+{
+    HeapFree(GetProcessHeap(), 0, axis->counts);
+    HeapFree(GetProcessHeap(), 0, axis->taps);
+}
+
+static HRESULT init_filter_axis(struct filter_axis *axis, UINT src_len, UINT dst_len, DWORD filter)
+{
+    float scale = (float)src_len / dst_len;
+    float radius;
+    UINT x;
+
+    switch (filter & 0xf)
+    {
+        case D3DX_FILTER_BOX:
+            radius = max(scale, 1.0f) * 0.5f;
+            break;
+        case D3DX_FILTER_TRIANGLE:
+            radius = max(scale, 1.0f);
+            break;
+        default: /* D3DX_FILTER_LINEAR */
+            radius = 1.0f;
+            break;
+    }
+
+    axis->max_taps = (UINT)ceilf(radius) * 2 + 3;
+    axis->counts = HeapAlloc(GetProcessHeap(), 0, dst_len * sizeof(*axis->counts));
+    axis->taps = HeapAlloc(GetProcessHeap(), 0, dst_len * axis->max_taps * sizeof(*axis->taps));
+    if (!axis->counts || !axis->taps)
+    {
+        free_filter_axis(axis);
+        return E_OUTOFMEMORY;
+    }
+
+    for (x = 0; x < dst_len; ++x)
+    {
+        struct filter_tap *taps = &axis->taps[x * axis->max_taps];
+        float center = (x + 0.5f) * scale;
+        float total = 0.0f;
+        UINT count = 0, i;
+        int first, last, s;
+
+        first = (int)floorf(center - radius);
+        last = (int)ceilf(center + radius);
+        for (s = first; s <= last && count < axis->max_taps; ++s)
+        {
+            float weight;
+            UINT index;
+
+            if ((filter & 0xf) == D3DX_FILTER_BOX)
+            {
+                /* Coverage of source pixel s by the destination pixel footprint. */
+                weight = min(s + 1.0f, center + radius) - max((float)s, center - radius);
+            }
+            else
+            {
+                weight = 1.0f - fabsf(s + 0.5f - center) / radius;
+            }
+            if (weight <= 0.0f)
+                continue;
+
+            index = s < 0 ? 0 : min((UINT)s, src_len - 1);
+            if (count && taps[count - 1].index == index)
+            {
+                taps[count - 1].weight += weight;
+            }
+            else
+            {
+                taps[count].index = index;
+                taps[count].weight = weight;
+                ++count;
+            }
+            total += weight;
+        }
+
+        if (!count)
+        {
+            taps[0].index = min((UINT)center, src_len - 1);
+            taps[0].weight = total = 1.0f;
+            count = 1;
+        }
+        for (i = 0; i < count; ++i)
+            taps[i].weight /= total;
+        axis->counts[x] = count;
+    }
+
+    return D3D_OK;
+}
+
+static void read_filter_row(const BYTE *src, UINT width, const struct pixel_format_desc *format,
+        const struct pixel_format_desc *ck_format, D3DCOLOR color_key, const PALETTEENTRY *palette,
+        struct vec4 *row)
+{
+    UINT x;
+
+    for (x = 0; x < width; ++x)
+    {
+        struct vec4 color;
+
+        format_to_vec4(format, src, &color);
+        if (format->to_rgba)
+            format->to_rgba(&color, &row[x], palette);
+        else
+            row[x] = color;
+
+        if (ck_format)
+        {
+            DWORD ck_pixel;
+
+            format_from_vec4(ck_format, &row[x], (BYTE *)&ck_pixel);
+            if (ck_pixel == color_key)
+                row[x].w = 0.0f;
+        }
+        src += format->bytes_per_pixel;
+    }
+}
+
+static void filter_row(const struct vec4 *src, const struct filter_axis *axis, UINT width, struct vec4 *dst)
+{
+    UINT x, i;
+
+    for (x = 0; x < width; ++x)
+    {
+        const struct filter_tap *taps = &axis->taps[x * axis->max_taps];
+        struct vec4 color = {0.0f, 0.0f, 0.0f, 0.0f};
+
+        for (i = 0; i < axis->counts[x]; ++i)
+        {
+            const struct vec4 *s = &src[taps[i].index];
+
+            color.x += s->x * taps[i].weight;
+            color.y += s->y * taps[i].weight;
+            color.z += s->z * taps[i].weight;
+            color.w += s->w * taps[i].weight;
+        }
+        dst[x] = color;
+    }
+}
+
+/************************************************************
+ * filter_argb_pixels
+ *
+ * Copies the source buffer to the destination buffer, performing
+ * any necessary format conversion, color keying and stretching
+ * using a linear, triangle or box filter.
+ *
+ * The filter is separable. Source rows are converted and filtered
+ * horizontally once, and kept in a small cache while the vertical
+ * filter slides over them.
+ */
+HRESULT filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pitch, const struct volume *src_size,
+        const struct pixel_format_desc *src_format, BYTE *dst, UINT dst_row_pitch, UINT dst_slice_pitch,
+        const struct volume *dst_size, const struct pixel_format_desc *dst_format, D3DCOLOR color_key,
+        const PALETTEENTRY *palette, DWORD filter)
+{
+    const struct pixel_format_desc *ck_format = NULL;
+    struct filter_axis axis_x = {0}, axis_y = {0}, axis_z = {0};
+    struct vec4 *src_row = NULL, *dst_row = NULL, *cache = NULL;
+    UINT cache_size = 0, cache_next = 0, *cache_tags = NULL;
+    UINT x, y, z, i, j, k;
+    HRESULT hr;
+
+    TRACE("Filtering %ux%ux%u -> %ux%ux%u, filter %#x.\n", src_size->width, src_size->height, src_size->depth,
+            dst_size->width, dst_size->height, dst_size->depth, filter);
+
+    if (color_key)
+    {
+        /* Color keys are always represented in D3DFMT_A8R8G8B8 format. */
+        ck_format = get_format_info(D3DFMT_A8R8G8B8);
+    }
+
+    if (FAILED(hr = init_filter_axis(&axis_x, src_size->width, dst_size->width, filter))
+            || FAILED(hr = init_filter_axis(&axis_y, src_size->height, dst_size->height, filter))
+            || FAILED(hr = init_filter_axis(&axis_z, src_size->depth, dst_size->depth, filter)))
+        goto done;
+
+    cache_size = axis_y.max_taps * axis_z.max_taps;
+    src_row = HeapAlloc(GetProcessHeap(), 0, src_size->width * sizeof(*src_row));
+    dst_row = HeapAlloc(GetProcessHeap(), 0, dst_size->width * sizeof(*dst_row));
+    cache = HeapAlloc(GetProcessHeap(), 0, cache_size * dst_size->width * sizeof(*cache));
+    cache_tags = HeapAlloc(GetProcessHeap(), 0, cache_size * sizeof(*cache_tags));
+    if (!src_row || !dst_row || !cache || !cache_tags)
+    {
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
+    memset(cache_tags, 0xff, cache_size * sizeof(*cache_tags));
+
+    for (z = 0; z < dst_size->depth; ++z)
+    {
+        const struct filter_tap *taps_z = &axis_z.taps[z * axis_z.max_taps];
+
+        for (y = 0; y < dst_size->height; ++y)
+        {
+            const struct filter_tap *taps_y = &axis_y.taps[y * axis_y.max_taps];
+            BYTE *dst_ptr = dst + z * dst_slice_pitch + y * dst_row_pitch;
+            float *d = (float *)dst_row;
+
+            memset(dst_row, 0, dst_size->width * sizeof(*dst_row));
+
+            for (k = 0; k < axis_z.counts[z]; ++k)
+            {
+                for (j = 0; j < axis_y.counts[y]; ++j)
+                {
+                    UINT tag = taps_z[k].index * src_size->height + taps_y[j].index;
+                    float weight = taps_z[k].weight * taps_y[j].weight;
+                    const float *s;
+
+                    for (i = 0; i < cache_size; ++i)
+                    {
+                        if (cache_tags[i] == tag)
+                            break;
+                    }
+                    if (i == cache_size)
+                    {
+                        /* Rows are consumed in increasing order, the oldest
+                         * entry is the one least likely to be needed again. */
+                        i = cache_next;
+                        cache_next = (cache_next + 1) % cache_size;
+                        read_filter_row(src + taps_z[k].index * src_slice_pitch + taps_y[j].index * src_row_pitch,
+                                src_size->width, src_format, ck_format, color_key, palette, src_row);
+                        filter_row(src_row, &axis_x, dst_size->width, &cache[i * dst_size->width]);
+                        cache_tags[i] = tag;
+                    }
+
+                    s = (const float *)&cache[i * dst_size->width];
+                    for (x = 0; x < dst_size->width * 4; ++x)
+                        d[x] += s[x] * weight;
+                }
+            }
+
+            for (x = 0; x < dst_size->width; ++x)
+            {
+                struct vec4 color;
+
+                if (dst_format->from_rgba)
+                {
+                    dst_format->from_rgba(&dst_row[x], &color);
+                    format_from_vec4(dst_format, &color, dst_ptr);
+                }
+                else
+                {
+                    format_from_vec4(dst_format, &dst_row[x], dst_ptr);
+                }
+                dst_ptr += dst_format->bytes_per_pixel;
+            }
+        }
+    }
+
+    hr = D3D_OK;
+
+done:
+    HeapFree(GetProcessHeap(), 0, cache_tags);
+    HeapFree(GetProcessHeap(), 0, cache);
+    HeapFree(GetProcessHeap(), 0, dst_row);
+    HeapFree(GetProcessHeap(), 0, src_row);
+    free_filter_axis(&axis_z);
+    free_filter_axis(&axis_y);
+    free_filter_axis(&axis_x);
+    return hr;
+}
+
 /************************************************************
  * D3DXLoadSurfaceFromMemory
  *
@@ -1852,16 +2129,28 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
             convert_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
                     lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette);
         }
-        else /* if ((filter & 0xf) == D3DX_FILTER_POINT) */
+        else if ((filter & 0xf) == D3DX_FILTER_POINT
+                || (src_size.width == dst_size.width && src_size.height == dst_size.height))
         {
-            if ((filter & 0xf) != D3DX_FILTER_POINT)
-                FIXME("Unhandled filter %#x.\n", filter);
-
-            /* Always apply a point filter until D3DX_FILTER_LINEAR,
-             * D3DX_FILTER_TRIANGLE and D3DX_FILTER_BOX are implemented. */
+            /* Without stretching all the filters sample exactly one source pixel. */
             point_filter_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
                     lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette);
         }
+        else
+        {
+            HRESULT hr;
+
+            if ((filter & 0xf) > D3DX_FILTER_BOX)
+                FIXME("Unhandled filter %#x.\n", filter);
+
+            hr = filter_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
+                    lockrect.pBits, lockrect.Pitch, 0, &dst_size, destformatdesc, color_key, src_palette, filter);
+            if (FAILED(hr))
+            {
+                IDirect3DSurface9_UnlockRect(dst_surface);
+                return hr;
+            }
+        }
 
         IDirect3DSurface9_UnlockRect(dst_surface);
     }
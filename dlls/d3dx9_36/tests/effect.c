@@ -4064,6 +4064,22 @@ static void test_effect_preshader(IDirect3DDevice9 *device)
 
     hr = effect->lpVtbl->EndPass(effect);
 
+    /* Constants computed by the preshader are set again even if none of
+     * its inputs changed. */
+    for (i = 0; i < TEST_EFFECT_PRES_NFLOATV; ++i)
+    {
+        hr = IDirect3DDevice9_SetVertexShaderConstantF(device, i, &fvect_empty.x, 1);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    }
+    hr = effect->lpVtbl->BeginPass(effect, 0);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    hr = IDirect3DDevice9_GetVertexShaderConstantF(device, 0, &fdata[0].x, TEST_EFFECT_PRES_NFLOATV);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    ok(!memcmp(fdata, test_effect_preshader_fconstsv, sizeof(test_effect_preshader_fconstsv)),
+            "Vertex shader float constants do not match.\n");
+    hr = effect->lpVtbl->EndPass(effect);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
     par = effect->lpVtbl->GetParameterByName(effect, NULL, "g_iVect");
     ok(par != NULL, "GetParameterByName failed.\n");
     hr = effect->lpVtbl->SetVector(effect, par, &fvect2);
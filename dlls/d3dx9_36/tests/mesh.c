@@ -6666,6 +6666,127 @@ static void check_vertex_components(int line, int mesh_number, int vertex_number
     }
 }
 
+/* Faces on the x + y + z = 0 plane all share the same sum of coordinates, a
+ * mesh without shared indices has to be matched purely by position. */
+static void test_generate_adjacency_large(void)
+{
+    static const D3DVERTEXELEMENT9 declaration[] =
+    {
+        {0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+        D3DDECL_END()
+    };
+    static const DWORD quad_corners[] = {0, 1, 2, 0, 2, 3};
+    static const float epsilons[] = {0.0f, 0.001f};
+    const DWORD grid_size = 32, num_faces = grid_size * grid_size * 2;
+    const DWORD num_shared_vertices = (grid_size + 1) * (grid_size + 1);
+    const DWORD num_split_vertices = num_faces * 3;
+    DWORD *indices, *expected, *adjacency;
+    struct test_context *test_context;
+    ID3DXMesh *mesh = NULL;
+    D3DXVECTOR3 *vertices, *shared_vertices;
+    DWORD i, j, k;
+    HRESULT hr;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context\n");
+        return;
+    }
+
+    shared_vertices = HeapAlloc(GetProcessHeap(), 0, num_shared_vertices * sizeof(*shared_vertices));
+    vertices = HeapAlloc(GetProcessHeap(), 0, num_split_vertices * sizeof(*vertices));
+    indices = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*indices));
+    expected = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*expected));
+    adjacency = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*adjacency));
+
+    for (i = 0; i < num_shared_vertices; i++)
+    {
+        shared_vertices[i].x = i % (grid_size + 1);
+        shared_vertices[i].y = i / (grid_size + 1);
+        shared_vertices[i].z = -shared_vertices[i].x - shared_vertices[i].y;
+    }
+    for (i = 0; i < grid_size * grid_size; i++)
+    {
+        DWORD corners[4], base = (i / grid_size) * (grid_size + 1) + i % grid_size;
+
+        corners[0] = base;
+        corners[1] = base + 1;
+        corners[2] = base + grid_size + 2;
+        corners[3] = base + grid_size + 1;
+        for (j = 0; j < 6; j++)
+            indices[i * 6 + j] = corners[quad_corners[j]];
+    }
+
+    /* The reference adjacency comes from the mesh with shared indices. */
+    hr = init_test_mesh(num_faces, num_shared_vertices, D3DXMESH_32BIT | D3DXMESH_SYSTEMMEM, declaration,
+            test_context->device, &mesh, shared_vertices, sizeof(*shared_vertices), indices, NULL);
+    if (FAILED(hr))
+    {
+        skip("Couldn't initialize test mesh, hr %#x.\n", hr);
+        goto cleanup;
+    }
+    hr = mesh->lpVtbl->GenerateAdjacency(mesh, -1.0f, expected);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    for (i = 0, j = 0; i < num_faces * 3; i++)
+        j += expected[i] != ~0u;
+    ok(j == 2 * grid_size * grid_size + 4 * grid_size * (grid_size - 1),
+            "Got unexpected number of adjacent edges %u.\n", j);
+    mesh->lpVtbl->Release(mesh);
+    mesh = NULL;
+
+    for (i = 0; i < num_split_vertices; i++)
+        vertices[i] = shared_vertices[indices[i]];
+
+    for (k = 0; k < ARRAY_SIZE(epsilons); k++)
+    {
+        /* Move every other face by less than epsilon. */
+        for (i = 0; i < num_faces; i++)
+        {
+            for (j = 0; j < 3; j++)
+                vertices[i * 3 + j].z = -vertices[i * 3 + j].x - vertices[i * 3 + j].y
+                        + ((i & 2) ? epsilons[k] * 0.25f : 0.0f);
+        }
+
+        hr = init_test_mesh(num_faces, num_split_vertices, D3DXMESH_32BIT | D3DXMESH_SYSTEMMEM, declaration,
+                test_context->device, &mesh, vertices, sizeof(*vertices), NULL, NULL);
+        if (FAILED(hr))
+        {
+            skip("Couldn't initialize test mesh, hr %#x.\n", hr);
+            goto cleanup;
+        }
+        hr = mesh->lpVtbl->GenerateAdjacency(mesh, epsilons[k], adjacency);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        for (i = 0; i < num_faces * 3; i++)
+        {
+            ok(adjacency[i] == expected[i], "Epsilon %.8e, edge %u: got adjacency %#x, expected %#x.\n",
+                    epsilons[k], i, adjacency[i], expected[i]);
+            if (adjacency[i] != expected[i])
+                break;
+        }
+
+        hr = mesh->lpVtbl->GenerateAdjacency(mesh, -1.0f, adjacency);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        for (i = 0; i < num_faces * 3; i++)
+        {
+            ok(adjacency[i] == ~0u, "Edge %u: got adjacency %#x.\n", i, adjacency[i]);
+            if (adjacency[i] != ~0u)
+                break;
+        }
+        mesh->lpVtbl->Release(mesh);
+        mesh = NULL;
+    }
+
+cleanup:
+    if (mesh)
+        mesh->lpVtbl->Release(mesh);
+    HeapFree(GetProcessHeap(), 0, adjacency);
+    HeapFree(GetProcessHeap(), 0, expected);
+    HeapFree(GetProcessHeap(), 0, indices);
+    HeapFree(GetProcessHeap(), 0, vertices);
+    HeapFree(GetProcessHeap(), 0, shared_vertices);
+    free_test_context(test_context);
+}
+
 static void test_weld_vertices(void)
 {
     HRESULT hr;
@@ -10557,6 +10678,205 @@ static void test_optimize_faces(void)
     "faces when using 16-bit indices. Got %x\n, expected D3DERR_INVALIDCALL\n", hr);
 }
 
+/* Average cache miss ratio of a 16 entry FIFO vertex cache. */
+static float compute_acmr(const DWORD *indices, DWORD num_faces)
+{
+    DWORD cache[16], misses = 0, next = 0, i, j;
+
+    memset(cache, 0xff, sizeof(cache));
+    for (i = 0; i < num_faces * 3; i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(cache); j++)
+        {
+            if (cache[j] == indices[i])
+                break;
+        }
+        if (j < ARRAY_SIZE(cache))
+            continue;
+        misses++;
+        cache[next] = indices[i];
+        next = (next + 1) % ARRAY_SIZE(cache);
+    }
+
+    return (float)misses / num_faces;
+}
+
+static void test_optimize_vertex_cache(void)
+{
+    static const D3DVERTEXELEMENT9 declaration[] =
+    {
+        {0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+        D3DDECL_END()
+    };
+    const DWORD grid_size = 16, num_vertices = (grid_size + 1) * (grid_size + 1);
+    const DWORD num_faces = grid_size * grid_size * 2;
+    DWORD *indices, *attributes, *adjacency, *adjacency_out, *face_remap, *vertex_remap_ptr;
+    DWORD *new_indices, *new_attributes, *vertex_remap2, *new_faces;
+    struct test_context *test_context;
+    ID3DXBuffer *vertex_remap = NULL;
+    float acmr_before, acmr_after;
+    ID3DXMesh *mesh = NULL;
+    D3DXVECTOR3 *vertices;
+    DWORD i, j, x, y, open_edges;
+    HRESULT hr;
+
+    test_context = new_test_context();
+    if (!test_context)
+    {
+        skip("Couldn't create test context\n");
+        return;
+    }
+
+    vertices = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*vertices));
+    indices = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*indices));
+    attributes = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*attributes));
+    adjacency = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*adjacency));
+    adjacency_out = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*adjacency_out));
+    face_remap = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_remap));
+    vertex_remap2 = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*vertex_remap2));
+    new_faces = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*new_faces));
+
+    for (y = 0; y <= grid_size; y++)
+    {
+        for (x = 0; x <= grid_size; x++)
+        {
+            vertices[y * (grid_size + 1) + x].x = x;
+            vertices[y * (grid_size + 1) + x].y = y;
+            vertices[y * (grid_size + 1) + x].z = 0.0f;
+        }
+    }
+    /* Scatter the faces over the index buffer, so that the original order
+     * makes poor use of the vertex cache. */
+    for (i = 0; i < num_faces; i++)
+    {
+        DWORD face = (i * 97) % num_faces, quad = face / 2;
+        DWORD v = (quad / grid_size) * (grid_size + 1) + quad % grid_size;
+
+        if (face & 1)
+        {
+            indices[i * 3] = v + 1;
+            indices[i * 3 + 1] = v + grid_size + 2;
+            indices[i * 3 + 2] = v + grid_size + 1;
+        }
+        else
+        {
+            indices[i * 3] = v;
+            indices[i * 3 + 1] = v + 1;
+            indices[i * 3 + 2] = v + grid_size + 1;
+        }
+        attributes[i] = (quad % grid_size) < grid_size / 2;
+    }
+
+    hr = init_test_mesh(num_faces, num_vertices, D3DXMESH_32BIT | D3DXMESH_SYSTEMMEM, declaration,
+            test_context->device, &mesh, vertices, sizeof(*vertices), indices, attributes);
+    if (FAILED(hr))
+    {
+        skip("Couldn't initialize test mesh, hr %#x.\n", hr);
+        goto cleanup;
+    }
+
+    hr = mesh->lpVtbl->GenerateAdjacency(mesh, 0.0f, adjacency);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    /* The edges on the border of the grid have no neighbour. */
+    for (i = 0, open_edges = 0; i < num_faces * 3; i++)
+        if (adjacency[i] == ~0u) open_edges++;
+    ok(open_edges == grid_size * 4, "Got unexpected open edge count %u.\n", open_edges);
+
+    hr = mesh->lpVtbl->OptimizeInplace(mesh, D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER,
+            adjacency, adjacency_out, face_remap, &vertex_remap);
+    ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
+    hr = mesh->lpVtbl->OptimizeInplace(mesh, D3DXMESHOPT_VERTEXCACHE, NULL, adjacency_out, face_remap, &vertex_remap);
+    ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
+
+    hr = mesh->lpVtbl->OptimizeInplace(mesh, D3DXMESHOPT_VERTEXCACHE, adjacency, adjacency_out,
+            face_remap, &vertex_remap);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    if (FAILED(hr))
+        goto cleanup;
+    ok(mesh->lpVtbl->GetNumFaces(mesh) == num_faces, "Got unexpected face count %u.\n",
+            mesh->lpVtbl->GetNumFaces(mesh));
+    ok(mesh->lpVtbl->GetNumVertices(mesh) == num_vertices, "Got unexpected vertex count %u.\n",
+            mesh->lpVtbl->GetNumVertices(mesh));
+    vertex_remap_ptr = ID3DXBuffer_GetBufferPointer(vertex_remap);
+
+    hr = mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&new_indices);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = mesh->lpVtbl->LockAttributeBuffer(mesh, D3DLOCK_READONLY, &new_attributes);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    /* Faces are only reordered within attribute ranges and keep their
+     * vertices, up to rotation. */
+    for (i = 0; i < num_faces; i++)
+    {
+        const DWORD *old_face = &indices[face_remap[i] * 3];
+        BOOL found = FALSE;
+
+        ok(face_remap[i] < num_faces, "Got unexpected face remap %u for face %u.\n", face_remap[i], i);
+        if (face_remap[i] >= num_faces)
+            break;
+        ok(new_attributes[i] == attributes[face_remap[i]], "Got unexpected attribute %u for face %u.\n",
+                new_attributes[i], i);
+        ok(!i || new_attributes[i] >= new_attributes[i - 1], "Faces are not sorted by attribute.\n");
+        for (j = 0; j < 3; j++)
+        {
+            if (vertex_remap_ptr[new_indices[i * 3]] == old_face[j]
+                    && vertex_remap_ptr[new_indices[i * 3 + 1]] == old_face[(j + 1) % 3]
+                    && vertex_remap_ptr[new_indices[i * 3 + 2]] == old_face[(j + 2) % 3])
+                found = TRUE;
+        }
+        ok(found, "Face %u doesn't match original face %u.\n", i, face_remap[i]);
+        new_faces[face_remap[i]] = i;
+    }
+
+    /* The adjacency is remapped to the new faces, and open edges stay open. */
+    for (i = 0; i < num_faces && face_remap[i] < num_faces; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            DWORD old_adjacent = adjacency[face_remap[i] * 3 + j];
+            DWORD expected = old_adjacent == ~0u ? ~0u : new_faces[old_adjacent];
+
+            ok(adjacency_out[i * 3 + j] == expected, "Got unexpected adjacency %#x for face %u, edge %u, "
+                    "expected %#x.\n", adjacency_out[i * 3 + j], i, j, expected);
+        }
+    }
+
+    acmr_before = compute_acmr(indices, num_faces);
+    acmr_after = compute_acmr(new_indices, num_faces);
+    ok(acmr_after < acmr_before, "Expected ACMR to improve, got %.8e before, %.8e after.\n",
+            acmr_before, acmr_after);
+
+    hr = D3DXOptimizeVertices(new_indices, num_faces, num_vertices, TRUE, vertex_remap2);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    memset(vertices, 0, num_vertices * sizeof(*vertices));
+    for (i = 0; i < num_vertices; i++)
+    {
+        ok(vertex_remap2[i] < num_vertices, "Got unexpected vertex remap %u at %u.\n", vertex_remap2[i], i);
+        if (vertex_remap2[i] >= num_vertices)
+            break;
+        ok(!vertices[vertex_remap2[i]].x, "Vertex %u remapped twice.\n", vertex_remap2[i]);
+        vertices[vertex_remap2[i]].x = 1.0f;
+    }
+    hr = D3DXOptimizeVertices(new_indices, num_faces, num_vertices, TRUE, NULL);
+    ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
+
+    mesh->lpVtbl->UnlockAttributeBuffer(mesh);
+    mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+cleanup:
+    if (vertex_remap) ID3DXBuffer_Release(vertex_remap);
+    if (mesh) mesh->lpVtbl->Release(mesh);
+    HeapFree(GetProcessHeap(), 0, new_faces);
+    HeapFree(GetProcessHeap(), 0, vertex_remap2);
+    HeapFree(GetProcessHeap(), 0, face_remap);
+    HeapFree(GetProcessHeap(), 0, adjacency_out);
+    HeapFree(GetProcessHeap(), 0, adjacency);
+    HeapFree(GetProcessHeap(), 0, attributes);
+    HeapFree(GetProcessHeap(), 0, indices);
+    HeapFree(GetProcessHeap(), 0, vertices);
+    free_test_context(test_context);
+}
+
 static HRESULT clear_normals(ID3DXMesh *mesh)
 {
     HRESULT hr;
@@ -11209,6 +11529,7 @@ START_TEST(mesh)
     test_get_decl_vertex_size();
     test_fvf_decl_conversion();
     D3DXGenerateAdjacencyTest();
+    test_generate_adjacency_large();
     test_update_semantics();
     test_create_skin_info();
     test_convert_adjacency_to_point_reps();
@@ -11217,5 +11538,6 @@ START_TEST(mesh)
     test_clone_mesh();
     test_valid_mesh();
     test_optimize_faces();
+    test_optimize_vertex_cache();
     test_compute_normals();
 }
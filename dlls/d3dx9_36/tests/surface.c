@@ -1230,6 +1230,89 @@ static void test_D3DXLoadSurface(IDirect3DDevice9 *device)
     if(testbitmap_ok) DeleteFileA("testbitmap.bmp");
 }
 
+static BOOL color_match(DWORD c1, DWORD c2, BYTE max_diff)
+{
+    unsigned int i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        if (abs((int)(c1 & 0xff) - (int)(c2 & 0xff)) > max_diff)
+            return FALSE;
+        c1 >>= 8;
+        c2 >>= 8;
+    }
+    return TRUE;
+}
+
+static void test_D3DXLoadSurface_filters(IDirect3DDevice9 *device)
+{
+    static const DWORD filters[] = {D3DX_FILTER_LINEAR, D3DX_FILTER_TRIANGLE, D3DX_FILTER_BOX, D3DX_DEFAULT};
+    DWORD src[4 * 4], expected;
+    D3DLOCKED_RECT lockrect;
+    IDirect3DSurface9 *surf;
+    unsigned int i, x, y;
+    DWORD color;
+    RECT rect;
+    HRESULT hr;
+
+    hr = IDirect3DDevice9_CreateOffscreenPlainSurface(device, 2, 2, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &surf, NULL);
+    if (FAILED(hr))
+    {
+        skip("Failed to create a surface, hr %#x.\n", hr);
+        return;
+    }
+    SetRect(&rect, 0, 0, 4, 4);
+
+    /* A uniform image stays uniform whatever the filter. */
+    for (i = 0; i < sizeof(src) / sizeof(src[0]); ++i)
+        src[i] = 0x80c04020;
+    for (i = 0; i < sizeof(filters) / sizeof(filters[0]); ++i)
+    {
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, src, D3DFMT_A8R8G8B8, 16, NULL, &rect, filters[i], 0);
+        ok(hr == D3D_OK, "Filter %#x: got unexpected hr %#x.\n", filters[i], hr);
+        IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        for (y = 0; y < 2; ++y)
+        {
+            for (x = 0; x < 2; ++x)
+            {
+                color = ((DWORD *)lockrect.pBits)[x + y * lockrect.Pitch / 4];
+                ok(color_match(color, 0x80c04020, 1), "Filter %#x, pixel (%u, %u): got color 0x%08x.\n",
+                        filters[i], x, y, color);
+            }
+        }
+        IDirect3DSurface9_UnlockRect(surf);
+    }
+
+    /* Halving with a box or linear filter averages each 2x2 block. */
+    for (i = 0; i < sizeof(src) / sizeof(src[0]); ++i)
+        src[i] = (i & 1 ? 0xff000000 : 0x00000000) | (i & 4 ? 0x00ff0000 : 0) | ((i * 0x10) << 8) | (i * 0x11);
+    for (i = 0; i < 2; ++i)
+    {
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, src, D3DFMT_A8R8G8B8, 16, NULL, &rect, filters[i * 2], 0);
+        ok(hr == D3D_OK, "Filter %#x: got unexpected hr %#x.\n", filters[i * 2], hr);
+        IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        for (y = 0; y < 2; ++y)
+        {
+            for (x = 0; x < 2; ++x)
+            {
+                const DWORD *block = &src[y * 8 + x * 2];
+                unsigned int c;
+
+                expected = 0;
+                for (c = 0; c < 32; c += 8)
+                    expected |= ((((block[0] >> c) & 0xff) + ((block[1] >> c) & 0xff)
+                            + ((block[4] >> c) & 0xff) + ((block[5] >> c) & 0xff) + 2) / 4) << c;
+                color = ((DWORD *)lockrect.pBits)[x + y * lockrect.Pitch / 4];
+                ok(color_match(color, expected, 1), "Filter %#x, pixel (%u, %u): got color 0x%08x, expected 0x%08x.\n",
+                        filters[i * 2], x, y, color, expected);
+            }
+        }
+        IDirect3DSurface9_UnlockRect(surf);
+    }
+
+    IDirect3DSurface9_Release(surf);
+}
+
 static void test_D3DXSaveSurfaceToFileInMemory(IDirect3DDevice9 *device)
 {
     HRESULT hr;
@@ -1435,6 +1518,7 @@ START_TEST(surface)
 
     test_D3DXGetImageInfo();
     test_D3DXLoadSurface(device);
+    test_D3DXLoadSurface_filters(device);
     test_D3DXSaveSurfaceToFileInMemory(device);
     test_D3DXSaveSurfaceToFile(device);
 
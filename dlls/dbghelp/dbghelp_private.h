@@ -561,7 +561,13 @@ extern struct module*
                     elf_load_module(struct process* pcs, const WCHAR* name, unsigned long) DECLSPEC_HIDDEN;
 extern BOOL         elf_read_wine_loader_dbg_info(struct process* pcs) DECLSPEC_HIDDEN;
 extern BOOL         elf_synchronize_module_list(struct process* pcs) DECLSPEC_HIDDEN;
-struct elf_thunk_area;
+struct elf_thunk_area
+{
+    const char*                 symname;
+    THUNK_ORDINAL               ordinal;
+    unsigned long               rva_start;
+    unsigned long               rva_end;
+};
 extern int          elf_is_in_thunk_area(unsigned long addr, const struct elf_thunk_area* thunks) DECLSPEC_HIDDEN;
 
 /* macho_module.c */
@@ -594,6 +600,7 @@ extern struct module*
                     module_is_already_loaded(const struct process* pcs,
                                              const WCHAR* imgname) DECLSPEC_HIDDEN;
 extern BOOL         module_get_debug(struct module_pair*) DECLSPEC_HIDDEN;
+extern BOOL         module_get_debug_at(struct module_pair*, DWORD64 addr) DECLSPEC_HIDDEN;
 extern struct module*
                     module_new(struct process* pcs, const WCHAR* name,
                                enum module_type type, BOOL virtual,
@@ -660,6 +667,10 @@ extern BOOL         stabs_parse(struct module* module, unsigned long load_offset
 extern BOOL         dwarf2_parse(struct module* module, unsigned long load_offset,
                                  const struct elf_thunk_area* thunks,
                                  struct image_file_map* fmap) DECLSPEC_HIDDEN;
+extern BOOL         dwarf2_parse_frames(struct module* module, unsigned long load_offset,
+                                        struct image_file_map* fmap) DECLSPEC_HIDDEN;
+extern void         dwarf2_load_all_units(struct module* module) DECLSPEC_HIDDEN;
+extern void         dwarf2_load_units_at(struct module* module, DWORD64 addr) DECLSPEC_HIDDEN;
 extern BOOL         dwarf2_virtual_unwind(struct cpu_stack_walk* csw, DWORD_PTR ip,
                                           CONTEXT* context, ULONG_PTR* cfa) DECLSPEC_HIDDEN;
 
@@ -669,6 +680,10 @@ extern DWORD64      sw_xlat_addr(struct cpu_stack_walk* csw, ADDRESS64* addr) DE
 extern void*        sw_table_access(struct cpu_stack_walk* csw, DWORD64 addr) DECLSPEC_HIDDEN;
 extern DWORD64      sw_module_base(struct cpu_stack_walk* csw, DWORD64 addr) DECLSPEC_HIDDEN;
 
+/* symcache.c */
+extern BOOL         symcache_load(struct module* module, const BYTE* id, unsigned idlen) DECLSPEC_HIDDEN;
+extern void         symcache_save(struct module* module, const BYTE* id, unsigned idlen) DECLSPEC_HIDDEN;
+
 /* symbol.c */
 extern const char*  symt_get_name(const struct symt* sym) DECLSPEC_HIDDEN;
 extern WCHAR*       symt_get_nameW(const struct symt* sym) DECLSPEC_HIDDEN;
@@ -200,6 +200,22 @@ typedef struct dwarf2_parse_context_s
     char*                       cpp_name;
 } dwarf2_parse_context_t;
 
+/* a compilation unit in .debug_info, which may not be loaded yet */
+struct dwarf2_unit
+{
+    unsigned long               offset;         /* in .debug_info */
+    BOOL                        parsed;
+};
+
+/* an address range (from .debug_aranges) covered by a compilation unit */
+struct dwarf2_unit_range
+{
+    ULONG_PTR                   start;
+    ULONG_PTR                   end;
+    ULONG_PTR                   max_end;        /* highest end of this and all preceding ranges */
+    unsigned                    unit;           /* index in units */
+};
+
 /* stored in the dbghelp's module internal structure for later reuse */
 struct dwarf2_module_info_s
 {
@@ -207,6 +223,17 @@ struct dwarf2_module_info_s
     dwarf2_section_t            debug_frame;
     dwarf2_section_t            eh_frame;
     unsigned char               word_size;
+    /* when units is set, compilation units are loaded on demand and the
+     * following sections are kept mapped until the module is removed
+     */
+    dwarf2_section_t            sections[section_max];
+    struct elf_thunk_area*      thunks;
+    unsigned long               load_offset;
+    struct dwarf2_unit*         units;
+    unsigned                    num_units;
+    unsigned                    num_parsed;
+    struct dwarf2_unit_range*   ranges;
+    unsigned                    num_ranges;
 };
 
 #define loc_dwarf2_location_list        (loc_user + 0)
@@ -3250,7 +3277,7 @@ BOOL dwarf2_virtual_unwind(struct cpu_stack_walk* csw, ULONG_PTR ip, CONTEXT* co
 
     if (!(pair.pcs = process_find_by_handle(csw->hProcess)) ||
         !(pair.requested = module_find_by_addr(pair.pcs, ip, DMT_UNKNOWN)) ||
-        !module_get_debug(&pair))
+        !module_get_debug_at(&pair, ip))
         return FALSE;
     modfmt = pair.effective->format_info[DFI_DWARF];
     if (!modfmt) return FALSE;
@@ -3491,11 +3518,312 @@ static inline void dwarf2_fini_section(dwarf2_section_t* section)
 
 static void dwarf2_module_remove(struct process* pcs, struct module_format* modfmt)
 {
-    dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_loc);
-    dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_frame);
+    struct dwarf2_module_info_s* info = modfmt->u.dwarf2_info;
+
+    dwarf2_fini_section(&info->debug_loc);
+    dwarf2_fini_section(&info->debug_frame);
+    if (info->units)
+    {
+        unsigned i;
+
+        /* the mapped sections themselves go away with the image's file map */
+        for (i = 0; i < section_max; i++)
+            dwarf2_fini_section(&info->sections[i]);
+        HeapFree(GetProcessHeap(), 0, info->thunks);
+        HeapFree(GetProcessHeap(), 0, info->units);
+        HeapFree(GetProcessHeap(), 0, info->ranges);
+    }
     HeapFree(GetProcessHeap(), 0, modfmt);
 }
 
+static void dwarf2_load_unit(struct module* module, struct dwarf2_module_info_s* info, unsigned idx)
+{
+    dwarf2_traverse_context_t   mod_ctx;
+    unsigned char               word_size = info->word_size;
+
+    if (info->units[idx].parsed) return;
+    /* mark it first, so that a unit which fails to parse isn't retried */
+    info->units[idx].parsed = TRUE;
+    info->num_parsed++;
+
+    TRACE("Loading compilation unit at 0x%lx for %s\n",
+          info->units[idx].offset, debugstr_w(module->module.ModuleName));
+    mod_ctx.data = info->sections[section_debug].address + info->units[idx].offset;
+    mod_ctx.end_data = info->sections[section_debug].address + info->sections[section_debug].size;
+    mod_ctx.word_size = 0;
+    dwarf2_parse_compilation_unit(info->sections, module, info->thunks, &mod_ctx, info->load_offset);
+    /* keep the word size used for eh_frame parsing */
+    info->word_size = word_size;
+    module->module.NumSyms = module->ht_symbols.num_elts;
+}
+
+/******************************************************************
+ *		dwarf2_load_all_units
+ *
+ * Loads all the compilation units of a module which haven't been loaded yet.
+ */
+void dwarf2_load_all_units(struct module* module)
+{
+    struct module_format*       modfmt = module->format_info[DFI_DWARF];
+    struct dwarf2_module_info_s* info;
+    unsigned                    i;
+
+    if (!modfmt || !(info = modfmt->u.dwarf2_info)->units) return;
+    for (i = 0; i < info->num_units && info->num_parsed < info->num_units; i++)
+        dwarf2_load_unit(module, info, i);
+}
+
+/******************************************************************
+ *		dwarf2_load_units_at
+ *
+ * Loads the compilation unit(s) covering a given address, if not already done.
+ */
+void dwarf2_load_units_at(struct module* module, DWORD64 addr)
+{
+    struct module_format*       modfmt = module->format_info[DFI_DWARF];
+    struct dwarf2_module_info_s* info;
+    int                         low, high, mid;
+
+    if (!modfmt || !(info = modfmt->u.dwarf2_info)->units ||
+        info->num_parsed == info->num_units)
+        return;
+
+    /* find the first range starting after addr... */
+    low = 0;
+    high = info->num_ranges;
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (info->ranges[mid].start <= addr) low = mid + 1;
+        else high = mid;
+    }
+    /* ...and walk backwards through all the ranges that may contain it */
+    while (--low >= 0 && info->ranges[low].max_end > addr)
+    {
+        if (addr < info->ranges[low].end)
+            dwarf2_load_unit(module, info, info->ranges[low].unit);
+    }
+}
+
+static int dwarf2_find_unit(const struct dwarf2_module_info_s* info, unsigned long offset)
+{
+    int low = 0, high = info->num_units, mid;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (info->units[mid].offset == offset) return mid;
+        if (info->units[mid].offset < offset) low = mid + 1;
+        else high = mid;
+    }
+    return -1;
+}
+
+static int dwarf2_range_cmp(const void* p1, const void* p2)
+{
+    const struct dwarf2_unit_range* r1 = p1;
+    const struct dwarf2_unit_range* r2 = p2;
+
+    if (r1->start < r2->start) return -1;
+    if (r1->start > r2->start) return 1;
+    return 0;
+}
+
+static BOOL dwarf2_add_unit_range(struct dwarf2_module_info_s* info, unsigned* max_ranges,
+                                  ULONG_PTR start, ULONG_PTR end, unsigned unit)
+{
+    if (info->num_ranges == *max_ranges)
+    {
+        struct dwarf2_unit_range* new;
+
+        new = HeapReAlloc(GetProcessHeap(), 0, info->ranges, *max_ranges * 2 * sizeof(*new));
+        if (!new) return FALSE;
+        info->ranges = new;
+        *max_ranges *= 2;
+    }
+    info->ranges[info->num_ranges].start = start;
+    info->ranges[info->num_ranges].end = end;
+    info->ranges[info->num_ranges].unit = unit;
+    info->num_ranges++;
+    return TRUE;
+}
+
+/******************************************************************
+ *		dwarf2_init_unit_index
+ *
+ * Builds the list of compilation units from .debug_info, and the addresses
+ * each of them covers from .debug_aranges, so that units can later be loaded
+ * on demand. Units which aren't described in .debug_aranges are loaded here.
+ * Returns FALSE if the index cannot be built (all units shall then be loaded).
+ */
+static BOOL dwarf2_init_unit_index(struct module* module, struct dwarf2_module_info_s* info,
+                                   const dwarf2_section_t* aranges)
+{
+    dwarf2_traverse_context_t   ctx;
+    const unsigned char*        ptr = info->sections[section_debug].address;
+    const unsigned char*        end = ptr + info->sections[section_debug].size;
+    unsigned                    max_units = 16, max_ranges = 64, i;
+    BOOL*                       covered = NULL;
+
+    info->units = HeapAlloc(GetProcessHeap(), 0, max_units * sizeof(*info->units));
+    info->ranges = HeapAlloc(GetProcessHeap(), 0, max_ranges * sizeof(*info->ranges));
+    if (!info->units || !info->ranges) goto failed;
+
+    /* list all compilation units (their offsets are sorted) */
+    while (end - ptr >= 4)
+    {
+        unsigned long len = dwarf2_get_u4(ptr);
+
+        /* 64-bit DWARF isn't supported by the parser anyway */
+        if (len == 0xffffffff || len > end - ptr - 4) break;
+        if (info->num_units == max_units)
+        {
+            struct dwarf2_unit* new;
+
+            new = HeapReAlloc(GetProcessHeap(), 0, info->units, max_units * 2 * sizeof(*new));
+            if (!new) goto failed;
+            info->units = new;
+            max_units *= 2;
+        }
+        info->units[info->num_units].offset = ptr - info->sections[section_debug].address;
+        info->units[info->num_units].parsed = FALSE;
+        info->num_units++;
+        ptr += 4 + len;
+    }
+    if (!info->num_units) goto failed;
+    covered = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, info->num_units * sizeof(*covered));
+    if (!covered) goto failed;
+
+    /* then gather the address ranges of each of them */
+    ctx.data = aranges->address;
+    ctx.end_data = ctx.data + aranges->size;
+    while (ctx.end_data - ctx.data >= 12)
+    {
+        const unsigned char*    set_start = ctx.data;
+        const unsigned char*    set_end;
+        unsigned long           len, info_offset;
+        unsigned short          version;
+        unsigned char           seg_size;
+        int                     unit;
+
+        len = dwarf2_parse_u4(&ctx);
+        if (len == 0xffffffff || len > ctx.end_data - ctx.data) goto failed;
+        set_end = ctx.data + len;
+        version = dwarf2_parse_u2(&ctx);
+        info_offset = dwarf2_parse_u4(&ctx);
+        ctx.word_size = dwarf2_parse_byte(&ctx);
+        seg_size = dwarf2_parse_byte(&ctx);
+        if (version != 2 || seg_size || (ctx.word_size != 4 && ctx.word_size != 8))
+        {
+            WARN("Unsupported .debug_aranges set (version %u, address size %u, segment size %u)\n",
+                 version, ctx.word_size, seg_size);
+            goto failed;
+        }
+        if ((unit = dwarf2_find_unit(info, info_offset)) == -1)
+        {
+            WARN("No compilation unit at 0x%lx\n", info_offset);
+            ctx.data = set_end;
+            continue;
+        }
+        /* tuples are aligned on twice the address size from the start of the set */
+        ctx.data = set_start + ((ctx.data - set_start + 2 * ctx.word_size - 1) & ~(2 * ctx.word_size - 1));
+        while (set_end - ctx.data >= 2 * ctx.word_size)
+        {
+            ULONG_PTR start = dwarf2_parse_addr(&ctx);
+            ULONG_PTR length = dwarf2_parse_addr(&ctx);
+
+            if (!start && !length) break;
+            if (!length) continue;
+            if (!dwarf2_add_unit_range(info, &max_ranges, info->load_offset + start,
+                                       info->load_offset + start + length, unit))
+                goto failed;
+            covered[unit] = TRUE;
+        }
+        ctx.data = set_end;
+    }
+
+    qsort(info->ranges, info->num_ranges, sizeof(info->ranges[0]), dwarf2_range_cmp);
+    for (i = 0; i < info->num_ranges; i++)
+    {
+        info->ranges[i].max_end = info->ranges[i].end;
+        if (i && info->ranges[i - 1].max_end > info->ranges[i].max_end)
+            info->ranges[i].max_end = info->ranges[i - 1].max_end;
+    }
+    TRACE("%u compilation units, %u address ranges\n", info->num_units, info->num_ranges);
+
+    /* units we can't locate by address are loaded right away */
+    for (i = 0; i < info->num_units; i++)
+        if (!covered[i]) dwarf2_load_unit(module, info, i);
+    HeapFree(GetProcessHeap(), 0, covered);
+    return TRUE;
+
+failed:
+    HeapFree(GetProcessHeap(), 0, covered);
+    HeapFree(GetProcessHeap(), 0, info->units);
+    HeapFree(GetProcessHeap(), 0, info->ranges);
+    info->units = NULL;
+    info->num_units = info->num_parsed = 0;
+    info->ranges = NULL;
+    info->num_ranges = 0;
+    return FALSE;
+}
+
+static struct module_format* dwarf2_new_module_format(struct module* module, unsigned long load_offset,
+                                                      const dwarf2_section_t* eh_frame,
+                                                      struct image_file_map* fmap)
+{
+    struct module_format*       dwarf2_modfmt;
+    struct dwarf2_module_info_s* info;
+
+    dwarf2_modfmt = HeapAlloc(GetProcessHeap(), 0,
+                              sizeof(*dwarf2_modfmt) + sizeof(*dwarf2_modfmt->u.dwarf2_info));
+    if (!dwarf2_modfmt) return NULL;
+    dwarf2_modfmt->module = module;
+    dwarf2_modfmt->remove = dwarf2_module_remove;
+    dwarf2_modfmt->loc_compute = dwarf2_location_compute;
+    dwarf2_modfmt->u.dwarf2_info = info = (struct dwarf2_module_info_s*)(dwarf2_modfmt + 1);
+    info->word_size = 0; /* will be correctly set later on */
+    info->thunks = NULL;
+    info->load_offset = load_offset;
+    info->units = NULL;
+    info->num_units = info->num_parsed = 0;
+    info->ranges = NULL;
+    info->num_ranges = 0;
+    module->format_info[DFI_DWARF] = dwarf2_modfmt;
+
+    /* As we'll need later some sections' content, we won't unmap these
+     * sections upon existing this function
+     */
+    dwarf2_init_section(&info->debug_loc,   fmap, ".debug_loc",   ".zdebug_loc",   NULL);
+    dwarf2_init_section(&info->debug_frame, fmap, ".debug_frame", ".zdebug_frame", NULL);
+    info->eh_frame = *eh_frame;
+    return dwarf2_modfmt;
+}
+
+/******************************************************************
+ *		dwarf2_parse_frames
+ *
+ * Only loads the call frame information of a module (for stack unwinding),
+ * when its symbols are obtained by other means.
+ */
+BOOL dwarf2_parse_frames(struct module* module, unsigned long load_offset,
+                         struct image_file_map* fmap)
+{
+    dwarf2_section_t            eh_frame;
+    struct image_section_map    eh_frame_sect;
+    struct module_format*       dwarf2_modfmt;
+
+    dwarf2_init_section(&eh_frame, fmap, ".eh_frame", NULL, &eh_frame_sect);
+    if ((dwarf2_modfmt = dwarf2_new_module_format(module, load_offset, &eh_frame, fmap)))
+    {
+        /* set the word_size for eh_frame parsing */
+        dwarf2_modfmt->u.dwarf2_info->word_size = fmap->addr_size / 8;
+        return TRUE;
+    }
+    image_unmap_section(&eh_frame_sect);
+    return FALSE;
+}
+
 BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
                   const struct elf_thunk_area* thunks,
                   struct image_file_map* fmap)
@@ -3504,8 +3832,9 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
     dwarf2_traverse_context_t   mod_ctx;
     struct image_section_map    debug_sect, debug_str_sect, debug_abbrev_sect,
                                 debug_line_sect, debug_ranges_sect, eh_frame_sect;
-    BOOL                ret = TRUE;
+    BOOL                ret = TRUE, lazy = FALSE;
     struct module_format* dwarf2_modfmt;
+    struct dwarf2_module_info_s* info;
 
     dwarf2_init_section(&eh_frame,                fmap, ".eh_frame",     NULL,             &eh_frame_sect);
     dwarf2_init_section(&section[section_debug],  fmap, ".debug_info",   ".zdebug_info",   &debug_sect);
@@ -3537,31 +3866,56 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
     mod_ctx.end_data = mod_ctx.data + section[section_debug].size;
     mod_ctx.word_size = 0; /* will be correctly set later on */
 
-    dwarf2_modfmt = HeapAlloc(GetProcessHeap(), 0,
-                              sizeof(*dwarf2_modfmt) + sizeof(*dwarf2_modfmt->u.dwarf2_info));
-    if (!dwarf2_modfmt)
+    if (!(dwarf2_modfmt = dwarf2_new_module_format(module, load_offset, &eh_frame, fmap)))
     {
         ret = FALSE;
         goto leave;
     }
-    dwarf2_modfmt->module = module;
-    dwarf2_modfmt->remove = dwarf2_module_remove;
-    dwarf2_modfmt->loc_compute = dwarf2_location_compute;
-    dwarf2_modfmt->u.dwarf2_info = (struct dwarf2_module_info_s*)(dwarf2_modfmt + 1);
-    dwarf2_modfmt->u.dwarf2_info->word_size = 0; /* will be correctly set later on */
-    dwarf2_modfmt->module->format_info[DFI_DWARF] = dwarf2_modfmt;
+    info = dwarf2_modfmt->u.dwarf2_info;
 
-    /* As we'll need later some sections' content, we won't unmap these
-     * sections upon existing this function
+    /* For ELF images, .debug_aranges lets us defer the loading of each compilation
+     * unit until an address it covers is looked up (or all symbols are needed),
+     * which saves parsing the whole debug information of big modules at load time.
+     * The ELF file map stays alive as long as the module, so do the sections.
      */
-    dwarf2_init_section(&dwarf2_modfmt->u.dwarf2_info->debug_loc,   fmap, ".debug_loc",   ".zdebug_loc",   NULL);
-    dwarf2_init_section(&dwarf2_modfmt->u.dwarf2_info->debug_frame, fmap, ".debug_frame", ".zdebug_frame", NULL);
-    dwarf2_modfmt->u.dwarf2_info->eh_frame = eh_frame;
+    if (fmap->modtype == DMT_ELF && mod_ctx.data && mod_ctx.data != IMAGE_NO_MAP)
+    {
+        struct image_section_map    debug_aranges_sect;
+        dwarf2_section_t            aranges;
+
+        if (dwarf2_init_section(&aranges, fmap, ".debug_aranges", ".zdebug_aranges", &debug_aranges_sect) &&
+            aranges.address != IMAGE_NO_MAP)
+        {
+            memcpy(info->sections, section, sizeof(section));
+            if (thunks)
+            {
+                unsigned num;
+
+                for (num = 0; thunks[num].symname; num++);
+                info->thunks = HeapAlloc(GetProcessHeap(), 0, (num + 1) * sizeof(*thunks));
+                if (info->thunks) memcpy(info->thunks, thunks, (num + 1) * sizeof(*thunks));
+            }
+            if ((!thunks || info->thunks) && dwarf2_init_unit_index(module, info, &aranges))
+                lazy = TRUE;
+            else
+            {
+                HeapFree(GetProcessHeap(), 0, info->thunks);
+                info->thunks = NULL;
+            }
+        }
+        dwarf2_fini_section(&aranges);
+        image_unmap_section(&debug_aranges_sect);
+    }
 
-    while (mod_ctx.data < mod_ctx.end_data)
+    if (!lazy)
     {
-        dwarf2_parse_compilation_unit(section, dwarf2_modfmt->module, thunks, &mod_ctx, load_offset);
+        while (mod_ctx.data < mod_ctx.end_data)
+        {
+            dwarf2_parse_compilation_unit(section, dwarf2_modfmt->module, thunks, &mod_ctx, load_offset);
+        }
     }
+    else if (section[section_line].address && section[section_line].address != IMAGE_NO_MAP)
+        dwarf2_modfmt->module->module.LineNumbers = TRUE;
     dwarf2_modfmt->module->module.SymType = SymDia;
     dwarf2_modfmt->module->module.CVSig = 'D' | ('W' << 8) | ('A' << 16) | ('R' << 24);
     /* FIXME: we could have a finer grain here */
@@ -3571,9 +3925,11 @@ BOOL dwarf2_parse(struct module* module, unsigned long load_offset,
     dwarf2_modfmt->module->module.Publics = TRUE;
 
     /* set the word_size for eh_frame parsing */
-    dwarf2_modfmt->u.dwarf2_info->word_size = fmap->addr_size / 8;
+    info->word_size = fmap->addr_size / 8;
 
 leave:
+    if (lazy) return ret;
+
     dwarf2_fini_section(&section[section_debug]);
     dwarf2_fini_section(&section[section_abbrev]);
     dwarf2_fini_section(&section[section_string]);
@@ -104,14 +104,6 @@ struct symtab_elt
     unsigned                    used;
 };
 
-struct elf_thunk_area
-{
-    const char*                 symname;
-    THUNK_ORDINAL               ordinal;
-    unsigned long               rva_start;
-    unsigned long               rva_end;
-};
-
 struct elf_module_info
 {
     unsigned long               elf_addr;
@@ -1052,6 +1044,37 @@ static BOOL elf_check_alternate(struct image_file_map* fmap, const struct module
     return found ? ret : TRUE;
 }
 
+/******************************************************************
+ *		elf_get_build_id
+ *
+ * Gets the build-id of an ELF file (if any)
+ */
+static BOOL elf_get_build_id(struct image_file_map* fmap, BYTE* id, unsigned* idlen)
+{
+    struct image_section_map buildid_sect;
+    BOOL ret = FALSE;
+
+    if (elf_find_section(fmap, ".note.gnu.build-id", SHT_NULL, &buildid_sect))
+    {
+        const uint32_t* note;
+
+        note = (const uint32_t*)image_map_section(&buildid_sect);
+        if (note != IMAGE_NO_MAP)
+        {
+            /* the usual ELF note structure: name-size desc-size type <name> <desc> */
+            if (note[2] == NT_GNU_BUILD_ID && note[1] && note[1] <= *idlen &&
+                image_get_map_size(&buildid_sect) >= 12 + ((note[0] + 3) & ~3) + note[1])
+            {
+                memcpy(id, note + 3 + ((note[0] + 3) >> 2), note[1]);
+                *idlen = note[1];
+                ret = TRUE;
+            }
+        }
+        image_unmap_section(&buildid_sect);
+    }
+    return ret;
+}
+
 /******************************************************************
  *		elf_load_debug_info_from_map
  *
@@ -1071,6 +1094,8 @@ static BOOL elf_load_debug_info_from_map(struct module* module,
                                          struct hash_table* ht_symtab)
 {
     BOOL                ret = FALSE, lret;
+    BYTE                build_id[64];
+    unsigned            build_id_len = sizeof(build_id);
     struct elf_thunk_area thunks[] = 
     {
         {"__wine_spec_import_thunks",           THUNK_ORDINAL_NOTYPE, 0, 0},    /* inter DLL calls */
@@ -1084,6 +1109,18 @@ static BOOL elf_load_debug_info_from_map(struct module* module,
 
     module->module.SymType = SymExport;
 
+    if (!elf_get_build_id(fmap, build_id, &build_id_len)) build_id_len = 0;
+    if (build_id_len && symcache_load(module, build_id, build_id_len))
+    {
+        /* symbols come from the cache, we still need the frame information */
+        if (!(dbghelp_options & SYMOPT_PUBLICS_ONLY))
+        {
+            elf_check_alternate(fmap, module);
+            dwarf2_parse_frames(module, module->reloc_delta, fmap);
+        }
+        return TRUE;
+    }
+
     /* create a hash table for the symtab */
     elf_hash_symtab(module, pool, ht_symtab, fmap, thunks);
 
@@ -1127,11 +1164,16 @@ static BOOL elf_load_debug_info_from_map(struct module* module,
     {
         /* add the thunks for native libraries */
         if (!(dbghelp_options & SYMOPT_PUBLICS_ONLY))
+        {
+            /* thunk creation looks up the functions we got from the debug info */
+            dwarf2_load_all_units(module);
             elf_new_wine_thunks(module, ht_symtab, thunks);
+        }
     }
     /* add all the public symbols from symtab */
     if (elf_new_public_symbols(module, ht_symtab) && !ret) ret = TRUE;
 
+    if (ret && build_id_len) symcache_save(module, build_id, build_id_len);
     return ret;
 }
 
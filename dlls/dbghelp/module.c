@@ -321,7 +321,7 @@ struct module* module_get_containee(const struct process* pcs,
 }
 
 /******************************************************************
- *		module_get_debug
+ *		module_load_debug
  *
  * get the debug information from a module:
  * - if the module's type is deferred, then force loading of debug info (and return
@@ -330,7 +330,7 @@ struct module* module_get_containee(const struct process* pcs,
  *   container (and also force the ELF container's debug info loading if deferred)
  * - otherwise return the module itself if it has some debug info
  */
-BOOL module_get_debug(struct module_pair* pair)
+static BOOL module_load_debug(struct module_pair* pair)
 {
     IMAGEHLP_DEFERRED_SYMBOL_LOADW64    idslW64;
 
@@ -379,6 +379,32 @@ BOOL module_get_debug(struct module_pair* pair)
     return pair->effective->module.SymType != SymNone;
 }
 
+/******************************************************************
+ *		module_get_debug
+ *
+ * same as module_load_debug, but also makes sure that all the debug
+ * information which is loaded on demand is present
+ */
+BOOL module_get_debug(struct module_pair* pair)
+{
+    if (!module_load_debug(pair)) return FALSE;
+    dwarf2_load_all_units(pair->effective);
+    return TRUE;
+}
+
+/******************************************************************
+ *		module_get_debug_at
+ *
+ * same as module_load_debug, but only makes sure that the debug information
+ * covering address addr is loaded (the rest may still be loaded on demand)
+ */
+BOOL module_get_debug_at(struct module_pair* pair, DWORD64 addr)
+{
+    if (!module_load_debug(pair)) return FALSE;
+    dwarf2_load_units_at(pair->effective, addr);
+    return TRUE;
+}
+
 /***********************************************************************
  *	module_find_by_addr
  *
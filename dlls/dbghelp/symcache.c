@@ -0,0 +1,546 @@
+/*
+ * File symcache.c - on-disk cache of modules' symbols
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * When the DBGHELP_CACHE environment variable names a directory, the
+ * functions, public symbols, thunks and line numbers of the ELF modules
+ * which carry a build-id are stored there once they've been loaded, and
+ * reused (instead of parsing the symtab, stabs and DWARF information) the
+ * next time a module with the same build-id is loaded.
+ * Only what's needed for symbolization is kept: types, local variables and
+ * global data (which are still available as public symbols) are not.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbghelp_private.h"
+#include "wine/unicode.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dbghelp);
+
+#define SYMCACHE_MAGIC          0x43535744      /* 'DWSC' */
+#define SYMCACHE_VERSION        1
+/* options changing the symbols we load */
+#define SYMCACHE_OPTIONS        (SYMOPT_LOAD_LINES | SYMOPT_NO_PUBLICS | SYMOPT_AUTO_PUBLICS | SYMOPT_PUBLICS_ONLY)
+#define SYMCACHE_NONE           (~0u)
+
+#define SYMCACHE_LINE_NUMBERS   0x0001
+#define SYMCACHE_GLOBAL_SYMBOLS 0x0002
+#define SYMCACHE_SOURCE_INDEXED 0x0004
+#define SYMCACHE_PUBLICS        0x0008
+
+/* the file is made of the header, followed by:
+ * - the source file names (NUL terminated strings, padded to a DWORD boundary)
+ * - the compilands, symbols and lines arrays
+ * - the symbol names (NUL terminated strings)
+ * all addresses are stored relative to the module's base
+ */
+struct symcache_header
+{
+    DWORD       magic;
+    DWORD       version;
+    DWORD       options;
+    DWORD       sym_type;
+    DWORD       cv_sig;
+    DWORD       flags;
+    DWORD       num_sources;
+    DWORD       sources_size;
+    DWORD       num_compilands;
+    DWORD       num_symbols;
+    DWORD       num_lines;
+    DWORD       strings_size;
+};
+
+struct symcache_compiland
+{
+    DWORD       source;         /* index of source file, or SYMCACHE_NONE */
+    DWORD       rva;
+};
+
+struct symcache_symbol
+{
+    DWORD       tag;
+    DWORD       name;           /* offset in symbol names */
+    DWORD       rva;
+    DWORD       size;
+    DWORD       compiland;      /* index of compiland, or SYMCACHE_NONE */
+    DWORD       param;          /* SymTagFunction: first line, SymTagThunk: ordinal */
+    DWORD       num_lines;      /* SymTagFunction only */
+};
+
+struct symcache_line
+{
+    DWORD       source;         /* index of source file, or SYMCACHE_NONE */
+    DWORD       line_number;
+    DWORD       offset;         /* from start of function */
+};
+
+static WCHAR* symcache_get_filename(const BYTE* id, unsigned idlen, unsigned* dirlen)
+{
+    static const WCHAR cacheW[] = {'D','B','G','H','E','L','P','_','C','A','C','H','E',0};
+    static const WCHAR extW[] = {'.','s','y','m',0};
+    static const WCHAR hexW[] = {'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'};
+    WCHAR*      filename;
+    WCHAR*      ptr;
+    DWORD       len;
+    unsigned    i;
+
+    if (!(len = GetEnvironmentVariableW(cacheW, NULL, 0))) return NULL;
+    filename = HeapAlloc(GetProcessHeap(), 0, (len + 1 + 2 * idlen + sizeof(extW) / sizeof(WCHAR)) * sizeof(WCHAR));
+    if (!filename) return NULL;
+    if (!GetEnvironmentVariableW(cacheW, filename, len) || !filename[0])
+    {
+        HeapFree(GetProcessHeap(), 0, filename);
+        return NULL;
+    }
+    ptr = filename + strlenW(filename);
+    if (ptr[-1] != '\\' && ptr[-1] != '/') *ptr++ = '\\';
+    *dirlen = ptr - filename;
+    for (i = 0; i < idlen; i++)
+    {
+        *ptr++ = hexW[id[i] >> 4];
+        *ptr++ = hexW[id[i] & 0x0f];
+    }
+    strcpyW(ptr, extW);
+    return filename;
+}
+
+static BOOL symcache_load_image(struct module* module, const BYTE* image, DWORD size)
+{
+    const struct symcache_header*       hdr = (const struct symcache_header*)image;
+    const char*                         sources;
+    const struct symcache_compiland*    compilands;
+    const struct symcache_symbol*       symbols;
+    const struct symcache_line*         lines;
+    const char*                         strings;
+    struct symt_compiland**             new_compilands = NULL;
+    unsigned*                           new_sources = NULL;
+    ULONGLONG                           total;
+    DWORD64                             base = module->module.BaseOfImage;
+    unsigned                            i, j, num;
+    BOOL                                ret = FALSE;
+
+    if (size < sizeof(*hdr) || hdr->magic != SYMCACHE_MAGIC || hdr->version != SYMCACHE_VERSION)
+        return FALSE;
+    if (hdr->options != (dbghelp_options & SYMCACHE_OPTIONS))
+    {
+        TRACE("cache built with different options (%x/%x)\n", hdr->options, dbghelp_options);
+        return FALSE;
+    }
+    total = sizeof(*hdr) + (((ULONGLONG)hdr->sources_size + 3) & ~3) +
+        (ULONGLONG)hdr->num_compilands * sizeof(*compilands) +
+        (ULONGLONG)hdr->num_symbols * sizeof(*symbols) +
+        (ULONGLONG)hdr->num_lines * sizeof(*lines) + hdr->strings_size;
+    if (total != size || !hdr->strings_size) return FALSE;
+
+    sources = (const char*)(hdr + 1);
+    compilands = (const struct symcache_compiland*)(sources + ((hdr->sources_size + 3) & ~3));
+    symbols = (const struct symcache_symbol*)(compilands + hdr->num_compilands);
+    lines = (const struct symcache_line*)(symbols + hdr->num_symbols);
+    strings = (const char*)(lines + hdr->num_lines);
+    if (strings[hdr->strings_size - 1] || (hdr->sources_size && sources[hdr->sources_size - 1]))
+        return FALSE;
+
+    /* check everything before adding anything to the module */
+    for (i = num = 0; i < hdr->sources_size; i += strlen(sources + i) + 1) num++;
+    if (num != hdr->num_sources) return FALSE;
+    for (i = 0; i < hdr->num_compilands; i++)
+        if (compilands[i].source != SYMCACHE_NONE && compilands[i].source >= hdr->num_sources)
+            return FALSE;
+    for (i = 0; i < hdr->num_lines; i++)
+        if (lines[i].source != SYMCACHE_NONE && lines[i].source >= hdr->num_sources)
+            return FALSE;
+    for (i = 0; i < hdr->num_symbols; i++)
+    {
+        if (symbols[i].name >= hdr->strings_size) return FALSE;
+        if (symbols[i].compiland != SYMCACHE_NONE && symbols[i].compiland >= hdr->num_compilands)
+            return FALSE;
+        switch (symbols[i].tag)
+        {
+        case SymTagFunction:
+            if (symbols[i].param > hdr->num_lines ||
+                symbols[i].num_lines > hdr->num_lines - symbols[i].param)
+                return FALSE;
+            break;
+        case SymTagPublicSymbol:
+        case SymTagThunk:
+            break;
+        default:
+            return FALSE;
+        }
+    }
+
+    new_sources = HeapAlloc(GetProcessHeap(), 0, (hdr->num_sources + 1) * sizeof(*new_sources));
+    new_compilands = HeapAlloc(GetProcessHeap(), 0, (hdr->num_compilands + 1) * sizeof(*new_compilands));
+    if (!new_sources || !new_compilands) goto done;
+
+    for (i = num = 0; i < hdr->sources_size; i += strlen(sources + i) + 1)
+        new_sources[num++] = source_new(module, NULL, sources + i);
+    for (i = 0; i < hdr->num_compilands; i++)
+        new_compilands[i] = symt_new_compiland(module,
+                                               compilands[i].rva == SYMCACHE_NONE ? 0 : base + compilands[i].rva,
+                                               compilands[i].source == SYMCACHE_NONE ? -1 : new_sources[compilands[i].source]);
+    for (i = 0; i < hdr->num_symbols; i++)
+    {
+        const struct symcache_symbol* sym = &symbols[i];
+        struct symt_compiland* compiland = sym->compiland == SYMCACHE_NONE ? NULL : new_compilands[sym->compiland];
+        struct symt_function* func;
+
+        switch (sym->tag)
+        {
+        case SymTagFunction:
+            func = symt_new_function(module, compiland, strings + sym->name, base + sym->rva, sym->size, NULL);
+            for (j = sym->param; j < sym->param + sym->num_lines; j++)
+                symt_add_func_line(module, func,
+                                   lines[j].source == SYMCACHE_NONE ? -1 : new_sources[lines[j].source],
+                                   lines[j].line_number, lines[j].offset);
+            if (func) symt_normalize_function(module, func);
+            break;
+        case SymTagPublicSymbol:
+            symt_new_public(module, compiland, strings + sym->name, base + sym->rva, sym->size);
+            break;
+        case SymTagThunk:
+            symt_new_thunk(module, compiland, strings + sym->name, (THUNK_ORDINAL)sym->param,
+                           base + sym->rva, sym->size);
+            break;
+        }
+    }
+
+    module->module.SymType = hdr->sym_type;
+    module->module.CVSig = hdr->cv_sig;
+    module->module.LineNumbers = (hdr->flags & SYMCACHE_LINE_NUMBERS) != 0;
+    module->module.GlobalSymbols = (hdr->flags & SYMCACHE_GLOBAL_SYMBOLS) != 0;
+    module->module.SourceIndexed = (hdr->flags & SYMCACHE_SOURCE_INDEXED) != 0;
+    module->module.Publics = (hdr->flags & SYMCACHE_PUBLICS) != 0;
+    module->module.TypeInfo = FALSE;
+    ret = TRUE;
+done:
+    HeapFree(GetProcessHeap(), 0, new_sources);
+    HeapFree(GetProcessHeap(), 0, new_compilands);
+    return ret;
+}
+
+/******************************************************************
+ *		symcache_load
+ *
+ * Loads the symbols of a module from the cache (if it's enabled, and
+ * a valid entry exists for the module's build-id)
+ */
+BOOL symcache_load(struct module* module, const BYTE* id, unsigned idlen)
+{
+    WCHAR*              filename;
+    unsigned            dirlen;
+    HANDLE              file, map;
+    const BYTE*         image;
+    LARGE_INTEGER       size;
+    BOOL                ret = FALSE;
+
+    if (!(filename = symcache_get_filename(id, idlen, &dirlen))) return FALSE;
+    file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                       OPEN_EXISTING, 0, NULL);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        if (GetFileSizeEx(file, &size) && !size.u.HighPart && size.u.LowPart &&
+            (map = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL)))
+        {
+            if ((image = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0)))
+            {
+                ret = symcache_load_image(module, image, size.u.LowPart);
+                UnmapViewOfFile(image);
+            }
+            CloseHandle(map);
+        }
+        CloseHandle(file);
+        if (!ret) WARN("Ignoring invalid cache %s\n", debugstr_w(filename));
+    }
+    TRACE("%s for %s: %s\n", debugstr_w(filename), debugstr_w(module->module.ModuleName),
+          ret ? "loaded" : "not loaded");
+    HeapFree(GetProcessHeap(), 0, filename);
+    return ret;
+}
+
+static int symcache_ptr_cmp(const void* p1, const void* p2)
+{
+    const void* ptr1 = *(const void* const*)p1;
+    const void* ptr2 = *(const void* const*)p2;
+
+    if (ptr1 < ptr2) return -1;
+    if (ptr1 > ptr2) return 1;
+    return 0;
+}
+
+static DWORD symcache_compiland_index(struct symt** compilands, unsigned num, const struct symt* compiland)
+{
+    struct symt** found;
+
+    if (!compiland) return SYMCACHE_NONE;
+    found = bsearch(&compiland, compilands, num, sizeof(*compilands), symcache_ptr_cmp);
+    return found ? found - compilands : SYMCACHE_NONE;
+}
+
+static DWORD symcache_source_index(const unsigned* sources, unsigned num, unsigned source)
+{
+    int low = 0, high = num, mid;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (sources[mid] == source) return mid;
+        if (sources[mid] < source) low = mid + 1;
+        else high = mid;
+    }
+    return SYMCACHE_NONE;
+}
+
+static BOOL symcache_get_symbol_info(const struct symt* sym, const char** name, unsigned long* address,
+                                     unsigned long* size, struct symt** container)
+{
+    switch (sym->tag)
+    {
+    case SymTagFunction:
+        {
+            const struct symt_function* func = (const struct symt_function*)sym;
+            *name = func->hash_elt.name;
+            *address = func->address;
+            *size = func->size;
+            *container = func->container;
+        }
+        return TRUE;
+    case SymTagPublicSymbol:
+        {
+            const struct symt_public* pub = (const struct symt_public*)sym;
+            *name = pub->hash_elt.name;
+            *address = pub->address;
+            *size = pub->size;
+            *container = pub->container;
+        }
+        return TRUE;
+    case SymTagThunk:
+        {
+            const struct symt_thunk* thunk = (const struct symt_thunk*)sym;
+            *name = thunk->hash_elt.name;
+            *address = thunk->address;
+            *size = thunk->size;
+            *container = thunk->container;
+        }
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static BOOL symcache_write(const WCHAR* filename, unsigned dirlen, const BYTE* image, DWORD size)
+{
+    static const WCHAR prefixW[] = {'d','b','g',0};
+    WCHAR*      dir;
+    WCHAR       tmp[MAX_PATH];
+    HANDLE      file;
+    DWORD       written;
+    BOOL        ret = FALSE;
+
+    if (!(dir = HeapAlloc(GetProcessHeap(), 0, (dirlen + 1) * sizeof(WCHAR)))) return FALSE;
+    memcpy(dir, filename, dirlen * sizeof(WCHAR));
+    dir[dirlen] = 0;
+    CreateDirectoryW(dir, NULL);
+    /* write to a temporary file first, so that concurrent users never see a partial cache */
+    if (GetTempFileNameW(dir, prefixW, 0, tmp))
+    {
+        file = CreateFileW(tmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            ret = WriteFile(file, image, size, &written, NULL) && written == size;
+            CloseHandle(file);
+            if (ret) ret = MoveFileExW(tmp, filename, MOVEFILE_REPLACE_EXISTING);
+        }
+        if (!ret) DeleteFileW(tmp);
+    }
+    HeapFree(GetProcessHeap(), 0, dir);
+    return ret;
+}
+
+/******************************************************************
+ *		symcache_save
+ *
+ * Stores the symbols of a module in the cache (if it's enabled)
+ */
+void symcache_save(struct module* module, const BYTE* id, unsigned idlen)
+{
+    WCHAR*                      filename;
+    unsigned                    dirlen;
+    struct hash_table_iter      hti;
+    void*                       ptr;
+    struct symt_ht**            syms = NULL;
+    struct symt**               compilands = NULL;
+    unsigned*                   sources = NULL;
+    unsigned                    num_syms = 0, max_syms = 256;
+    unsigned                    num_compilands = 0, num_sources = 0, sources_size = 0;
+    unsigned                    num_lines = 0, strings_size = 0;
+    unsigned                    i, j, k;
+    struct symcache_header*     hdr;
+    struct symcache_compiland*  cc;
+    struct symcache_symbol*     cs;
+    struct symcache_line*       cl;
+    char*                       strings;
+    BYTE*                       image = NULL;
+    DWORD                       size;
+    DWORD64                     base = module->module.BaseOfImage;
+    const char*                 name;
+    unsigned long               address, length;
+    struct symt*                container;
+
+    if (!(filename = symcache_get_filename(id, idlen, &dirlen))) return;
+
+    /* make sure everything is loaded */
+    dwarf2_load_all_units(module);
+
+    /* gather the symbols we keep, and their compilands */
+    if (!(syms = HeapAlloc(GetProcessHeap(), 0, max_syms * sizeof(*syms)))) goto done;
+    hash_table_iter_init(&module->ht_symbols, &hti, NULL);
+    while ((ptr = hash_table_iter_up(&hti)))
+    {
+        struct symt_ht* sym = CONTAINING_RECORD(ptr, struct symt_ht, hash_elt);
+
+        if (!symcache_get_symbol_info(&sym->symt, &name, &address, &length, &container) ||
+            address < base || address - base >= SYMCACHE_NONE)
+            continue;
+        if (num_syms == max_syms)
+        {
+            struct symt_ht** new;
+
+            if (!(new = HeapReAlloc(GetProcessHeap(), 0, syms, max_syms * 2 * sizeof(*syms)))) goto done;
+            syms = new;
+            max_syms *= 2;
+        }
+        syms[num_syms++] = sym;
+        strings_size += strlen(name) + 1;
+        if (sym->symt.tag == SymTagFunction)
+        {
+            const struct symt_function* func = (const struct symt_function*)sym;
+
+            for (j = 0; j < vector_length(&func->vlines); j++)
+                if (!((const struct line_info*)vector_at(&func->vlines, j))->is_source_file)
+                    num_lines++;
+        }
+    }
+    if (!num_syms) goto done;
+
+    if (!(compilands = HeapAlloc(GetProcessHeap(), 0, num_syms * sizeof(*compilands)))) goto done;
+    for (i = 0; i < num_syms; i++)
+    {
+        symcache_get_symbol_info(&syms[i]->symt, &name, &address, &length, &container);
+        if (container && container->tag == SymTagCompiland)
+            compilands[num_compilands++] = container;
+    }
+    qsort(compilands, num_compilands, sizeof(*compilands), symcache_ptr_cmp);
+    for (i = j = 0; i < num_compilands; i++)
+        if (!j || compilands[j - 1] != compilands[i]) compilands[j++] = compilands[i];
+    num_compilands = j;
+
+    /* source files are NUL terminated strings packed in module->sources */
+    if (module->sources)
+    {
+        for (i = 0; i < module->sources_used && module->sources[i]; i += strlen(module->sources + i) + 1)
+            num_sources++;
+        sources_size = i;
+        if (!(sources = HeapAlloc(GetProcessHeap(), 0, (num_sources + 1) * sizeof(*sources)))) goto done;
+        for (i = j = 0; i < sources_size; i += strlen(module->sources + i) + 1)
+            sources[j++] = i;
+    }
+
+    size = sizeof(*hdr) + ((sources_size + 3) & ~3) + num_compilands * sizeof(*cc) +
+        num_syms * sizeof(*cs) + num_lines * sizeof(*cl) + strings_size;
+    if (!(image = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size))) goto done;
+    hdr = (struct symcache_header*)image;
+    hdr->magic = SYMCACHE_MAGIC;
+    hdr->version = SYMCACHE_VERSION;
+    hdr->options = dbghelp_options & SYMCACHE_OPTIONS;
+    hdr->sym_type = module->module.SymType;
+    hdr->cv_sig = module->module.CVSig;
+    hdr->flags = (module->module.LineNumbers ? SYMCACHE_LINE_NUMBERS : 0) |
+        (module->module.GlobalSymbols ? SYMCACHE_GLOBAL_SYMBOLS : 0) |
+        (module->module.SourceIndexed ? SYMCACHE_SOURCE_INDEXED : 0) |
+        (module->module.Publics ? SYMCACHE_PUBLICS : 0);
+    hdr->num_sources = num_sources;
+    hdr->sources_size = sources_size;
+    hdr->num_compilands = num_compilands;
+    hdr->num_symbols = num_syms;
+    hdr->num_lines = num_lines;
+    hdr->strings_size = strings_size;
+    if (sources_size) memcpy(hdr + 1, module->sources, sources_size);
+    cc = (struct symcache_compiland*)((char*)(hdr + 1) + ((sources_size + 3) & ~3));
+    cs = (struct symcache_symbol*)(cc + num_compilands);
+    cl = (struct symcache_line*)(cs + num_syms);
+    strings = (char*)(cl + num_lines);
+
+    for (i = 0; i < num_compilands; i++)
+    {
+        const struct symt_compiland* compiland = (const struct symt_compiland*)compilands[i];
+
+        cc[i].source = symcache_source_index(sources, num_sources, compiland->source);
+        cc[i].rva = compiland->address >= base && compiland->address - base < SYMCACHE_NONE ?
+            compiland->address - base : SYMCACHE_NONE;
+    }
+    for (i = k = 0; i < num_syms; i++)
+    {
+        symcache_get_symbol_info(&syms[i]->symt, &name, &address, &length, &container);
+        cs[i].tag = syms[i]->symt.tag;
+        cs[i].name = strings - (char*)(cl + num_lines);
+        cs[i].rva = address - base;
+        cs[i].size = length;
+        cs[i].compiland = symcache_compiland_index(compilands, num_compilands, container);
+        strcpy(strings, name);
+        strings += strlen(name) + 1;
+        if (syms[i]->symt.tag == SymTagFunction)
+        {
+            const struct symt_function* func = (const struct symt_function*)syms[i];
+            DWORD source = SYMCACHE_NONE;
+
+            cs[i].param = k;
+            for (j = 0; j < vector_length(&func->vlines); j++)
+            {
+                const struct line_info* dli = vector_at(&func->vlines, j);
+
+                if (dli->is_source_file)
+                    source = symcache_source_index(sources, num_sources, dli->u.source_file);
+                else
+                {
+                    cl[k].source = source;
+                    cl[k].line_number = dli->line_number;
+                    cl[k].offset = dli->u.pc_offset - func->address;
+                    k++;
+                }
+            }
+            cs[i].num_lines = k - cs[i].param;
+        }
+        else if (syms[i]->symt.tag == SymTagThunk)
+            cs[i].param = ((const struct symt_thunk*)syms[i])->ordinal;
+    }
+
+    if (symcache_write(filename, dirlen, image, size))
+        TRACE("Stored %u symbols and %u lines of %s in %s\n", num_syms, num_lines,
+              debugstr_w(module->module.ModuleName), debugstr_w(filename));
+    else
+        WARN("Couldn't write %s\n", debugstr_w(filename));
+done:
+    HeapFree(GetProcessHeap(), 0, image);
+    HeapFree(GetProcessHeap(), 0, sources);
+    HeapFree(GetProcessHeap(), 0, compilands);
+    HeapFree(GetProcessHeap(), 0, syms);
+    HeapFree(GetProcessHeap(), 0, filename);
+}
@@ -906,7 +906,10 @@ BOOL WINAPI SymGetTypeInfo(HANDLE hProcess, DWORD64 ModBase,
     if (!pair.pcs) return FALSE;
 
     pair.requested = module_find_by_addr(pair.pcs, ModBase, DMT_UNKNOWN);
-    if (!module_get_debug(&pair))
+    /* TypeId comes from a symbol we've already handed out, so there's no need
+     * to load the debug information which is still deferred
+     */
+    if (!module_get_debug_at(&pair, ModBase))
     {
         FIXME("Someone didn't properly set ModBase (%s)\n", wine_dbgstr_longlong(ModBase));
         return FALSE;
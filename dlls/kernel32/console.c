@@ -2251,116 +2251,8 @@ BOOL WINAPI SetConsoleMode(HANDLE hcon, DWORD mode)
 }
 
 
-/******************************************************************
- *		CONSOLE_WriteChars
- *
- * WriteConsoleOutput helper: hides server call semantics
- * writes a string at a given pos with standard attribute
- */
-static int CONSOLE_WriteChars(HANDLE hCon, LPCWSTR lpBuffer, int nc, COORD* pos)
-{
-    int written = -1;
-
-    if (!nc) return 0;
-
-    SERVER_START_REQ( write_console_output )
-    {
-        req->handle = console_handle_unmap(hCon);
-        req->x      = pos->X;
-        req->y      = pos->Y;
-        req->mode   = CHAR_INFO_MODE_TEXTSTDATTR;
-        req->wrap   = FALSE;
-        wine_server_add_data( req, lpBuffer, nc * sizeof(WCHAR) );
-        if (!wine_server_call_err( req )) written = reply->written;
-    }
-    SERVER_END_REQ;
-
-    if (written > 0) pos->X += written;
-    return written;
-}
-
-/******************************************************************
- *		next_line
- *
- * WriteConsoleOutput helper: handles passing to next line (+scrolling if necessary)
- *
- */
-static BOOL next_line(HANDLE hCon, CONSOLE_SCREEN_BUFFER_INFO* csbi)
-{
-    SMALL_RECT	src;
-    CHAR_INFO	ci;
-    COORD	dst;
-
-    csbi->dwCursorPosition.X = 0;
-    csbi->dwCursorPosition.Y++;
-
-    if (csbi->dwCursorPosition.Y < csbi->dwSize.Y) return TRUE;
-
-    src.Top    = 1;
-    src.Bottom = csbi->dwSize.Y - 1;
-    src.Left   = 0;
-    src.Right  = csbi->dwSize.X - 1;
-
-    dst.X      = 0;
-    dst.Y      = 0;
-
-    ci.Attributes = csbi->wAttributes;
-    ci.Char.UnicodeChar = ' ';
-
-    csbi->dwCursorPosition.Y--;
-    if (!ScrollConsoleScreenBufferW(hCon, &src, NULL, dst, &ci))
-        return FALSE;
-    return TRUE;
-}
-
-/******************************************************************
- *		write_block
- *
- * WriteConsoleOutput helper: writes a block of non special characters
- * Block can spread on several lines, and wrapping, if needed, is
- * handled
- *
- */
-static BOOL write_block(HANDLE hCon, CONSOLE_SCREEN_BUFFER_INFO* csbi,
-                        DWORD mode, LPCWSTR ptr, int len)
-{
-    int	blk;	/* number of chars to write on current line */
-    int done;   /* number of chars already written */
-
-    if (len <= 0) return TRUE;
-
-    if (mode & ENABLE_WRAP_AT_EOL_OUTPUT) /* writes remaining on next line */
-    {
-        for (done = 0; done < len; done += blk)
-        {
-            blk = min(len - done, csbi->dwSize.X - csbi->dwCursorPosition.X);
-
-            if (CONSOLE_WriteChars(hCon, ptr + done, blk, &csbi->dwCursorPosition) != blk)
-                return FALSE;
-            if (csbi->dwCursorPosition.X == csbi->dwSize.X && !next_line(hCon, csbi))
-                return FALSE;
-        }
-    }
-    else
-    {
-        int     pos = csbi->dwCursorPosition.X;
-        /* FIXME: we could reduce the number of loops
-         * but, in most cases we wouldn't gain lots of time (it would only
-         * happen if we're asked to overwrite more than twice the part of the line,
-         * which is unlikely
-         */
-        for (done = 0; done < len; done += blk)
-        {
-            blk = min(len - done, csbi->dwSize.X - csbi->dwCursorPosition.X);
-
-            csbi->dwCursorPosition.X = pos;
-            if (CONSOLE_WriteChars(hCon, ptr + done, blk, &csbi->dwCursorPosition) != blk)
-                return FALSE;
-        }
-    }
-
-    return TRUE;
-}
+/* maximum number of characters sent to the server in a single request */
+#define MAX_WRITE_CHARS 16384
 
 /***********************************************************************
  *            WriteConsoleW   (KERNEL32.@)
@@ -2368,11 +2260,10 @@ static BOOL write_block(HANDLE hCon, CONSOLE_SCREEN_BUFFER_INFO* csbi,
 BOOL WINAPI WriteConsoleW(HANDLE hConsoleOutput, LPCVOID lpBuffer, DWORD nNumberOfCharsToWrite,
 			  LPDWORD lpNumberOfCharsWritten, LPVOID lpReserved)
 {
-    DWORD			mode;
     DWORD			nw = 0;
     const WCHAR*		psz = lpBuffer;
-    CONSOLE_SCREEN_BUFFER_INFO	csbi;
-    int				k, first = 0, fd;
+    int				fd;
+    BOOL			ret;
 
     TRACE("%p %s %d %p %p\n",
 	  hConsoleOutput, debugstr_wn(lpBuffer, nNumberOfCharsToWrite),
@@ -2421,72 +2312,31 @@ BOOL WINAPI WriteConsoleW(HANDLE hConsoleOutput, LPCVOID lpBuffer, DWORD nNumber
         return TRUE;
     }
 
-    if (!GetConsoleMode(hConsoleOutput, &mode) || !GetConsoleScreenBufferInfo(hConsoleOutput, &csbi))
-	return FALSE;
-
-    if (!nNumberOfCharsToWrite) return TRUE;
-
-    if (mode & ENABLE_PROCESSED_OUTPUT)
+    /* the server handles the control characters and wrapping according to the output mode */
+    do
     {
-	unsigned int	i;
+        DWORD count = min( nNumberOfCharsToWrite - nw, MAX_WRITE_CHARS );
+        unsigned int bells = 0;
 
-	for (i = 0; i < nNumberOfCharsToWrite; i++)
-	{
-	    switch (psz[i])
-	    {
-	    case '\b': case '\t': case '\n': case '\a': case '\r':
-		/* don't handle here the i-th char... done below */
-		if ((k = i - first) > 0)
-		{
-		    if (!write_block(hConsoleOutput, &csbi, mode, &psz[first], k))
-			goto the_end;
-		    nw += k;
-		}
-		first = i + 1;
-		nw++;
-	    }
-	    switch (psz[i])
-	    {
-	    case '\b':
-		if (csbi.dwCursorPosition.X > 0) csbi.dwCursorPosition.X--;
-		break;
-	    case '\t':
-	        {
-		    static const WCHAR tmp[] = {' ',' ',' ',' ',' ',' ',' ',' '};
-		    if (!write_block(hConsoleOutput, &csbi, mode, tmp,
-				     ((csbi.dwCursorPosition.X + 8) & ~7) - csbi.dwCursorPosition.X))
-			goto the_end;
-		}
-		break;
-	    case '\n':
-		next_line(hConsoleOutput, &csbi);
-		break;
- 	    case '\a':
-		Beep(400, 300);
- 		break;
-	    case '\r':
-		csbi.dwCursorPosition.X = 0;
-		break;
-	    default:
-		break;
-	    }
-	}
-    }
+        SERVER_START_REQ( write_console_text )
+        {
+            req->handle = console_handle_unmap(hConsoleOutput);
+            wine_server_add_data( req, psz + nw, count * sizeof(WCHAR) );
+            if ((ret = !wine_server_call_err( req )))
+            {
+                count = reply->written;
+                bells = reply->bells;
+            }
+        }
+        SERVER_END_REQ;
+        if (!ret || !count) break;
 
-    /* write the remaining block (if any) if processed output is enabled, or the
-     * entire buffer otherwise
-     */
-    if ((k = nNumberOfCharsToWrite - first) > 0)
-    {
-	if (!write_block(hConsoleOutput, &csbi, mode, &psz[first], k))
-	    goto the_end;
-	nw += k;
-    }
+        nw += count;
+        while (bells--) Beep(400, 300);
+    } while (nw < nNumberOfCharsToWrite);
 
- the_end:
-    SetConsoleCursorPosition(hConsoleOutput, csbi.dwCursorPosition);
     if (lpNumberOfCharsWritten) *lpNumberOfCharsWritten = nw;
-    return nw != 0;
+    return ret || nw;
 }
 
 
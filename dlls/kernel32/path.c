@@ -27,6 +27,15 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdarg.h>
+#ifdef HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #include "winerror.h"
 #include "ntstatus.h"
@@ -1103,6 +1112,75 @@ BOOL WINAPI CopyFileA( LPCSTR source, LPCSTR dest, BOOL fail_if_exists)
 }
 
 
+/* chunk sizes used when the kernel copies the data for us */
+#define COPY_CHUNK_MIN  (1024 * 1024)
+#define COPY_CHUNK_MAX  (64 * 1024 * 1024)
+
+#if defined(__linux__) && !defined(FICLONE)
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+static BOOL copy_file_range_disabled;
+
+/* share the source extents with the destination; only possible on the same filesystem */
+static BOOL clone_file_data( int fd_src, int fd_dst )
+{
+#if defined(__linux__) && defined(HAVE_SYS_IOCTL_H)
+    if (!ioctl( fd_dst, FICLONE, fd_src )) return TRUE;
+    TRACE( "FICLONE failed: %s\n", strerror(errno) );
+#endif
+    return FALSE;
+}
+
+/* copy up to size bytes at the current file positions without going through user space;
+ * returns -1 with errno set to ENOSYS if no kernel method works for these files */
+static ssize_t copy_file_data( int fd_src, int fd_dst, size_t size )
+{
+#ifdef __linux__
+    ssize_t ret;
+
+#ifdef __NR_copy_file_range
+    if (!copy_file_range_disabled)
+    {
+        if ((ret = syscall( __NR_copy_file_range, fd_src, NULL, fd_dst, NULL, size, 0 )) >= 0) return ret;
+        if (errno != ENOSYS && errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP) return -1;
+        if (errno == ENOSYS) copy_file_range_disabled = TRUE;
+        TRACE( "copy_file_range failed: %s\n", strerror(errno) );
+    }
+#endif
+    if ((ret = sendfile( fd_dst, fd_src, NULL, min( size, 0x7ffff000 ) )) >= 0) return ret;
+    if (errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP) return -1;
+    TRACE( "sendfile failed: %s\n", strerror(errno) );
+#endif
+    errno = ENOSYS;
+    return -1;
+}
+
+/* call the progress routine, returns FALSE if the copy must be aborted */
+static BOOL copy_progress( LPPROGRESS_ROUTINE *progress, void *param, DWORD reason, HANDLE h1, HANDLE h2,
+                           ULONGLONG total, ULONGLONG transferred, BOOL *delete_dest )
+{
+    LARGE_INTEGER size, done;
+
+    if (!*progress) return TRUE;
+    size.QuadPart = total;
+    done.QuadPart = transferred;
+    switch ((*progress)( size, done, size, done, 1, reason, h1, h2, param ))
+    {
+    case PROGRESS_CONTINUE:
+        return TRUE;
+    case PROGRESS_QUIET:
+        *progress = NULL;
+        return TRUE;
+    case PROGRESS_CANCEL:
+        *delete_dest = TRUE;
+        /* fall through */
+    default:
+        SetLastError( ERROR_REQUEST_ABORTED );
+        return FALSE;
+    }
+}
+
 /**************************************************************************
  *           CopyFileExW   (KERNEL32.@)
  */
@@ -1113,20 +1191,18 @@ BOOL WINAPI CopyFileExW(LPCWSTR source, LPCWSTR dest,
     static const int buffer_size = 65536;
     HANDLE h1, h2;
     BY_HANDLE_FILE_INFORMATION info;
-    DWORD count;
-    BOOL ret = FALSE;
-    char *buffer;
+    DWORD count, access, start = 0;
+    ULONGLONG total, transferred = 0;
+    size_t chunk = (progress || cancel_ptr) ? COPY_CHUNK_MIN : COPY_CHUNK_MAX;
+    int fd1 = -1, fd2 = -1;
+    BOOL ret = FALSE, delete_dest = FALSE;
+    char *buffer = NULL;
 
     if (!source || !dest)
     {
         SetLastError(ERROR_INVALID_PARAMETER);
         return FALSE;
     }
-    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size )))
-    {
-        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
-        return FALSE;
-    }
 
     TRACE("%s -> %s, %x\n", debugstr_w(source), debugstr_w(dest), flags);
 
@@ -1135,17 +1211,16 @@ BOOL WINAPI CopyFileExW(LPCWSTR source, LPCWSTR dest,
                      NULL, OPEN_EXISTING, 0, 0)) == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open source %s\n", debugstr_w(source));
-        HeapFree( GetProcessHeap(), 0, buffer );
         return FALSE;
     }
 
     if (!GetFileInformationByHandle( h1, &info ))
     {
         WARN("GetFileInformationByHandle returned error for %s\n", debugstr_w(source));
-        HeapFree( GetProcessHeap(), 0, buffer );
         CloseHandle( h1 );
         return FALSE;
     }
+    total = ((ULONGLONG)info.nFileSizeHigh << 32) | info.nFileSizeLow;
 
     if (!(flags & COPY_FILE_FAIL_IF_EXISTS))
     {
@@ -1159,38 +1234,125 @@ BOOL WINAPI CopyFileExW(LPCWSTR source, LPCWSTR dest,
         }
         if (same_file)
         {
-            HeapFree( GetProcessHeap(), 0, buffer );
             CloseHandle( h1 );
             SetLastError( ERROR_SHARING_VIOLATION );
             return FALSE;
         }
     }
 
-    if ((h2 = CreateFileW( dest, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
-                             (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
-                             info.dwFileAttributes, h1 )) == INVALID_HANDLE_VALUE)
+    /* a cancelled copy removes the destination, if it can be opened for deletion */
+    access = GENERIC_WRITE;
+    if (progress || cancel_ptr) access |= DELETE;
+    for (;;)
+    {
+        h2 = CreateFileW( dest, access, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                          (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                          info.dwFileAttributes, h1 );
+        if (h2 != INVALID_HANDLE_VALUE || !(access & DELETE)) break;
+        if (GetLastError() != ERROR_SHARING_VIOLATION && GetLastError() != ERROR_ACCESS_DENIED) break;
+        access &= ~DELETE;
+    }
+    if (h2 == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open dest %s\n", debugstr_w(dest));
-        HeapFree( GetProcessHeap(), 0, buffer );
         CloseHandle( h1 );
         return FALSE;
     }
 
-    while (ReadFile( h1, buffer, buffer_size, &count, NULL ) && count)
+    if (!copy_progress( &progress, param, CALLBACK_STREAM_SWITCH, h1, h2, total, 0, &delete_dest ))
+        goto done;
+
+    /* let the kernel copy the data if both files are regular files */
+    if (wine_server_handle_to_fd( h1, FILE_READ_DATA, &fd1, NULL )) fd1 = -1;
+    else if (wine_server_handle_to_fd( h2, FILE_WRITE_DATA, &fd2, NULL )) fd2 = -1;
+    if (fd2 != -1)
+    {
+        struct stat st1, st2;
+
+        if (fstat( fd1, &st1 ) || fstat( fd2, &st2 ) || !S_ISREG(st1.st_mode) || !S_ISREG(st2.st_mode))
+        {
+            wine_server_release_fd( h2, fd2 );
+            fd2 = -1;
+        }
+        else if (total && clone_file_data( fd1, fd2 ))
+        {
+            transferred = total;
+            ret = copy_progress( &progress, param, CALLBACK_CHUNK_FINISHED, h1, h2,
+                                 total, transferred, &delete_dest );
+            goto done;
+        }
+    }
+
+    for (;;)
     {
-        char *p = buffer;
-        while (count != 0)
+        if (cancel_ptr && *cancel_ptr)
+        {
+            SetLastError( ERROR_REQUEST_ABORTED );
+            delete_dest = TRUE;
+            goto done;
+        }
+
+        if (fd2 != -1)
+        {
+            ssize_t res;
+
+            if (progress || cancel_ptr) start = GetTickCount();
+            if ((res = copy_file_data( fd1, fd2, chunk )) > 0) count = res;
+            else if (res == -1 && errno != ENOSYS)
+            {
+                FILE_SetDosError();
+                goto done;
+            }
+            else if (!res && transferred >= total) break;
+            else  /* not supported, or the file size is not reliable; use the read loop */
+            {
+                wine_server_release_fd( h2, fd2 );
+                fd2 = -1;
+                continue;
+            }
+        }
+        else
+        {
+            char *p = buffer;
+            DWORD res, left;
+
+            if (!buffer && !(p = buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size )))
+            {
+                SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+                goto done;
+            }
+            if (!ReadFile( h1, buffer, buffer_size, &count, NULL ) || !count) break;
+            for (left = count; left; left -= res, p += res)
+                if (!WriteFile( h2, p, left, &res, NULL ) || !res) goto done;
+        }
+        transferred += count;
+
+        /* keep callbacks regular by sizing the kernel copies after their duration */
+        if (fd2 != -1 && (progress || cancel_ptr))
         {
-            DWORD res;
-            if (!WriteFile( h2, p, count, &res, NULL ) || !res) goto done;
-            p += res;
-            count -= res;
+            DWORD elapsed = GetTickCount() - start;
+            if (elapsed < 100 && chunk < COPY_CHUNK_MAX) chunk *= 2;
+            else if (elapsed > 500 && chunk > COPY_CHUNK_MIN) chunk /= 2;
         }
+
+        if (!copy_progress( &progress, param, CALLBACK_CHUNK_FINISHED, h1, h2,
+                            max( total, transferred ), transferred, &delete_dest ))
+            goto done;
     }
     ret =  TRUE;
 done:
+    if (fd2 != -1) wine_server_release_fd( h2, fd2 );
+    if (fd1 != -1) wine_server_release_fd( h1, fd1 );
+    if (delete_dest && (access & DELETE))
+    {
+        FILE_DISPOSITION_INFORMATION disp;
+        IO_STATUS_BLOCK io;
+
+        disp.DoDeleteFile = TRUE;
+        NtSetInformationFile( h2, &io, &disp, sizeof(disp), FileDispositionInformation );
+    }
     /* Maintain the timestamp of source file to destination file */
-    SetFileTime(h2, NULL, NULL, &info.ftLastWriteTime);
+    else SetFileTime(h2, NULL, NULL, &info.ftLastWriteTime);
     HeapFree( GetProcessHeap(), 0, buffer );
     CloseHandle( h1 );
     CloseHandle( h2 );
@@ -24,6 +24,7 @@
 
 #include <string.h>
 #include <stdarg.h>
+#include <stdlib.h>
 
 #include "windef.h"
 #include "winbase.h"
@@ -61,20 +62,35 @@ typedef struct tagPROFILESECTION
 } PROFILESECTION;
 
 
+/* index entry for the first section of each name, and for the first key of each name in it */
+typedef struct
+{
+    DWORD            hash;
+    PROFILESECTION  *section;   /* NULL for a free entry */
+    PROFILEKEY      *key;       /* NULL for the section entry */
+} PROFILEINDEX;
+
 typedef struct
 {
     BOOL             changed;
     PROFILESECTION  *section;
     WCHAR           *filename;
+    DWORD            name_hash;
     FILETIME LastWriteTime;
     ENCODING encoding;
+    PROFILEINDEX    *index;
+    UINT             index_size;
 } PROFILE;
 
 
-#define N_CACHED_PROFILES 10
+/* number of cached profile files, can be changed with WINEPROFILECACHE */
+#define N_CACHED_PROFILES   32
+#define MAX_CACHED_PROFILES 256
+
+static int profile_cache_size;
 
 /* Cached profile files */
-static PROFILE *MRUProfile[N_CACHED_PROFILES]={NULL};
+static PROFILE *MRUProfile[MAX_CACHED_PROFILES]={NULL};
 
 #define CurProfile (MRUProfile[0])
 
@@ -267,6 +283,18 @@ static void PROFILE_Free( PROFILESECTION *section )
     }
 }
 
+/***********************************************************************
+ *           PROFILE_FreeIndex
+ *
+ * Free the lookup index of a profile, must be called when sections or keys are added or removed.
+ */
+static void PROFILE_FreeIndex( PROFILE *profile )
+{
+    HeapFree( GetProcessHeap(), 0, profile->index );
+    profile->index = NULL;
+    profile->index_size = 0;
+}
+
 /* returns TRUE if a whitespace character, else FALSE */
 static inline BOOL PROFILE_isspaceW(WCHAR c)
 {
@@ -274,6 +302,28 @@ static inline BOOL PROFILE_isspaceW(WCHAR c)
 	return isspaceW(c) || c == 0x1a;
 }
 
+/* case-insensitive hash of the first len characters of a name */
+static inline DWORD PROFILE_Hash( DWORD hash, LPCWSTR name, int len )
+{
+    while (len--) hash = hash * 31 + tolowerW( *name++ );
+    return hash;
+}
+
+/* skip the leading spaces of a name and return its length without the trailing spaces */
+static int PROFILE_TrimName( LPCWSTR *name )
+{
+    LPCWSTR p;
+
+    while (PROFILE_isspaceW(**name)) (*name)++;
+    if (**name)
+        p = *name + strlenW(*name) - 1;
+    else
+        p = *name;
+
+    while ((p > *name) && PROFILE_isspaceW(*p)) p--;
+    return p - *name + 1;
+}
+
 static inline ENCODING PROFILE_DetectTextEncoding(const void * buffer, int * len)
 {
     int flags = IS_TEXT_UNICODE_SIGNATURE |
@@ -554,6 +604,8 @@ static BOOL PROFILE_DeleteKey( PROFILESECTION **section,
 static void PROFILE_DeleteAllKeys( LPCWSTR section_name)
 {
     PROFILESECTION **section= &CurProfile->section;
+
+    PROFILE_FreeIndex( CurProfile );
     while (*section)
     {
         if ((*section)->name[0] && !strcmpiW( (*section)->name, section_name ))
@@ -581,26 +633,8 @@ static void PROFILE_DeleteAllKeys( LPCWSTR section_name)
 static PROFILEKEY *PROFILE_Find( PROFILESECTION **section, LPCWSTR section_name,
                                  LPCWSTR key_name, BOOL create, BOOL create_always )
 {
-    LPCWSTR p;
-    int seclen, keylen;
-
-    while (PROFILE_isspaceW(*section_name)) section_name++;
-    if (*section_name)
-        p = section_name + strlenW(section_name) - 1;
-    else
-        p = section_name;
-
-    while ((p > section_name) && PROFILE_isspaceW(*p)) p--;
-    seclen = p - section_name + 1;
-
-    while (PROFILE_isspaceW(*key_name)) key_name++;
-    if (*key_name)
-        p = key_name + strlenW(key_name) - 1;
-    else
-        p = key_name;
-
-    while ((p > key_name) && PROFILE_isspaceW(*p)) p--;
-    keylen = p - key_name + 1;
+    int seclen = PROFILE_TrimName( &section_name );
+    int keylen = PROFILE_TrimName( &key_name );
 
     while (*section)
     {
@@ -653,6 +687,137 @@ static PROFILEKEY *PROFILE_Find( PROFILESECTION **section, LPCWSTR section_name,
 }
 
 
+/***********************************************************************
+ *           PROFILE_LookupIndex
+ *
+ * Find the index entry of a section, or of a key in it if key_name is not NULL.
+ * The names must be trimmed already.
+ */
+static PROFILEINDEX *PROFILE_LookupIndex( PROFILE *profile, DWORD hash, LPCWSTR section_name, int seclen,
+                                          LPCWSTR key_name, int keylen )
+{
+    UINT pos;
+
+    for (pos = hash & (profile->index_size - 1); profile->index[pos].section;
+         pos = (pos + 1) & (profile->index_size - 1))
+    {
+        PROFILEINDEX *entry = &profile->index[pos];
+
+        if (entry->hash != hash || !entry->key != !key_name) continue;
+        if (strncmpiW( entry->section->name, section_name, seclen ) || entry->section->name[seclen]) continue;
+        if (key_name && (strncmpiW( entry->key->name, key_name, keylen ) || entry->key->name[keylen])) continue;
+        return entry;
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           PROFILE_AddIndex
+ */
+static void PROFILE_AddIndex( PROFILE *profile, DWORD hash, PROFILESECTION *section, PROFILEKEY *key )
+{
+    UINT pos = hash & (profile->index_size - 1);
+
+    while (profile->index[pos].section) pos = (pos + 1) & (profile->index_size - 1);
+    profile->index[pos].hash    = hash;
+    profile->index[pos].section = section;
+    profile->index[pos].key     = key;
+}
+
+
+/***********************************************************************
+ *           PROFILE_BuildIndex
+ *
+ * Index the sections and keys that PROFILE_Find can return, that is the
+ * first section of each name, and the first key of each name in it.
+ */
+static BOOL PROFILE_BuildIndex( PROFILE *profile )
+{
+    PROFILESECTION *section;
+    PROFILEKEY *key;
+    UINT count = 0;
+    DWORD hash;
+    int len;
+
+    for (section = profile->section; section; section = section->next)
+        for (count++, key = section->key; key; key = key->next) count++;
+
+    for (profile->index_size = 16; profile->index_size < 2 * count; profile->index_size *= 2);
+    if (!(profile->index = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                      profile->index_size * sizeof(*profile->index) )))
+    {
+        profile->index_size = 0;
+        return FALSE;
+    }
+
+    for (section = profile->section; section; section = section->next)
+    {
+        if (!section->name[0]) continue;
+        len = strlenW( section->name );
+        hash = PROFILE_Hash( 0, section->name, len );
+        if (PROFILE_LookupIndex( profile, hash, section->name, len, NULL, 0 )) continue;
+        PROFILE_AddIndex( profile, hash, section, NULL );
+
+        for (key = section->key; key; key = key->next)
+        {
+            DWORD key_hash = PROFILE_Hash( hash + 1, key->name, strlenW( key->name ));
+            if (PROFILE_LookupIndex( profile, key_hash, section->name, len, key->name, strlenW( key->name )))
+                continue;
+            PROFILE_AddIndex( profile, key_hash, section, key );
+        }
+    }
+    TRACE( "indexed %u entries for %s\n", count, debugstr_w(profile->filename) );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           PROFILE_FindSection
+ *
+ * Find the first section of a given name in the current profile.
+ */
+static PROFILESECTION *PROFILE_FindSection( LPCWSTR section_name )
+{
+    PROFILESECTION *section;
+    PROFILEINDEX *entry;
+    int len = strlenW( section_name );
+
+    if (len && (CurProfile->index || PROFILE_BuildIndex( CurProfile )))
+    {
+        entry = PROFILE_LookupIndex( CurProfile, PROFILE_Hash( 0, section_name, len ),
+                                     section_name, len, NULL, 0 );
+        return entry ? entry->section : NULL;
+    }
+
+    for (section = CurProfile->section; section; section = section->next)
+        if (section->name[0] && !strcmpiW( section->name, section_name )) return section;
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           PROFILE_FindKey
+ *
+ * Find a key in the current profile, without creating it.
+ */
+static PROFILEKEY *PROFILE_FindKey( LPCWSTR section_name, LPCWSTR key_name )
+{
+    LPCWSTR section_trimmed = section_name, key_trimmed = key_name;
+    int seclen = PROFILE_TrimName( &section_trimmed );
+    int keylen = PROFILE_TrimName( &key_trimmed );
+    PROFILEINDEX *entry;
+    DWORD hash;
+
+    if (!*section_trimmed || !*key_trimmed || (!CurProfile->index && !PROFILE_BuildIndex( CurProfile )))
+        return PROFILE_Find( &CurProfile->section, section_name, key_name, FALSE, FALSE );
+
+    hash = PROFILE_Hash( PROFILE_Hash( 0, section_trimmed, seclen ) + 1, key_trimmed, keylen );
+    entry = PROFILE_LookupIndex( CurProfile, hash, section_trimmed, seclen, key_trimmed, keylen );
+    return entry ? entry->key : NULL;
+}
+
+
 /***********************************************************************
  *           PROFILE_FlushFile
  *
@@ -698,6 +863,7 @@ static BOOL PROFILE_FlushFile(void)
 static void PROFILE_ReleaseFile(void)
 {
     PROFILE_FlushFile();
+    PROFILE_FreeIndex( CurProfile );
     PROFILE_Free( CurProfile->section );
     HeapFree( GetProcessHeap(), 0, CurProfile->filename );
     CurProfile->changed = FALSE;
@@ -737,6 +903,8 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
     WCHAR buffer[MAX_PATH];
     HANDLE hFile = INVALID_HANDLE_VALUE;
     FILETIME LastWriteTime;
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    DWORD hash;
     int i,j;
     PROFILE *tempProfile;
     
@@ -745,16 +913,21 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
     /* First time around */
 
     if(!CurProfile)
-       for(i=0;i<N_CACHED_PROFILES;i++)
+    {
+       const char *env = getenv( "WINEPROFILECACHE" );
+
+       profile_cache_size = env ? atoi( env ) : N_CACHED_PROFILES;
+       if (profile_cache_size < 1) profile_cache_size = 1;
+       if (profile_cache_size > MAX_CACHED_PROFILES) profile_cache_size = MAX_CACHED_PROFILES;
+       for(i=0;i<profile_cache_size;i++)
        {
-          MRUProfile[i]=HeapAlloc( GetProcessHeap(), 0, sizeof(PROFILE) );
+          MRUProfile[i]=HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(PROFILE) );
           if(MRUProfile[i] == NULL) break;
-          MRUProfile[i]->changed=FALSE;
-          MRUProfile[i]->section=NULL;
-          MRUProfile[i]->filename=NULL;
           MRUProfile[i]->encoding=ENCODING_ANSI;
-          ZeroMemory(&MRUProfile[i]->LastWriteTime, sizeof(FILETIME));
        }
+       if (!i) return FALSE;
+       profile_cache_size = i;
+    }
 
     if (!filename)
 	filename = wininiW;
@@ -777,6 +950,30 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
         
     TRACE("path: %s\n", debugstr_w(buffer));
 
+    hash = PROFILE_Hash( 0, buffer, strlenW(buffer) );
+    for (i = 0; i < profile_cache_size; i++)
+        if (MRUProfile[i]->filename && MRUProfile[i]->name_hash == hash &&
+            !strcmpiW( buffer, MRUProfile[i]->filename )) break;
+
+    /* checking the attributes is enough to validate a cached file, there is no need to open it */
+    if (i < profile_cache_size && !write_access &&
+        GetFileAttributesExW( buffer, GetFileExInfoStandard, &data ) &&
+        !(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+        !memcmp( &MRUProfile[i]->LastWriteTime, &data.ftLastWriteTime, sizeof(FILETIME) ) &&
+        is_not_current( &data.ftLastWriteTime ))
+    {
+        if(i)
+        {
+            PROFILE_FlushFile();
+            tempProfile=MRUProfile[i];
+            for(j=i;j>0;j--)
+                MRUProfile[j]=MRUProfile[j-1];
+            CurProfile=tempProfile;
+        }
+        TRACE("(%s): already opened, unchanged (mru=%d)\n", debugstr_w(buffer), i);
+        return TRUE;
+    }
+
     hFile = CreateFileW(buffer, GENERIC_READ | (write_access ? GENERIC_WRITE : 0),
                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
@@ -787,51 +984,49 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
         return FALSE;
     }
 
-    for(i=0;i<N_CACHED_PROFILES;i++)
+    if (i < profile_cache_size)
     {
-        if ((MRUProfile[i]->filename && !strcmpiW( buffer, MRUProfile[i]->filename )))
+        TRACE("MRU Filename: %s, new filename: %s\n", debugstr_w(MRUProfile[i]->filename), debugstr_w(buffer));
+        if(i)
         {
-            TRACE("MRU Filename: %s, new filename: %s\n", debugstr_w(MRUProfile[i]->filename), debugstr_w(buffer));
-            if(i)
-            {
-                PROFILE_FlushFile();
-                tempProfile=MRUProfile[i];
-                for(j=i;j>0;j--)
-                    MRUProfile[j]=MRUProfile[j-1];
-                CurProfile=tempProfile;
-            }
+            PROFILE_FlushFile();
+            tempProfile=MRUProfile[i];
+            for(j=i;j>0;j--)
+                MRUProfile[j]=MRUProfile[j-1];
+            CurProfile=tempProfile;
+        }
 
-            if (hFile != INVALID_HANDLE_VALUE)
+        if (hFile != INVALID_HANDLE_VALUE)
+        {
+            GetFileTime(hFile, NULL, NULL, &LastWriteTime);
+            if (!memcmp( &CurProfile->LastWriteTime, &LastWriteTime, sizeof(FILETIME) ) &&
+                is_not_current(&LastWriteTime))
+                TRACE("(%s): already opened (mru=%d)\n",
+                      debugstr_w(buffer), i);
+            else
             {
-                GetFileTime(hFile, NULL, NULL, &LastWriteTime);
-                if (!memcmp( &CurProfile->LastWriteTime, &LastWriteTime, sizeof(FILETIME) ) &&
-                    is_not_current(&LastWriteTime))
-                    TRACE("(%s): already opened (mru=%d)\n",
-                          debugstr_w(buffer), i);
-                else
-                {
-                    TRACE("(%s): already opened, needs refreshing (mru=%d)\n",
-                          debugstr_w(buffer), i);
-                    PROFILE_Free(CurProfile->section);
-                    CurProfile->section = PROFILE_Load(hFile, &CurProfile->encoding);
-                    CurProfile->LastWriteTime = LastWriteTime;
-                }
-                CloseHandle(hFile);
-                return TRUE;
+                TRACE("(%s): already opened, needs refreshing (mru=%d)\n",
+                      debugstr_w(buffer), i);
+                PROFILE_FreeIndex(CurProfile);
+                PROFILE_Free(CurProfile->section);
+                CurProfile->section = PROFILE_Load(hFile, &CurProfile->encoding);
+                CurProfile->LastWriteTime = LastWriteTime;
             }
-            else TRACE("(%s): already opened, not yet created (mru=%d)\n",
-                       debugstr_w(buffer), i);
+            CloseHandle(hFile);
+            return TRUE;
         }
+        else TRACE("(%s): already opened, not yet created (mru=%d)\n",
+                   debugstr_w(buffer), i);
     }
 
     /* Flush the old current profile */
     PROFILE_FlushFile();
 
     /* Make the oldest profile the current one only in order to get rid of it */
-    if(i==N_CACHED_PROFILES)
+    if(i==profile_cache_size)
       {
-       tempProfile=MRUProfile[N_CACHED_PROFILES-1];
-       for(i=N_CACHED_PROFILES-1;i>0;i--)
+       tempProfile=MRUProfile[profile_cache_size-1];
+       for(i=profile_cache_size-1;i>0;i--)
           MRUProfile[i]=MRUProfile[i-1];
        CurProfile=tempProfile;
       }
@@ -840,6 +1035,7 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
     /* OK, now that CurProfile is definitely free we assign it our new file */
     CurProfile->filename  = HeapAlloc( GetProcessHeap(), 0, (strlenW(buffer)+1) * sizeof(WCHAR) );
     strcpyW( CurProfile->filename, buffer );
+    CurProfile->name_hash = hash;
 
     if (hFile != INVALID_HANDLE_VALUE)
     {
@@ -862,52 +1058,48 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
  * Returns all keys of a section.
  * If return_values is TRUE, also include the corresponding values.
  */
-static INT PROFILE_GetSection( PROFILESECTION *section, LPCWSTR section_name,
-			       LPWSTR buffer, UINT len, BOOL return_values )
+static INT PROFILE_GetSection( LPCWSTR section_name, LPWSTR buffer, UINT len, BOOL return_values )
 {
+    PROFILESECTION *section;
     PROFILEKEY *key;
 
     if(!buffer) return 0;
 
     TRACE("%s,%p,%u\n", debugstr_w(section_name), buffer, len);
 
-    while (section)
+    if ((section = PROFILE_FindSection( section_name )))
     {
-        if (section->name[0] && !strcmpiW( section->name, section_name ))
+        UINT oldlen = len;
+        for (key = section->key; key; key = key->next)
         {
-            UINT oldlen = len;
-            for (key = section->key; key; key = key->next)
-            {
-                if (len <= 2) break;
-                if (!*key->name) continue;  /* Skip empty lines */
-                if (IS_ENTRY_COMMENT(key->name)) continue;  /* Skip comments */
-                if (!return_values && !key->value) continue;  /* Skip lines w.o. '=' */
-                PROFILE_CopyEntry( buffer, key->name, len - 1, 0 );
+            if (len <= 2) break;
+            if (!*key->name) continue;  /* Skip empty lines */
+            if (IS_ENTRY_COMMENT(key->name)) continue;  /* Skip comments */
+            if (!return_values && !key->value) continue;  /* Skip lines w.o. '=' */
+            PROFILE_CopyEntry( buffer, key->name, len - 1, 0 );
+            len -= strlenW(buffer) + 1;
+            buffer += strlenW(buffer) + 1;
+            if (len < 2)
+                break;
+            if (return_values && key->value) {
+                buffer[-1] = '=';
+                PROFILE_CopyEntry ( buffer, key->value, len - 1, 0 );
                 len -= strlenW(buffer) + 1;
                 buffer += strlenW(buffer) + 1;
-		if (len < 2)
-		    break;
-		if (return_values && key->value) {
-			buffer[-1] = '=';
-			PROFILE_CopyEntry ( buffer, key->value, len - 1, 0 );
-			len -= strlenW(buffer) + 1;
-			buffer += strlenW(buffer) + 1;
-                }
-            }
-            *buffer = '\0';
-            if (len <= 1)
-                /*If either lpszSection or lpszKey is NULL and the supplied
-                  destination buffer is too small to hold all the strings,
-                  the last string is truncated and followed by two null characters.
-                  In this case, the return value is equal to cchReturnBuffer
-                  minus two. */
-            {
-		buffer[-1] = '\0';
-                return oldlen - 2;
             }
-            return oldlen - len;
         }
-        section = section->next;
+        *buffer = '\0';
+        if (len <= 1)
+            /*If either lpszSection or lpszKey is NULL and the supplied
+              destination buffer is too small to hold all the strings,
+              the last string is truncated and followed by two null characters.
+              In this case, the return value is equal to cchReturnBuffer
+              minus two. */
+        {
+            buffer[-1] = '\0';
+            return oldlen - 2;
+        }
+        return oldlen - len;
     }
     buffer[0] = buffer[1] = '\0';
     return 0;
@@ -993,7 +1185,7 @@ static INT PROFILE_GetString( LPCWSTR section, LPCWSTR key_name,
             PROFILE_CopyEntry(buffer, def_val, len, TRUE);
             return strlenW(buffer);
         }
-        key = PROFILE_Find( &CurProfile->section, section, key_name, FALSE, FALSE);
+        key = PROFILE_FindKey( section, key_name );
         PROFILE_CopyEntry( buffer, (key && key->value) ? key->value : def_val,
                            len, TRUE );
         TRACE("(%s,%s,%s): returning %s\n",
@@ -1004,7 +1196,7 @@ static INT PROFILE_GetString( LPCWSTR section, LPCWSTR key_name,
     /* no "else" here ! */
     if (section && section[0])
     {
-        INT ret = PROFILE_GetSection(CurProfile->section, section, buffer, len, FALSE);
+        INT ret = PROFILE_GetSection(section, buffer, len, FALSE);
         if (!buffer[0]) /* no luck -> def_val */
         {
             PROFILE_CopyEntry(buffer, def_val, len, TRUE);
@@ -1025,6 +1217,8 @@ static INT PROFILE_GetString( LPCWSTR section, LPCWSTR key_name,
 static BOOL PROFILE_SetString( LPCWSTR section_name, LPCWSTR key_name,
                                LPCWSTR value, BOOL create_always )
 {
+    PROFILE_FreeIndex( CurProfile );
+
     if (!key_name)  /* Delete a whole section */
     {
         TRACE("(%s)\n", debugstr_w(section_name));
@@ -1298,7 +1492,7 @@ INT WINAPI GetPrivateProfileSectionW( LPCWSTR section, LPWSTR buffer,
     RtlEnterCriticalSection( &PROFILE_CritSect );
 
     if (PROFILE_Open( filename, FALSE ))
-        ret = PROFILE_GetSection(CurProfile->section, section, buffer, len, TRUE);
+        ret = PROFILE_GetSection(section, buffer, len, TRUE);
 
     RtlLeaveCriticalSection( &PROFILE_CritSect );
 
@@ -1623,7 +1817,7 @@ BOOL WINAPI GetPrivateProfileStructW (LPCWSTR section, LPCWSTR key,
     RtlEnterCriticalSection( &PROFILE_CritSect );
 
     if (PROFILE_Open( filename, FALSE )) {
-        PROFILEKEY *k = PROFILE_Find ( &CurProfile->section, section, key, FALSE, FALSE);
+        PROFILEKEY *k = PROFILE_FindKey( section, key );
 	if (k) {
 	    TRACE("value (at %p): %s\n", k->value, debugstr_w(k->value));
 	    if (((strlenW(k->value) - 2) / 2) == len)
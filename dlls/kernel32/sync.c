@@ -40,6 +40,7 @@
 #include "winioctl.h"
 #include "ddk/wdm.h"
 
+#include "wine/server.h"
 #include "wine/unicode.h"
 #include "kernel_private.h"
 
@@ -1716,6 +1717,62 @@ BOOL WINAPI GetNamedPipeInfo(
     return TRUE;
 }
 
+/* retrieve the process ids at both ends of a named pipe */
+static BOOL get_pipe_process_ids( HANDLE pipe, ULONG *client_pid, ULONG *server_pid )
+{
+    BOOL ret;
+
+    SERVER_START_REQ( get_named_pipe_info )
+    {
+        req->handle = wine_server_obj_handle( pipe );
+        if ((ret = !wine_server_call_err( req )))
+        {
+            *client_pid = reply->client_pid;
+            *server_pid = reply->server_pid;
+        }
+    }
+    SERVER_END_REQ;
+    return ret;
+}
+
+/***********************************************************************
+ *           GetNamedPipeClientProcessId  (KERNEL32.@)
+ */
+BOOL WINAPI GetNamedPipeClientProcessId( HANDLE pipe, ULONG *id )
+{
+    ULONG client_pid, server_pid;
+
+    TRACE( "%p %p\n", pipe, id );
+
+    if (!get_pipe_process_ids( pipe, &client_pid, &server_pid )) return FALSE;
+    if (!client_pid)
+    {
+        SetLastError( ERROR_PIPE_NOT_CONNECTED );
+        return FALSE;
+    }
+    *id = client_pid;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           GetNamedPipeServerProcessId  (KERNEL32.@)
+ */
+BOOL WINAPI GetNamedPipeServerProcessId( HANDLE pipe, ULONG *id )
+{
+    ULONG client_pid, server_pid;
+
+    TRACE( "%p %p\n", pipe, id );
+
+    if (!get_pipe_process_ids( pipe, &client_pid, &server_pid )) return FALSE;
+    if (!server_pid)
+    {
+        SetLastError( ERROR_PIPE_NOT_CONNECTED );
+        return FALSE;
+    }
+    *id = server_pid;
+    return TRUE;
+}
+
 /***********************************************************************
  *           GetNamedPipeHandleStateA  (KERNEL32.@)
  */
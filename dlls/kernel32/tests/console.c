@@ -456,6 +456,85 @@ static void testWriteWrappedProcessed(HANDLE hCon, COORD sbSize)
     okCURSOR(hCon, c);
 }
 
+static void testWriteScrolled(HANDLE hCon, COORD sbSize)
+{
+    COORD		c;
+    DWORD		len, mode;
+    const char*		mytest = "ab\ncd\bX\r1";
+    const int		mylen = strlen(mytest);
+    const int		biglen = 20000;
+    char*		big;
+
+    ok(GetConsoleMode(hCon, &mode) && SetConsoleMode(hCon, mode | (ENABLE_WRAP_AT_EOL_OUTPUT|ENABLE_PROCESSED_OUTPUT)),
+       "setting wrap at EOL & processed output\n");
+
+    /* a new line on the last line scrolls the buffer */
+    c.X = 0; c.Y = sbSize.Y - 1;
+    ok(SetConsoleCursorPosition(hCon, c) != 0, "Cursor in lower-left\n");
+
+    ok(WriteConsoleA(hCon, mytest, mylen, &len, NULL) != 0 && len == mylen, "WriteConsole\n");
+    c.X = 0; c.Y = sbSize.Y - 2;
+    okCHAR(hCon, c, 'a', TEST_ATTRIB);
+    c.X++;
+    okCHAR(hCon, c, 'b', TEST_ATTRIB);
+    c.X = 0; c.Y++;
+    okCHAR(hCon, c, '1', TEST_ATTRIB);
+    c.X++;
+    okCHAR(hCon, c, 'X', TEST_ATTRIB);
+    okCURSOR(hCon, c);
+    c.X++;
+    okCHAR(hCon, c, ' ', TEST_ATTRIB);
+
+    /* large writes scroll as many times as needed */
+    big = HeapAlloc(GetProcessHeap(), 0, biglen);
+    memset(big, 'x', biglen);
+    ok(WriteConsoleA(hCon, big, biglen, &len, NULL) != 0 && len == biglen, "WriteConsole\n");
+    HeapFree(GetProcessHeap(), 0, big);
+    c.X = (1 + biglen) % sbSize.X; c.Y = sbSize.Y - 1;
+    okCURSOR(hCon, c);
+    c.X = 0; c.Y = sbSize.Y - 2;
+    okCHAR(hCon, c, 'x', TEST_ATTRIB);
+}
+
+static void testWriteWindow(HANDLE hCon, COORD sbSize)
+{
+    CONSOLE_SCREEN_BUFFER_INFO sbi;
+    SMALL_RECT          win;
+    COORD		c;
+    DWORD		len, mode;
+    int                 i, height;
+
+    ok(GetConsoleScreenBufferInfo(hCon, &sbi), "Getting sb info\n");
+    height = sbi.srWindow.Bottom - sbi.srWindow.Top + 1;
+    if (height >= sbSize.Y)
+    {
+        skip("The buffer is not taller than the window\n");
+        return;
+    }
+    ok(GetConsoleMode(hCon, &mode) && SetConsoleMode(hCon, mode | ENABLE_PROCESSED_OUTPUT),
+       "setting processed output\n");
+
+    /* move the window to the top of the buffer */
+    win.Left = sbi.srWindow.Left;
+    win.Right = sbi.srWindow.Right;
+    win.Top = 0;
+    win.Bottom = height - 1;
+    ok(SetConsoleWindowInfo(hCon, TRUE, &win), "Setting the window\n");
+    c.X = c.Y = 0;
+    ok(SetConsoleCursorPosition(hCon, c) != 0, "Cursor in upper-left\n");
+
+    /* writing past the bottom of the window scrolls it to keep the cursor visible */
+    for (i = 0; i < sbSize.Y - 1; i++)
+        ok(WriteConsoleA(hCon, "\n", 1, &len, NULL) != 0 && len == 1, "WriteConsole\n");
+    c.Y = sbSize.Y - 1;
+    okCURSOR(hCon, c);
+    ok(GetConsoleScreenBufferInfo(hCon, &sbi), "Getting sb info\n");
+    ok(sbi.srWindow.Bottom == sbSize.Y - 1, "Expected window bottom %d, got %d\n",
+       sbSize.Y - 1, sbi.srWindow.Bottom);
+    ok(sbi.srWindow.Bottom - sbi.srWindow.Top + 1 == height, "Expected window height %d, got %d\n",
+       height, sbi.srWindow.Bottom - sbi.srWindow.Top + 1);
+}
+
 static void testWrite(HANDLE hCon, COORD sbSize)
 {
     /* FIXME: should in fact ensure that the sb is at least 10 characters wide */
@@ -472,6 +551,10 @@ static void testWrite(HANDLE hCon, COORD sbSize)
     testWriteWrappedNotProcessed(hCon, sbSize);
     resetContent(hCon, sbSize, FALSE);
     testWriteWrappedProcessed(hCon, sbSize);
+    resetContent(hCon, sbSize, FALSE);
+    testWriteScrolled(hCon, sbSize);
+    resetContent(hCon, sbSize, FALSE);
+    testWriteWindow(hCon, sbSize);
 }
 
 static void testScroll(HANDLE hCon, COORD sbSize)
@@ -1125,14 +1125,43 @@ static DWORD WINAPI copy_progress_cb(LARGE_INTEGER total_size, LARGE_INTEGER tot
     return PROGRESS_CANCEL;
 }
 
+struct copy_progress
+{
+    unsigned int stream_switch;
+    unsigned int chunks;
+    ULONGLONG total;
+    ULONGLONG transferred;
+};
+
+static DWORD WINAPI copy_progress_count_cb(LARGE_INTEGER total_size, LARGE_INTEGER total_transferred,
+                                           LARGE_INTEGER stream_size, LARGE_INTEGER stream_transferred,
+                                           DWORD stream, DWORD reason, HANDLE source, HANDLE dest, LPVOID userdata)
+{
+    struct copy_progress *progress = userdata;
+
+    if (reason == CALLBACK_STREAM_SWITCH) progress->stream_switch++;
+    else if (reason == CALLBACK_CHUNK_FINISHED)
+    {
+        ok(total_transferred.QuadPart >= progress->transferred, "transferred size went backwards\n");
+        progress->chunks++;
+    }
+    else ok(0, "unexpected reason %u\n", reason);
+    progress->total = total_size.QuadPart;
+    progress->transferred = total_transferred.QuadPart;
+    return PROGRESS_CONTINUE;
+}
+
 static void test_CopyFileEx(void)
 {
     char temp_path[MAX_PATH];
     char source[MAX_PATH], dest[MAX_PATH];
     static const char prefix[] = "pfx";
+    struct copy_progress progress;
+    char buffer[40000];
     HANDLE hfile;
     DWORD ret;
-    BOOL retok;
+    BOOL retok, cancel;
+    unsigned int i;
 
     ret = GetTempPathA(MAX_PATH, temp_path);
     ok(ret != 0, "GetTempPathA error %d\n", GetLastError());
@@ -1148,29 +1177,65 @@ static void test_CopyFileEx(void)
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
     ok(GetFileAttributesA(dest) != INVALID_FILE_ATTRIBUTES, "file was deleted\n");
 
     hfile = CreateFileA(dest, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_WRITE | FILE_SHARE_DELETE,
                         NULL, OPEN_EXISTING, 0, 0);
-    todo_wine
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
-    todo_wine
     ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
 
     ret = DeleteFileA(source);
     ok(ret, "DeleteFileA failed with error %d\n", GetLastError());
     ret = DeleteFileA(dest);
     ok(!ret, "DeleteFileA unexpectedly succeeded\n");
+
+    /* copy some data, checking the progress notifications */
+    hfile = CreateFileA(source, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to create source file, error %d\n", GetLastError());
+    for (i = 0; i < sizeof(buffer); i++) buffer[i] = i * 7;
+    for (i = 0; i < 5; i++)
+    {
+        retok = WriteFile(hfile, buffer, sizeof(buffer), &ret, NULL);
+        ok(retok && ret == sizeof(buffer), "WriteFile error %d\n", GetLastError());
+    }
+    CloseHandle(hfile);
+
+    memset(&progress, 0, sizeof(progress));
+    retok = CopyFileExA(source, dest, copy_progress_count_cb, &progress, NULL, 0);
+    ok(retok, "CopyFileExA failed with error %d\n", GetLastError());
+    ok(progress.stream_switch == 1, "got %u stream switches\n", progress.stream_switch);
+    ok(progress.chunks >= 1, "got %u chunks\n", progress.chunks);
+    ok(progress.transferred == 5 * sizeof(buffer), "got %u bytes transferred\n", (DWORD)progress.transferred);
+    ok(progress.total == 5 * sizeof(buffer), "got %u total bytes\n", (DWORD)progress.total);
+
+    hfile = CreateFileA(dest, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %d\n", GetLastError());
+    ok(GetFileSize(hfile, NULL) == 5 * sizeof(buffer), "wrong size %u\n", GetFileSize(hfile, NULL));
+    for (i = 0; i < 5; i++)
+    {
+        char data[sizeof(buffer)];
+        retok = ReadFile(hfile, data, sizeof(data), &ret, NULL);
+        ok(retok && ret == sizeof(data), "ReadFile error %d\n", GetLastError());
+        ok(!memcmp(data, buffer, sizeof(data)), "wrong data in block %u\n", i);
+    }
+    CloseHandle(hfile);
+
+    /* a cancelled copy removes the destination */
+    cancel = TRUE;
+    SetLastError(0xdeadbeef);
+    retok = CopyFileExA(source, dest, NULL, NULL, &cancel, 0);
+    ok(!retok, "CopyFileExA unexpectedly succeeded\n");
+    ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %d\n", GetLastError());
+    ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
+
+    ret = DeleteFileA(source);
+    ok(ret, "DeleteFileA failed with error %d\n", GetLastError());
 }
 
 /*
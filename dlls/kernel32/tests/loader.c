@@ -3007,6 +3007,53 @@ static void test_InMemoryOrderModuleList(void)
     ok(entry2 == mark2, "expected entry2 == mark2, got %p and %p\n", entry2, mark2);
 }
 
+static void test_GetProcAddress_exports(void)
+{
+    HMODULE ntdll = GetModuleHandleA( "ntdll.dll" );
+    const IMAGE_EXPORT_DIRECTORY *exports;
+    const DWORD *names, *functions;
+    const WORD *ordinals;
+    char name[256];
+    ULONG size;
+    DWORD i, rva;
+    FARPROC proc;
+
+    if (!pRtlImageDirectoryEntryToData)
+    {
+        win_skip( "RtlImageDirectoryEntryToData not available\n" );
+        return;
+    }
+    exports = pRtlImageDirectoryEntryToData( ntdll, TRUE, IMAGE_DIRECTORY_ENTRY_EXPORT, &size );
+    ok( exports != NULL, "no export directory\n" );
+    if (!exports) return;
+
+    names = (const DWORD *)((const char *)ntdll + exports->AddressOfNames);
+    ordinals = (const WORD *)((const char *)ntdll + exports->AddressOfNameOrdinals);
+    functions = (const DWORD *)((const char *)ntdll + exports->AddressOfFunctions);
+
+    /* look up every name, in reverse order to defeat any sequential access pattern */
+    for (i = exports->NumberOfNames; i > 0; i--)
+    {
+        const char *ename = (const char *)ntdll + names[i - 1];
+
+        rva = functions[ordinals[i - 1]];
+        if (rva >= (const char *)exports - (const char *)ntdll &&
+            rva < (const char *)exports - (const char *)ntdll + size) continue;  /* forward */
+
+        proc = GetProcAddress( ntdll, ename );
+        ok( proc == (FARPROC)((const char *)ntdll + rva), "%s: got %p, expected %p\n",
+            ename, proc, (const char *)ntdll + rva );
+    }
+
+    proc = GetProcAddress( ntdll, "NtCloseNonExistent" );
+    ok( !proc, "got %p for a missing export\n", proc );
+    strcpy( name, "ntclose" );
+    proc = GetProcAddress( ntdll, name );
+    ok( !proc, "got %p for %s\n", proc, name );
+    proc = GetProcAddress( ntdll, "" );
+    ok( !proc, "got %p for an empty name\n", proc );
+}
+
 START_TEST(loader)
 {
     int argc;
@@ -3068,4 +3115,5 @@ START_TEST(loader)
     test_import_resolution();
     test_ExitProcess();
     test_InMemoryOrderModuleList();
+    test_GetProcAddress_exports();
 }
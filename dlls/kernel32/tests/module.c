@@ -712,6 +712,40 @@ static void testGetModuleHandleEx(void)
     FreeLibrary( mod_kernel32 );
 }
 
+static void testGetModuleHandleFullPath(void)
+{
+    static const char *names[] = { "kernel32.dll", "ntdll.dll" };
+    WCHAR path[MAX_PATH];
+    HMODULE mod, ret;
+    unsigned int i;
+
+    if (!is_unicode_enabled)
+    {
+        win_skip("GetModuleFileNameW not available\n");
+        return;
+    }
+
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        mod = GetModuleHandleA( names[i] );
+        ok( mod != NULL, "%s: module not found\n", names[i] );
+        if (!GetModuleFileNameW( mod, path, MAX_PATH )) continue;
+
+        SetLastError( 0xdeadbeef );
+        ret = GetModuleHandleW( path );
+        ok( ret == mod, "%s: got %p, expected %p, error %u for %s\n", names[i], ret, mod,
+            GetLastError(), wine_dbgstr_w(path) );
+
+        CharUpperW( path );
+        ret = GetModuleHandleW( path );
+        ok( ret == mod, "%s: got %p, expected %p for %s\n", names[i], ret, mod, wine_dbgstr_w(path) );
+
+        ret = LoadLibraryW( path );
+        ok( ret == mod, "%s: got %p, expected %p for %s\n", names[i], ret, mod, wine_dbgstr_w(path) );
+        FreeLibrary( ret );
+    }
+}
+
 static void testK32GetModuleInformation(void)
 {
     MODULEINFO info;
@@ -767,5 +801,6 @@ START_TEST(module)
     testGetProcAddress_Wrong();
     testLoadLibraryEx();
     testGetModuleHandleEx();
+    testGetModuleHandleFullPath();
     testK32GetModuleInformation();
 }
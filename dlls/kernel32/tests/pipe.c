@@ -36,6 +36,8 @@ static HANDLE alarm_event;
 static BOOL (WINAPI *pDuplicateTokenEx)(HANDLE,DWORD,LPSECURITY_ATTRIBUTES,
                                         SECURITY_IMPERSONATION_LEVEL,TOKEN_TYPE,PHANDLE);
 static DWORD (WINAPI *pQueueUserAPC)(PAPCFUNC pfnAPC, HANDLE hThread, ULONG_PTR dwData);
+static BOOL (WINAPI *pGetNamedPipeClientProcessId)(HANDLE,ULONG*);
+static BOOL (WINAPI *pGetNamedPipeServerProcessId)(HANDLE,ULONG*);
 
 static BOOL user_apc_ran;
 static void CALLBACK user_apc(ULONG_PTR param)
@@ -2353,6 +2355,58 @@ static void test_GetNamedPipeInfo(void)
     CloseHandle(server);
 }
 
+static void test_GetNamedPipeProcessId(void)
+{
+    HANDLE server, client;
+    ULONG id;
+    BOOL ret;
+
+    if (!pGetNamedPipeClientProcessId || !pGetNamedPipeServerProcessId)
+    {
+        win_skip("GetNamedPipeClientProcessId not supported\n");
+        return;
+    }
+
+    server = CreateNamedPipeA(PIPENAME, PIPE_ACCESS_DUPLEX,
+        /* dwOpenMode */ PIPE_TYPE_BYTE | PIPE_WAIT,
+        /* nMaxInstances */ 1,
+        /* nOutBufSize */ 1024,
+        /* nInBufSize */ 1024,
+        /* nDefaultWait */ NMPWAIT_USE_DEFAULT_WAIT,
+        /* lpSecurityAttrib */ NULL);
+    ok(server != INVALID_HANDLE_VALUE, "CreateNamedPipe failed\n");
+
+    id = 0xdeadbeef;
+    ret = pGetNamedPipeServerProcessId(server, &id);
+    ok(ret, "GetNamedPipeServerProcessId failed: %u\n", GetLastError());
+    ok(id == GetCurrentProcessId(), "got %u, expected %u\n", id, GetCurrentProcessId());
+
+    client = CreateFileA(PIPENAME, GENERIC_READ|GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, 0);
+    ok(client != INVALID_HANDLE_VALUE, "CreateFile failed: %u\n", GetLastError());
+
+    id = 0xdeadbeef;
+    ret = pGetNamedPipeClientProcessId(server, &id);
+    ok(ret, "GetNamedPipeClientProcessId failed: %u\n", GetLastError());
+    ok(id == GetCurrentProcessId(), "got %u, expected %u\n", id, GetCurrentProcessId());
+
+    id = 0xdeadbeef;
+    ret = pGetNamedPipeClientProcessId(client, &id);
+    ok(ret, "GetNamedPipeClientProcessId failed: %u\n", GetLastError());
+    ok(id == GetCurrentProcessId(), "got %u, expected %u\n", id, GetCurrentProcessId());
+
+    id = 0xdeadbeef;
+    ret = pGetNamedPipeServerProcessId(client, &id);
+    ok(ret, "GetNamedPipeServerProcessId failed: %u\n", GetLastError());
+    ok(id == GetCurrentProcessId(), "got %u, expected %u\n", id, GetCurrentProcessId());
+
+    SetLastError(0xdeadbeef);
+    ret = pGetNamedPipeClientProcessId(GetCurrentProcess(), &id);
+    ok(!ret, "GetNamedPipeClientProcessId succeeded on a process handle\n");
+
+    CloseHandle(client);
+    CloseHandle(server);
+}
+
 static void test_readfileex_pending(void)
 {
     HANDLE server, client, event;
@@ -2522,6 +2576,8 @@ START_TEST(pipe)
     pDuplicateTokenEx = (void *) GetProcAddress(hmod, "DuplicateTokenEx");
     hmod = GetModuleHandleA("kernel32.dll");
     pQueueUserAPC = (void *) GetProcAddress(hmod, "QueueUserAPC");
+    pGetNamedPipeClientProcessId = (void *) GetProcAddress(hmod, "GetNamedPipeClientProcessId");
+    pGetNamedPipeServerProcessId = (void *) GetProcAddress(hmod, "GetNamedPipeServerProcessId");
 
     if (test_DisconnectNamedPipe())
         return;
@@ -2536,5 +2592,6 @@ START_TEST(pipe)
     test_overlapped_error();
     test_NamedPipeHandleState();
     test_GetNamedPipeInfo();
+    test_GetNamedPipeProcessId();
     test_readfileex_pending();
 }
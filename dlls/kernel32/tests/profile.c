@@ -520,6 +520,71 @@ static void create_test_file(LPCSTR name, LPCSTR data, DWORD size)
     CloseHandle(hfile);
 }
 
+static void test_profile_lookup(void)
+{
+    static const CHAR testfile[] = ".\\winetest5.ini";
+    char *data, *p, buf[256];
+    DWORD res;
+    int i, j;
+
+    /* enough sections and keys to make lookups go through the profile index in wine */
+    data = HeapAlloc(GetProcessHeap(), 0, 200 * (16 + 20 * 32) + 256);
+    p = data;
+    p += sprintf(p, "[Dup]\r\nkey=first\r\nkey=second\r\n");
+    for (i = 0; i < 200; i++)
+    {
+        p += sprintf(p, "[Section%d]\r\n", i);
+        for (j = 0; j < 20; j++) p += sprintf(p, "Key%d = %d.%d\r\n", j, i, j);
+    }
+    p += sprintf(p, "[dup]\r\nkey=third\r\nother=fourth\r\n");
+    create_test_file(testfile, data, p - data);
+    HeapFree(GetProcessHeap(), 0, data);
+
+    for (i = 0; i < 200; i += 7)
+    {
+        char section[32], key[32], expect[32];
+        for (j = 0; j < 20; j += 3)
+        {
+            sprintf(section, "section%d", i);
+            sprintf(key, "KEY%d", j);
+            sprintf(expect, "%d.%d", i, j);
+            res = GetPrivateProfileStringA(section, key, "default", buf, sizeof(buf), testfile);
+            ok(res == strlen(expect) && !strcmp(buf, expect), "%s.%s: got %u %s\n", section, key, res, buf);
+        }
+    }
+
+    res = GetPrivateProfileStringA("  Section12 ", " Key3  ", "default", buf, sizeof(buf), testfile);
+    ok(res == 4 && !strcmp(buf, "12.3"), "got %u %s\n", res, buf);
+    res = GetPrivateProfileStringA("Section12", "Key20", "default", buf, sizeof(buf), testfile);
+    ok(res == 7 && !strcmp(buf, "default"), "got %u %s\n", res, buf);
+    res = GetPrivateProfileStringA("Section200", "Key1", "default", buf, sizeof(buf), testfile);
+    ok(res == 7 && !strcmp(buf, "default"), "got %u %s\n", res, buf);
+
+    /* only the first section and key of a given name are used */
+    res = GetPrivateProfileStringA("DUP", "key", "default", buf, sizeof(buf), testfile);
+    ok(res == 5 && !strcmp(buf, "first"), "got %u %s\n", res, buf);
+    res = GetPrivateProfileStringA("dup", "other", "default", buf, sizeof(buf), testfile);
+    ok(res == 7 && !strcmp(buf, "default"), "got %u %s\n", res, buf);
+    res = GetPrivateProfileSectionA("dup", buf, sizeof(buf), testfile);
+    ok(res == 21 && !memcmp(buf, "key=first\0key=second\0", 22), "got %u %s\n", res, buf);
+
+    /* lookups must see the keys that are added and deleted */
+    res = WritePrivateProfileStringA("Section5", "NewKey", "new", testfile);
+    ok(res, "WritePrivateProfileString failed %u\n", GetLastError());
+    res = GetPrivateProfileStringA("Section5", "newkey", "default", buf, sizeof(buf), testfile);
+    ok(res == 3 && !strcmp(buf, "new"), "got %u %s\n", res, buf);
+    res = WritePrivateProfileStringA("Section5", "Key0", NULL, testfile);
+    ok(res, "WritePrivateProfileString failed %u\n", GetLastError());
+    res = GetPrivateProfileStringA("Section5", "Key0", "default", buf, sizeof(buf), testfile);
+    ok(res == 7 && !strcmp(buf, "default"), "got %u %s\n", res, buf);
+    res = WritePrivateProfileStringA("Dup", NULL, NULL, testfile);
+    ok(res, "WritePrivateProfileString failed %u\n", GetLastError());
+    res = GetPrivateProfileStringA("dup", "other", "default", buf, sizeof(buf), testfile);
+    ok(res == 6 && !strcmp(buf, "fourth"), "got %u %s\n", res, buf);
+
+    DeleteFileA(testfile);
+}
+
 static BOOL emptystr_ok(CHAR emptystr[MAX_PATH])
 {
     int i;
@@ -1132,6 +1197,7 @@ START_TEST(profile)
     test_profile_existing();
     test_profile_delete_on_close();
     test_profile_refresh();
+    test_profile_lookup();
     test_GetPrivateProfileString(
         "[section1]\r\n"
         "name1=val1\r\n"
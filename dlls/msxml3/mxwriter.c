@@ -360,6 +360,15 @@ static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
             unsigned int avail = buff->allocated - buff->written;
             int length;
 
+            /* supported code pages need at most 3 bytes per WCHAR, when that surely fits
+               convert directly without sizing the output first */
+            if (avail / 3 >= src_len)
+            {
+                length = WideCharToMultiByte(buffer->code_page, 0, data, src_len, buff->data + buff->written, avail, NULL, NULL);
+                buff->written += length;
+                return S_OK;
+            }
+
             length = WideCharToMultiByte(buffer->code_page, 0, data, src_len, NULL, 0, NULL, NULL);
             if (avail >= length)
             {
@@ -476,76 +485,67 @@ static void close_output_buffer(mxwriter *writer)
     list_init(&writer->buffer.blocks);
 }
 
-/* Escapes special characters like:
+static inline BOOL is_escaped_char(WCHAR ch, escape_mode mode)
+{
+    /* all of them are below '?', so most chars are rejected with a single compare */
+    if (ch > '>') return FALSE;
+    return ch == '<' || ch == '&' || ch == '>' || (ch == '"' && mode == EscapeValue);
+}
+
+/* Writes a string escaping special characters like:
    '<' -> "&lt;"
    '&' -> "&amp;"
    '"' -> "&quot;"
    '>' -> "&gt;"
 
-   On call 'len' contains a length of 'str' in chars or -1 if it's null terminated.
-   After a call it's updated with actual new length if it wasn't -1 initially.
+   Runs of characters that don't need escaping are passed to the output buffer as is,
+   so no escaped copy of the string is made. 'len' is a length of 'str' in chars or -1
+   if it's null terminated, output stops at first null char in any case.
 */
-static WCHAR *get_escaped_string(const WCHAR *str, escape_mode mode, int *len)
+static HRESULT write_output_buffer_escaped(mxwriter *writer, const WCHAR *str, int len, escape_mode mode)
 {
     static const WCHAR ltW[]    = {'&','l','t',';'};
     static const WCHAR ampW[]   = {'&','a','m','p',';'};
     static const WCHAR equotW[] = {'&','q','u','o','t',';'};
     static const WCHAR gtW[]    = {'&','g','t',';'};
+    const WCHAR *run, *end;
+    HRESULT hr;
 
-    const int default_alloc = 100;
-    const int grow_thresh = 10;
-    int p = *len, conv_len;
-    WCHAR *ptr, *ret;
-
-    /* default buffer size to something if length is unknown */
-    conv_len = *len == -1 ? default_alloc : max(2**len, default_alloc);
-    ptr = ret = heap_alloc(conv_len*sizeof(WCHAR));
+    if (len == -1) len = strlenW(str);
+    end = str + len;
 
-    while (*str && p)
+    while (str < end && *str)
     {
-        if (ptr - ret > conv_len - grow_thresh)
-        {
-            int written = ptr - ret;
-            conv_len *= 2;
-            ptr = ret = heap_realloc(ret, conv_len*sizeof(WCHAR));
-            ptr += written;
-        }
+        run = str;
+        while (str < end && *str && !is_escaped_char(*str, mode))
+            str++;
+
+        if (str != run && FAILED(hr = write_output_buffer(writer, run, str - run)))
+            return hr;
+        if (str == end || !*str)
+            break;
 
         switch (*str)
         {
         case '<':
-            memcpy(ptr, ltW, sizeof(ltW));
-            ptr += sizeof(ltW)/sizeof(WCHAR);
+            hr = write_output_buffer(writer, ltW, sizeof(ltW)/sizeof(WCHAR));
             break;
         case '&':
-            memcpy(ptr, ampW, sizeof(ampW));
-            ptr += sizeof(ampW)/sizeof(WCHAR);
+            hr = write_output_buffer(writer, ampW, sizeof(ampW)/sizeof(WCHAR));
             break;
         case '>':
-            memcpy(ptr, gtW, sizeof(gtW));
-            ptr += sizeof(gtW)/sizeof(WCHAR);
+            hr = write_output_buffer(writer, gtW, sizeof(gtW)/sizeof(WCHAR));
             break;
-        case '"':
-            if (mode == EscapeValue)
-            {
-                memcpy(ptr, equotW, sizeof(equotW));
-                ptr += sizeof(equotW)/sizeof(WCHAR);
-                break;
-            }
-            /* fallthrough for text mode */
         default:
-            *ptr++ = *str;
+            hr = write_output_buffer(writer, equotW, sizeof(equotW)/sizeof(WCHAR));
             break;
         }
+        if (FAILED(hr)) return hr;
 
         str++;
-        if (*len != -1) p--;
     }
 
-    if (*len != -1) *len = ptr-ret;
-    *++ptr = 0;
-
-    return ret;
+    return S_OK;
 }
 
 static void write_prolog_buffer(mxwriter *writer)
@@ -1265,9 +1265,9 @@ static void mxwriter_write_attribute(mxwriter *writer, const WCHAR *qname, int q
 
     if (escape)
     {
-        WCHAR *escaped = get_escaped_string(value, EscapeValue, &value_len);
-        write_output_buffer_quoted(writer, escaped, value_len);
-        heap_free(escaped);
+        write_output_buffer(writer, quotW, 1);
+        write_output_buffer_escaped(writer, value, value_len, EscapeValue);
+        write_output_buffer(writer, quotW, 1);
     }
     else
         write_output_buffer_quoted(writer, value, value_len);
@@ -1400,14 +1400,7 @@ static HRESULT WINAPI SAXContentHandler_characters(
         if (This->cdata || This->props[MXWriter_DisableEscaping] == VARIANT_TRUE)
             write_output_buffer(This, chars, nchars);
         else
-        {
-            int len = nchars;
-            WCHAR *escaped;
-
-            escaped = get_escaped_string(chars, EscapeText, &len);
-            write_output_buffer(This, escaped, len);
-            heap_free(escaped);
-        }
+            write_output_buffer_escaped(This, chars, nchars, EscapeText);
     }
 
     return S_OK;
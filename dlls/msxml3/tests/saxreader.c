@@ -3904,6 +3904,7 @@ static const struct writer_characters_t writer_characters[] = {
     { &CLSID_MXXMLWriter30, "< > & \" \'", "&lt; &gt; &amp; \" \'" },
     { &CLSID_MXXMLWriter40, "< > & \" \'", "&lt; &gt; &amp; \" \'" },
     { &CLSID_MXXMLWriter60, "< > & \" \'", "&lt; &gt; &amp; \" \'" },
+    { &CLSID_MXXMLWriter,   "text<with>special&&chars\"", "text&lt;with&gt;special&amp;&amp;chars\"" },
     { NULL }
 };
 
@@ -2373,68 +2373,84 @@ static NTSTATUS parse_manifest_buffer( struct actctx_loader* acl, struct assembl
     return STATUS_SUCCESS;
 }
 
-static NTSTATUS parse_manifest( struct actctx_loader* acl, struct assembly_identity* ai,
-                                LPCWSTR filename, LPCWSTR directory, BOOL shared,
-                                const void *buffer, SIZE_T size )
+/* convert the contents of a manifest file to a heap-allocated WCHAR string */
+static NTSTATUS decode_manifest( const void *buffer, SIZE_T size, WCHAR **text, SIZE_T *len )
 {
-    xmlbuf_t xmlbuf;
-    NTSTATUS status;
-    struct assembly *assembly;
-    int unicode_tests;
-
-    TRACE( "parsing manifest loaded from %s base dir %s\n", debugstr_w(filename), debugstr_w(directory) );
+    int unicode_tests = IS_TEXT_UNICODE_SIGNATURE | IS_TEXT_UNICODE_REVERSE_SIGNATURE;
+    WCHAR *new_buff;
 
-    if (!(assembly = add_assembly(acl->actctx, shared ? ASSEMBLY_SHARED_MANIFEST : ASSEMBLY_MANIFEST)))
-        return STATUS_SXS_CANT_GEN_ACTCTX;
-
-    if (directory && !(assembly->directory = strdupW(directory)))
-        return STATUS_NO_MEMORY;
-
-    if (filename) assembly->manifest.info = strdupW( filename + 4 /* skip \??\ prefix */ );
-    assembly->manifest.type = assembly->manifest.info ? ACTIVATION_CONTEXT_PATH_TYPE_WIN32_FILE
-                                                      : ACTIVATION_CONTEXT_PATH_TYPE_NONE;
-
-    unicode_tests = IS_TEXT_UNICODE_SIGNATURE | IS_TEXT_UNICODE_REVERSE_SIGNATURE;
     if (RtlIsTextUnicode( buffer, size, &unicode_tests ))
     {
-        xmlbuf.ptr = buffer;
-        xmlbuf.end = xmlbuf.ptr + size / sizeof(WCHAR);
-        status = parse_manifest_buffer( acl, assembly, ai, &xmlbuf );
+        *len = size / sizeof(WCHAR);
+        if (!(new_buff = RtlAllocateHeap( GetProcessHeap(), 0, *len * sizeof(WCHAR) )))
+            return STATUS_NO_MEMORY;
+        memcpy( new_buff, buffer, *len * sizeof(WCHAR) );
     }
     else if (unicode_tests & IS_TEXT_UNICODE_REVERSE_SIGNATURE)
     {
         const WCHAR *buf = buffer;
-        WCHAR *new_buff;
         unsigned int i;
 
-        if (!(new_buff = RtlAllocateHeap( GetProcessHeap(), 0, size )))
+        *len = size / sizeof(WCHAR);
+        if (!(new_buff = RtlAllocateHeap( GetProcessHeap(), 0, *len * sizeof(WCHAR) )))
             return STATUS_NO_MEMORY;
-        for (i = 0; i < size / sizeof(WCHAR); i++)
+        for (i = 0; i < *len; i++)
             new_buff[i] = RtlUshortByteSwap( buf[i] );
-        xmlbuf.ptr = new_buff;
-        xmlbuf.end = xmlbuf.ptr + size / sizeof(WCHAR);
-        status = parse_manifest_buffer( acl, assembly, ai, &xmlbuf );
-        RtlFreeHeap( GetProcessHeap(), 0, new_buff );
     }
     else
     {
         /* let's assume utf-8 for now */
-        int len = wine_utf8_mbstowcs( 0, buffer, size, NULL, 0 );
-        WCHAR *new_buff;
+        int count = wine_utf8_mbstowcs( 0, buffer, size, NULL, 0 );
 
-        if (len == -1)
+        if (count == -1)
         {
             FIXME( "utf-8 conversion failed\n" );
             return STATUS_SXS_CANT_GEN_ACTCTX;
         }
-        if (!(new_buff = RtlAllocateHeap( GetProcessHeap(), 0, len * sizeof(WCHAR) )))
+        if (!(new_buff = RtlAllocateHeap( GetProcessHeap(), 0, count * sizeof(WCHAR) )))
             return STATUS_NO_MEMORY;
-        wine_utf8_mbstowcs( 0, buffer, size, new_buff, len );
-        xmlbuf.ptr = new_buff;
-        xmlbuf.end = xmlbuf.ptr + len;
-        status = parse_manifest_buffer( acl, assembly, ai, &xmlbuf );
-        RtlFreeHeap( GetProcessHeap(), 0, new_buff );
+        wine_utf8_mbstowcs( 0, buffer, size, new_buff, count );
+        *len = count;
     }
+    *text = new_buff;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS parse_manifest_text( struct actctx_loader* acl, struct assembly_identity* ai,
+                                     LPCWSTR filename, LPCWSTR directory, BOOL shared,
+                                     const WCHAR *text, SIZE_T len )
+{
+    xmlbuf_t xmlbuf;
+    struct assembly *assembly;
+
+    TRACE( "parsing manifest loaded from %s base dir %s\n", debugstr_w(filename), debugstr_w(directory) );
+
+    if (!(assembly = add_assembly(acl->actctx, shared ? ASSEMBLY_SHARED_MANIFEST : ASSEMBLY_MANIFEST)))
+        return STATUS_SXS_CANT_GEN_ACTCTX;
+
+    if (directory && !(assembly->directory = strdupW(directory)))
+        return STATUS_NO_MEMORY;
+
+    if (filename) assembly->manifest.info = strdupW( filename + 4 /* skip \??\ prefix */ );
+    assembly->manifest.type = assembly->manifest.info ? ACTIVATION_CONTEXT_PATH_TYPE_WIN32_FILE
+                                                      : ACTIVATION_CONTEXT_PATH_TYPE_NONE;
+
+    xmlbuf.ptr = text;
+    xmlbuf.end = text + len;
+    return parse_manifest_buffer( acl, assembly, ai, &xmlbuf );
+}
+
+static NTSTATUS parse_manifest( struct actctx_loader* acl, struct assembly_identity* ai,
+                                LPCWSTR filename, LPCWSTR directory, BOOL shared,
+                                const void *buffer, SIZE_T size )
+{
+    NTSTATUS status;
+    WCHAR *text;
+    SIZE_T len;
+
+    if ((status = decode_manifest( buffer, size, &text, &len ))) return status;
+    status = parse_manifest_text( acl, ai, filename, directory, shared, text, len );
+    RtlFreeHeap( GetProcessHeap(), 0, text );
     return status;
 }
 
@@ -2669,99 +2685,242 @@ static NTSTATUS get_manifest_in_associated_manifest( struct actctx_loader* acl,
     return status;
 }
 
-static WCHAR *lookup_manifest_file( HANDLE dir, struct assembly_identity *ai )
+/* index of the winsxs manifests directory, sorted by file name */
+
+struct winsxs_manifest
 {
-    static const WCHAR lookup_fmtW[] =
-        {'%','s','_','%','s','_','%','s','_','%','u','.','%','u','.','*','.','*','_',
-         '%','s','_','*','.','m','a','n','i','f','e','s','t',0};
-    static const WCHAR wine_trailerW[] = {'d','e','a','d','b','e','e','f','.','m','a','n','i','f','e','s','t'};
+    WCHAR         *file;         /* file name, including the .manifest extension */
+    WCHAR         *text;         /* cached contents of the manifest, or NULL */
+    SIZE_T         text_len;
+    LARGE_INTEGER  write_time;   /* last write time of the file when the text was cached */
+};
 
-    WCHAR *lookup, *ret = NULL;
-    UNICODE_STRING lookup_us;
+static struct winsxs_manifest *winsxs_index;
+static unsigned int winsxs_index_count;
+static LARGE_INTEGER winsxs_index_time;  /* last write time of the directory when it was indexed */
+
+static RTL_CRITICAL_SECTION winsxs_section;
+static RTL_CRITICAL_SECTION_DEBUG winsxs_critsect_debug =
+{
+    0, 0, &winsxs_section,
+    { &winsxs_critsect_debug.ProcessLocksList, &winsxs_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": winsxs_section") }
+};
+static RTL_CRITICAL_SECTION winsxs_section = { &winsxs_critsect_debug, -1, 0, 0, 0, 0 };
+
+static void free_winsxs_index(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < winsxs_index_count; i++)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, winsxs_index[i].file );
+        RtlFreeHeap( GetProcessHeap(), 0, winsxs_index[i].text );
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, winsxs_index );
+    winsxs_index = NULL;
+    winsxs_index_count = 0;
+}
+
+static int winsxs_manifest_cmp( const void *p1, const void *p2 )
+{
+    const struct winsxs_manifest *m1 = p1, *m2 = p2;
+    return strcmpiW( m1->file, m2->file );
+}
+
+/* (re)build the index if the directory changed since it was last read; winsxs_section must be held */
+static void update_winsxs_index( HANDLE dir )
+{
+    static const WCHAR manifestW[] = {'.','m','a','n','i','f','e','s','t'};
+    const unsigned int ext_len = sizeof(manifestW) / sizeof(WCHAR);
+    FILE_BASIC_INFORMATION basic_info;
+    FILE_BOTH_DIR_INFORMATION *dir_info;
+    struct winsxs_manifest *new_index;
     IO_STATUS_BLOCK io;
-    const WCHAR *lang = ai->language;
-    unsigned int data_pos = 0, data_len;
+    unsigned int data_pos, len, size = 0;
+    BOOLEAN restart = TRUE;
     char buffer[8192];
 
-    if (!(lookup = RtlAllocateHeap( GetProcessHeap(), 0,
+    if (NtQueryInformationFile( dir, &io, &basic_info, sizeof(basic_info), FileBasicInformation ))
+        basic_info.LastWriteTime.QuadPart = 0;
+    else if (winsxs_index && basic_info.LastWriteTime.QuadPart == winsxs_index_time.QuadPart)
+        return;
+
+    TRACE( "indexing winsxs manifests\n" );
+    free_winsxs_index();
+    winsxs_index_time = basic_info.LastWriteTime;
+
+    while (!NtQueryDirectoryFile( dir, 0, NULL, NULL, &io, buffer, sizeof(buffer),
+                                  FileBothDirectoryInformation, FALSE, NULL, restart ))
+    {
+        restart = FALSE;
+        for (data_pos = 0; data_pos < io.Information; data_pos += dir_info->NextEntryOffset)
+        {
+            dir_info = (FILE_BOTH_DIR_INFORMATION *)(buffer + data_pos);
+            len = dir_info->FileNameLength / sizeof(WCHAR);
+
+            if (!(dir_info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) && len > ext_len &&
+                !memicmpW( dir_info->FileName + len - ext_len, manifestW, ext_len ))
+            {
+                if (winsxs_index_count == size)
+                {
+                    size = max( 16, size * 2 );
+                    if (winsxs_index)
+                        new_index = RtlReAllocateHeap( GetProcessHeap(), 0, winsxs_index, size * sizeof(*new_index) );
+                    else
+                        new_index = RtlAllocateHeap( GetProcessHeap(), 0, size * sizeof(*new_index) );
+                    if (!new_index) goto failed;
+                    winsxs_index = new_index;
+                }
+                if (!(winsxs_index[winsxs_index_count].file = RtlAllocateHeap( GetProcessHeap(), 0,
+                                                                               (len + 1) * sizeof(WCHAR) )))
+                    goto failed;
+                memcpy( winsxs_index[winsxs_index_count].file, dir_info->FileName, len * sizeof(WCHAR) );
+                winsxs_index[winsxs_index_count].file[len] = 0;
+                winsxs_index[winsxs_index_count].text = NULL;
+                winsxs_index_count++;
+            }
+            if (!dir_info->NextEntryOffset) break;
+        }
+    }
+
+    if (winsxs_index_count)
+        qsort( winsxs_index, winsxs_index_count, sizeof(*winsxs_index), winsxs_manifest_cmp );
+    return;
+
+failed:
+    free_winsxs_index();
+}
+
+/* find the best manifest for an assembly in the index; winsxs_section must be held */
+static struct winsxs_manifest *find_winsxs_manifest( struct assembly_identity *ai )
+{
+    static const WCHAR prefix_fmtW[] = {'%','s','_','%','s','_','%','s','_','%','u','.','%','u','.',0};
+    static const WCHAR wine_trailerW[] = {'d','e','a','d','b','e','e','f','.','m','a','n','i','f','e','s','t'};
+
+    struct winsxs_manifest *ret = NULL;
+    ULONG min_build = ai->version.build, min_revision = ai->version.revision;
+    ULONG build, revision;
+    const WCHAR *lang = ai->language, *tmp, *end;
+    unsigned int lo = 0, hi = winsxs_index_count, mid, prefix_len;
+    WCHAR *prefix;
+
+    if (!(prefix = RtlAllocateHeap( GetProcessHeap(), 0,
                                     (strlenW(ai->arch) + strlenW(ai->name)
                                      + strlenW(ai->public_key) + 20) * sizeof(WCHAR)
-                                    + sizeof(lookup_fmtW) )))
+                                    + sizeof(prefix_fmtW) )))
         return NULL;
 
-    if (!lang || !strcmpiW( lang, neutralW )) lang = wildcardW;
-    sprintfW( lookup, lookup_fmtW, ai->arch, ai->name, ai->public_key,
-              ai->version.major, ai->version.minor, lang );
-    RtlInitUnicodeString( &lookup_us, lookup );
+    if (lang && !strcmpiW( lang, neutralW )) lang = NULL;
+    sprintfW( prefix, prefix_fmtW, ai->arch, ai->name, ai->public_key,
+              ai->version.major, ai->version.minor );
+    prefix_len = strlenW( prefix );
+
+    /* find the first entry with the prefix */
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (strncmpiW( winsxs_index[mid].file, prefix, prefix_len ) < 0) lo = mid + 1;
+        else hi = mid;
+    }
 
-    if (!NtQueryDirectoryFile( dir, 0, NULL, NULL, &io, buffer, sizeof(buffer),
-                               FileBothDirectoryInformation, FALSE, &lookup_us, TRUE ))
+    for ( ; lo < winsxs_index_count; lo++)
     {
-        ULONG min_build = ai->version.build, min_revision = ai->version.revision;
-        FILE_BOTH_DIR_INFORMATION *dir_info;
-        WCHAR *tmp;
-        ULONG build, revision;
+        const WCHAR *file = winsxs_index[lo].file;
 
-        data_len = io.Information;
+        if (strncmpiW( file, prefix, prefix_len )) break;
 
-        for (;;)
+        /* the rest of the name is <build>.<revision>_<language>_<hash>.manifest */
+        tmp = file + prefix_len;
+        build = atoiW(tmp);
+        if (build < min_build) continue;
+        if (!(tmp = strchrW(tmp, '.'))) continue;
+        revision = atoiW(tmp + 1);
+        if (build == min_build && revision < min_revision) continue;
+        if (!(tmp = strchrW(tmp, '_'))) continue;
+        tmp++;
+        if (!(end = strchrW(tmp, '_'))) continue;
+        if (lang && ((unsigned int)(end - tmp) != strlenW(lang) || strncmpiW( tmp, lang, end - tmp ))) continue;
+        tmp = end + 1;
+        if (strlenW(tmp) == sizeof(wine_trailerW) / sizeof(WCHAR) &&
+            !memicmpW( tmp, wine_trailerW, sizeof(wine_trailerW) / sizeof(WCHAR) ))
         {
-            if (data_pos >= data_len)
-            {
-                if (NtQueryDirectoryFile( dir, 0, NULL, NULL, &io, buffer, sizeof(buffer),
-                                          FileBothDirectoryInformation, FALSE, &lookup_us, FALSE ))
-                    break;
-                data_len = io.Information;
-                data_pos = 0;
-            }
-            dir_info = (FILE_BOTH_DIR_INFORMATION*)(buffer + data_pos);
-
-            if (dir_info->NextEntryOffset) data_pos += dir_info->NextEntryOffset;
-            else data_pos = data_len;
-
-            tmp = dir_info->FileName + (strchrW(lookup, '*') - lookup);
-            build = atoiW(tmp);
-            if (build < min_build) continue;
-            tmp = strchrW(tmp, '.') + 1;
-            revision = atoiW(tmp);
-            if (build == min_build && revision < min_revision) continue;
-            tmp = strchrW(tmp, '_') + 1;
-            tmp = strchrW(tmp, '_') + 1;
-            if (dir_info->FileNameLength - (tmp - dir_info->FileName) * sizeof(WCHAR) == sizeof(wine_trailerW) &&
-                !memicmpW( tmp, wine_trailerW, sizeof(wine_trailerW) / sizeof(WCHAR) ))
-            {
-                /* prefer a non-Wine manifest if we already have one */
-                /* we'll still load the builtin dll if specified through DllOverrides */
-                if (ret) continue;
-            }
-            else
-            {
-                min_build = build;
-                min_revision = revision;
-            }
-            ai->version.build = build;
-            ai->version.revision = revision;
-            RtlFreeHeap( GetProcessHeap(), 0, ret );
-            if ((ret = RtlAllocateHeap( GetProcessHeap(), 0, dir_info->FileNameLength + sizeof(WCHAR) )))
-            {
-                memcpy( ret, dir_info->FileName, dir_info->FileNameLength );
-                ret[dir_info->FileNameLength/sizeof(WCHAR)] = 0;
-            }
+            /* prefer a non-Wine manifest if we already have one */
+            /* we'll still load the builtin dll if specified through DllOverrides */
+            if (ret) continue;
         }
+        else
+        {
+            min_build = build;
+            min_revision = revision;
+        }
+        ai->version.build = build;
+        ai->version.revision = revision;
+        ret = &winsxs_index[lo];
     }
-    else WARN("no matching file for %s\n", debugstr_w(lookup));
-    RtlFreeHeap( GetProcessHeap(), 0, lookup );
+
+    if (!ret) WARN( "no matching file for %s\n", debugstr_w(prefix) );
+    RtlFreeHeap( GetProcessHeap(), 0, prefix );
     return ret;
 }
 
+/* parse a winsxs manifest, reusing its cached contents if the file didn't change; winsxs_section must be held */
+static NTSTATUS get_winsxs_manifest( struct actctx_loader* acl, struct assembly_identity* ai,
+                                     struct winsxs_manifest *manifest, UNICODE_STRING *path,
+                                     LPCWSTR directory )
+{
+    FILE_NETWORK_OPEN_INFORMATION info;
+    OBJECT_ATTRIBUTES attr;
+    IO_STATUS_BLOCK io;
+    NTSTATUS status;
+    HANDLE file;
+    void *buffer;
+    WCHAR *text;
+    SIZE_T len;
+
+    attr.Length = sizeof(attr);
+    attr.RootDirectory = 0;
+    attr.Attributes = OBJ_CASE_INSENSITIVE;
+    attr.ObjectName = path;
+    attr.SecurityDescriptor = NULL;
+    attr.SecurityQualityOfService = NULL;
+    if (NtQueryFullAttributesFile( &attr, &info )) return STATUS_NO_SUCH_FILE;
+
+    if (!manifest->text || manifest->write_time.QuadPart != info.LastWriteTime.QuadPart)
+    {
+        TRACE( "loading manifest file %s\n", debugstr_w(path->Buffer) );
+
+        if (open_nt_file( &file, path )) return STATUS_NO_SUCH_FILE;
+        len = info.EndOfFile.QuadPart;
+        if (!(buffer = RtlAllocateHeap( GetProcessHeap(), 0, len )))
+        {
+            NtClose( file );
+            return STATUS_NO_MEMORY;
+        }
+        status = NtReadFile( file, 0, NULL, NULL, &io, buffer, len, NULL, NULL );
+        NtClose( file );
+        if (!status) status = decode_manifest( buffer, io.Information, &text, &len );
+        RtlFreeHeap( GetProcessHeap(), 0, buffer );
+        if (status) return status;
+
+        RtlFreeHeap( GetProcessHeap(), 0, manifest->text );
+        manifest->text = text;
+        manifest->text_len = len;
+        manifest->write_time = info.LastWriteTime;
+    }
+    return parse_manifest_text( acl, ai, path->Buffer, directory, TRUE, manifest->text, manifest->text_len );
+}
+
 static NTSTATUS lookup_winsxs(struct actctx_loader* acl, struct assembly_identity* ai)
 {
     struct assembly_identity    sxs_ai;
+    struct winsxs_manifest     *manifest = NULL;
     UNICODE_STRING              path_us;
     OBJECT_ATTRIBUTES           attr;
     IO_STATUS_BLOCK             io;
-    WCHAR *path, *file = NULL;
+    WCHAR *path, *file;
     HANDLE handle;
+    NTSTATUS status;
 
     static const WCHAR manifest_dirW[] =
         {'\\','w','i','n','s','x','s','\\','m','a','n','i','f','e','s','t','s',0};
@@ -2789,43 +2948,48 @@ static NTSTATUS lookup_winsxs(struct actctx_loader* acl, struct assembly_identit
     attr.SecurityDescriptor = NULL;
     attr.SecurityQualityOfService = NULL;
 
+    RtlEnterCriticalSection( &winsxs_section );
+
     if (!NtOpenFile( &handle, GENERIC_READ | SYNCHRONIZE, &attr, &io, FILE_SHARE_READ | FILE_SHARE_WRITE,
                      FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT ))
     {
+        update_winsxs_index( handle );
         sxs_ai = *ai;
-        file = lookup_manifest_file( handle, &sxs_ai );
+        manifest = find_winsxs_manifest( &sxs_ai );
         NtClose( handle );
     }
-    if (!file)
+    if (!manifest)
     {
+        RtlLeaveCriticalSection( &winsxs_section );
         RtlFreeUnicodeString( &path_us );
         return STATUS_NO_SUCH_FILE;
     }
 
     /* append file name to directory path */
     if (!(path = RtlReAllocateHeap( GetProcessHeap(), 0, path_us.Buffer,
-                                    path_us.Length + (strlenW(file) + 2) * sizeof(WCHAR) )))
+                                    path_us.Length + (strlenW(manifest->file) + 2) * sizeof(WCHAR) )))
     {
-        RtlFreeHeap( GetProcessHeap(), 0, file );
+        RtlLeaveCriticalSection( &winsxs_section );
         RtlFreeUnicodeString( &path_us );
         return STATUS_NO_MEMORY;
     }
 
     path[path_us.Length/sizeof(WCHAR)] = '\\';
-    strcpyW( path + path_us.Length/sizeof(WCHAR) + 1, file );
+    file = path + path_us.Length/sizeof(WCHAR) + 1;
+    strcpyW( file, manifest->file );
     RtlInitUnicodeString( &path_us, path );
-    *strrchrW(file, '.') = 0;  /* remove .manifest extension */
 
-    if (!open_nt_file( &handle, &path_us ))
+    if ((file = strdupW( file )))
     {
-        io.u.Status = get_manifest_in_manifest_file(acl, &sxs_ai, path_us.Buffer, file, TRUE, handle);
-        NtClose( handle );
+        *strrchrW(file, '.') = 0;  /* remove .manifest extension */
+        status = get_winsxs_manifest( acl, &sxs_ai, manifest, &path_us, file );
+        RtlFreeHeap( GetProcessHeap(), 0, file );
     }
-    else io.u.Status = STATUS_NO_SUCH_FILE;
+    else status = STATUS_NO_MEMORY;
 
-    RtlFreeHeap( GetProcessHeap(), 0, file );
+    RtlLeaveCriticalSection( &winsxs_section );
     RtlFreeUnicodeString( &path_us );
-    return io.u.Status;
+    return status;
 }
 
 static NTSTATUS lookup_assembly(struct actctx_loader* acl,
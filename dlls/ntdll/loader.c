@@ -84,6 +84,11 @@ typedef struct _wine_modref
     LDR_MODULE            ldr;
     int                   nDeps;
     struct _wine_modref **deps;
+    struct _wine_modref  *next_basename;    /* next module in the same base name hash bucket */
+    struct _wine_modref  *next_fullname;    /* next module in the same full name hash bucket */
+    DWORD                *export_hash;      /* hash table of export name indexes, or NULL */
+    unsigned int          export_hash_size; /* size of the hash table, a power of 2 */
+    unsigned int          export_misses;    /* named lookups that weren't resolved by the hint */
 } WINE_MODREF;
 
 /* info about the current builtin dll load */
@@ -117,6 +122,29 @@ static WINE_MODREF *cached_modref;
 static WINE_MODREF *current_modref;
 static WINE_MODREF *last_failed_modref;
 
+/* address ranges of the loaded modules, sorted by base address; modified with the
+ * loader_section held, and read by address lookups under the shared lock only */
+struct module_range
+{
+    const char  *base;
+    const char  *end;
+    LDR_MODULE  *ldr;
+};
+
+static struct module_range *module_ranges;
+static unsigned int nb_module_ranges, max_module_ranges;
+static RTL_SRWLOCK module_ranges_lock = RTL_SRWLOCK_INIT;
+
+/* hash tables of the loaded modules by base and full name, each bucket in load order;
+ * protected by the loader_section */
+#define MODULE_HASH_SIZE 256
+static WINE_MODREF *basename_hash[MODULE_HASH_SIZE];
+static WINE_MODREF *fullname_hash[MODULE_HASH_SIZE];
+
+/* named exports are hashed once a module misses the import hint this many times */
+#define EXPORT_HASH_MISSES    8
+#define EXPORT_HASH_MIN_NAMES 32
+
 static NTSTATUS load_dll( LPCWSTR load_path, LPCWSTR libname, DWORD flags, WINE_MODREF** pwm );
 static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved );
 static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
@@ -336,6 +364,105 @@ static inline ULONG_PTR allocate_stub( const char *dll, const char *name ) { ret
 #endif  /* __i386__ */
 
 
+/*************************************************************************
+ *		find_module_range
+ *
+ * Find the index of the last module range starting at or before addr.
+ * The module_ranges_lock must be held while calling this function.
+ */
+static int find_module_range( const void *addr )
+{
+    int min = 0, max = nb_module_ranges - 1;
+
+    while (min <= max)
+    {
+        int pos = (min + max) / 2;
+        if ((const char *)addr < module_ranges[pos].base) max = pos - 1;
+        else min = pos + 1;
+    }
+    return max;
+}
+
+
+/*************************************************************************
+ *		find_module_by_address
+ *
+ * Find the module containing a given address, or NULL.
+ */
+static LDR_MODULE *find_module_by_address( const void *addr )
+{
+    LDR_MODULE *ret = NULL;
+    int pos;
+
+    RtlAcquireSRWLockShared( &module_ranges_lock );
+    if ((pos = find_module_range( addr )) >= 0 && (const char *)addr < module_ranges[pos].end)
+        ret = module_ranges[pos].ldr;
+    RtlReleaseSRWLockShared( &module_ranges_lock );
+    return ret;
+}
+
+
+/*************************************************************************
+ *		add_module_range
+ *
+ * Add a module to the address index.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL add_module_range( LDR_MODULE *ldr )
+{
+    struct module_range *new_ranges = NULL, *old_ranges = NULL;
+    int pos;
+
+    if (nb_module_ranges == max_module_ranges)
+    {
+        /* allocate outside of the lock, writers are serialized by the loader_section */
+        unsigned int new_max = max( 16, max_module_ranges * 2 );
+
+        if (!(new_ranges = RtlAllocateHeap( GetProcessHeap(), 0, new_max * sizeof(*new_ranges) )))
+            return FALSE;
+        memcpy( new_ranges, module_ranges, nb_module_ranges * sizeof(*new_ranges) );
+        RtlAcquireSRWLockExclusive( &module_ranges_lock );
+        old_ranges = module_ranges;
+        module_ranges = new_ranges;
+        max_module_ranges = new_max;
+    }
+    else RtlAcquireSRWLockExclusive( &module_ranges_lock );
+
+    pos = find_module_range( ldr->BaseAddress ) + 1;
+    memmove( &module_ranges[pos + 1], &module_ranges[pos],
+             (nb_module_ranges - pos) * sizeof(*module_ranges) );
+    module_ranges[pos].base = ldr->BaseAddress;
+    module_ranges[pos].end  = (const char *)ldr->BaseAddress + ldr->SizeOfImage;
+    module_ranges[pos].ldr  = ldr;
+    nb_module_ranges++;
+    RtlReleaseSRWLockExclusive( &module_ranges_lock );
+
+    RtlFreeHeap( GetProcessHeap(), 0, old_ranges );
+    return TRUE;
+}
+
+
+/*************************************************************************
+ *		remove_module_range
+ *
+ * Remove a module from the address index.
+ * The loader_section must be locked while calling this function.
+ */
+static void remove_module_range( LDR_MODULE *ldr )
+{
+    int pos;
+
+    RtlAcquireSRWLockExclusive( &module_ranges_lock );
+    if ((pos = find_module_range( ldr->BaseAddress )) >= 0 && module_ranges[pos].ldr == ldr)
+    {
+        nb_module_ranges--;
+        memmove( &module_ranges[pos], &module_ranges[pos + 1],
+                 (nb_module_ranges - pos) * sizeof(*module_ranges) );
+    }
+    RtlReleaseSRWLockExclusive( &module_ranges_lock );
+}
+
+
 /*************************************************************************
  *		get_modref
  *
@@ -344,19 +471,68 @@ static inline ULONG_PTR allocate_stub( const char *dll, const char *name ) { ret
  */
 static WINE_MODREF *get_modref( HMODULE hmod )
 {
-    PLIST_ENTRY mark, entry;
     PLDR_MODULE mod;
 
     if (cached_modref && cached_modref->ldr.BaseAddress == hmod) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+    if ((mod = find_module_by_address( hmod )) && mod->BaseAddress == hmod)
+        return cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+    return NULL;
+}
+
+
+/*************************************************************************
+ *		hash_module_name
+ */
+static unsigned int hash_module_name( const WCHAR *name )
+{
+    unsigned int hash = 0;
+
+    while (*name) hash = hash * 31 + tolowerW( *name++ );
+    return hash % MODULE_HASH_SIZE;
+}
+
+
+/*************************************************************************
+ *		add_module_names
+ *
+ * Add a module to the name hash tables.
+ * The loader_section must be locked while calling this function.
+ */
+static void add_module_names( WINE_MODREF *wm )
+{
+    WINE_MODREF **ptr;
+
+    wm->next_basename = wm->next_fullname = NULL;
+    for (ptr = &basename_hash[hash_module_name( wm->ldr.BaseDllName.Buffer )]; *ptr; ptr = &(*ptr)->next_basename);
+    *ptr = wm;
+    for (ptr = &fullname_hash[hash_module_name( wm->ldr.FullDllName.Buffer )]; *ptr; ptr = &(*ptr)->next_fullname);
+    *ptr = wm;
+}
+
+
+/*************************************************************************
+ *		remove_module_names
+ *
+ * Remove a module from the name hash tables.
+ * The loader_section must be locked while calling this function.
+ */
+static void remove_module_names( WINE_MODREF *wm )
+{
+    WINE_MODREF **ptr;
+
+    for (ptr = &basename_hash[hash_module_name( wm->ldr.BaseDllName.Buffer )]; *ptr; ptr = &(*ptr)->next_basename)
     {
-        mod = CONTAINING_RECORD(entry, LDR_MODULE, InMemoryOrderModuleList);
-        if (mod->BaseAddress == hmod)
-            return cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+        if (*ptr != wm) continue;
+        *ptr = wm->next_basename;
+        break;
+    }
+    for (ptr = &fullname_hash[hash_module_name( wm->ldr.FullDllName.Buffer )]; *ptr; ptr = &(*ptr)->next_fullname)
+    {
+        if (*ptr != wm) continue;
+        *ptr = wm->next_fullname;
+        break;
     }
-    return NULL;
 }
 
 
@@ -368,21 +544,13 @@ static WINE_MODREF *get_modref( HMODULE hmod )
  */
 static WINE_MODREF *find_basename_module( LPCWSTR name )
 {
-    PLIST_ENTRY mark, entry;
+    WINE_MODREF *wm;
 
     if (cached_modref && !strcmpiW( name, cached_modref->ldr.BaseDllName.Buffer ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
-    {
-        LDR_MODULE *mod = CONTAINING_RECORD(entry, LDR_MODULE, InLoadOrderModuleList);
-        if (!strcmpiW( name, mod->BaseDllName.Buffer ))
-        {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-            return cached_modref;
-        }
-    }
+    for (wm = basename_hash[hash_module_name( name )]; wm; wm = wm->next_basename)
+        if (!strcmpiW( name, wm->ldr.BaseDllName.Buffer )) return cached_modref = wm;
     return NULL;
 }
 
@@ -395,21 +563,13 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
  */
 static WINE_MODREF *find_fullname_module( LPCWSTR name )
 {
-    PLIST_ENTRY mark, entry;
+    WINE_MODREF *wm;
 
     if (cached_modref && !strcmpiW( name, cached_modref->ldr.FullDllName.Buffer ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
-    {
-        LDR_MODULE *mod = CONTAINING_RECORD(entry, LDR_MODULE, InLoadOrderModuleList);
-        if (!strcmpiW( name, mod->FullDllName.Buffer ))
-        {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-            return cached_modref;
-        }
-    }
+    for (wm = fullname_hash[hash_module_name( name )]; wm; wm = wm->next_fullname)
+        if (!strcmpiW( name, wm->ldr.FullDllName.Buffer )) return cached_modref = wm;
     return NULL;
 }
 
@@ -521,6 +681,71 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
 }
 
 
+/*************************************************************************
+ *		hash_export_name
+ */
+static inline unsigned int hash_export_name( const char *name )
+{
+    unsigned int hash = 5381;
+
+    while (*name) hash = hash * 33 + (unsigned char)*name++;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		find_hashed_export
+ *
+ * Find the index of an export name through the module hash table, building the
+ * table once the module has missed enough import hints to make it worthwhile.
+ * Returns FALSE if the module doesn't use a hash table.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL find_hashed_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+                                const char *name, int *index )
+{
+    const DWORD *names = get_rva( module, exports->AddressOfNames );
+    WINE_MODREF *wm;
+    unsigned int i, pos, mask;
+
+    if (exports->NumberOfNames < EXPORT_HASH_MIN_NAMES) return FALSE;
+    if (!(wm = get_modref( module ))) return FALSE;
+
+    if (!wm->export_hash)
+    {
+        if (++wm->export_misses < EXPORT_HASH_MISSES) return FALSE;
+
+        for (wm->export_hash_size = 64; wm->export_hash_size < 2 * exports->NumberOfNames; )
+            wm->export_hash_size *= 2;
+        if (!(wm->export_hash = RtlAllocateHeap( GetProcessHeap(), 0,
+                                                 wm->export_hash_size * sizeof(*wm->export_hash) )))
+        {
+            wm->export_misses = 0;
+            return FALSE;
+        }
+        memset( wm->export_hash, 0xff, wm->export_hash_size * sizeof(*wm->export_hash) );
+        mask = wm->export_hash_size - 1;
+        for (i = 0; i < exports->NumberOfNames; i++)
+        {
+            pos = hash_export_name( get_rva( module, names[i] )) & mask;
+            while (wm->export_hash[pos] != ~0u) pos = (pos + 1) & mask;
+            wm->export_hash[pos] = i;
+        }
+        TRACE( "hashed %u exports of %s\n", exports->NumberOfNames, debugstr_w(wm->ldr.BaseDllName.Buffer) );
+    }
+
+    mask = wm->export_hash_size - 1;
+    for (pos = hash_export_name( name ) & mask; wm->export_hash[pos] != ~0u; pos = (pos + 1) & mask)
+    {
+        if (strcmp( get_rva( module, names[wm->export_hash[pos]] ), name )) continue;
+        *index = wm->export_hash[pos];
+        return TRUE;
+    }
+    *index = -1;
+    return TRUE;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -532,7 +757,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
 {
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
-    int min = 0, max = exports->NumberOfNames - 1;
+    int min = 0, max = exports->NumberOfNames - 1, index;
 
     /* first check the hint */
     if (hint >= 0 && hint <= max)
@@ -542,6 +767,13 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
+    /* then the hash table */
+    if (find_hashed_export( module, exports, name, &index ))
+    {
+        if (index == -1) return NULL;
+        return find_ordinal_export( module, exports, exp_size, ordinals[index], load_path );
+    }
+
     /* then do a binary search */
     while (min <= max)
     {
@@ -940,6 +1172,9 @@ static WINE_MODREF *alloc_module( HMODULE hModule, LPCWSTR filename )
 
     wm->nDeps    = 0;
     wm->deps     = NULL;
+    wm->export_hash = NULL;
+    wm->export_hash_size = 0;
+    wm->export_misses = 0;
 
     wm->ldr.BaseAddress   = hModule;
     wm->ldr.EntryPoint    = NULL;
@@ -965,10 +1200,17 @@ static WINE_MODREF *alloc_module( HMODULE hModule, LPCWSTR filename )
             wm->ldr.EntryPoint = (char *)hModule + nt->OptionalHeader.AddressOfEntryPoint;
     }
 
+    if (!add_module_range( &wm->ldr ))
+    {
+        RtlFreeUnicodeString( &wm->ldr.FullDllName );
+        RtlFreeHeap( GetProcessHeap(), 0, wm );
+        return NULL;
+    }
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList,
                    &wm->ldr.InLoadOrderModuleList);
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderModuleList);
+    add_module_names( wm );
 
     /* wait until init is called for inserting into this list */
     wm->ldr.InInitializationOrderModuleList.Flink = NULL;
@@ -1370,21 +1612,11 @@ NTSTATUS WINAPI LdrDisableThreadCalloutsForDll(HMODULE hModule)
  */
 NTSTATUS WINAPI LdrFindEntryForAddress(const void* addr, PLDR_MODULE* pmod)
 {
-    PLIST_ENTRY mark, entry;
     PLDR_MODULE mod;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
-    {
-        mod = CONTAINING_RECORD(entry, LDR_MODULE, InMemoryOrderModuleList);
-        if (mod->BaseAddress <= addr &&
-            (const char *)addr < (char*)mod->BaseAddress + mod->SizeOfImage)
-        {
-            *pmod = mod;
-            return STATUS_SUCCESS;
-        }
-    }
-    return STATUS_NO_MORE_ENTRIES;
+    if (!(mod = find_module_by_address( addr ))) return STATUS_NO_MORE_ENTRIES;
+    *pmod = mod;
+    return STATUS_SUCCESS;
 }
 
 /******************************************************************
@@ -1609,6 +1841,8 @@ static void load_builtin_callback( void *module, const char *filename )
             /* the module has only be inserted in the load & memory order lists */
             RemoveEntryList(&wm->ldr.InLoadOrderModuleList);
             RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
+            remove_module_range( &wm->ldr );
+            remove_module_names( wm );
             /* FIXME: free the modref */
             builtin_load_info->status = STATUS_DLL_NOT_FOUND;
             return;
@@ -1823,6 +2057,8 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
             /* the module has only be inserted in the load & memory order lists */
             RemoveEntryList(&wm->ldr.InLoadOrderModuleList);
             RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
+            remove_module_range( &wm->ldr );
+            remove_module_names( wm );
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -2801,6 +3037,8 @@ static void free_modref( WINE_MODREF *wm )
 {
     RemoveEntryList(&wm->ldr.InLoadOrderModuleList);
     RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
+    remove_module_range( &wm->ldr );
+    remove_module_names( wm );
     if (wm->ldr.InInitializationOrderModuleList.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderModuleList);
 
@@ -2823,6 +3061,7 @@ static void free_modref( WINE_MODREF *wm )
     NtUnmapViewOfSection( NtCurrentProcess(), wm->ldr.BaseAddress );
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm->deps );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
@@ -3255,6 +3494,7 @@ void CDECL __wine_init_windows_dir( const WCHAR *windir, const WCHAR *sysdir )
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
         LDR_MODULE *mod = CONTAINING_RECORD( entry, LDR_MODULE, InLoadOrderModuleList );
+        WINE_MODREF *wm = CONTAINING_RECORD( mod, WINE_MODREF, ldr );
 
         assert( mod->Flags & LDR_WINE_INTERNAL );
 
@@ -3265,8 +3505,12 @@ void CDECL __wine_init_windows_dir( const WCHAR *windir, const WCHAR *sysdir )
         p = buffer + strlenW( buffer );
         if (p > buffer && p[-1] != '\\') *p++ = '\\';
         strcpyW( p, mod->FullDllName.Buffer );
+
+        /* the names are changing, so are the hash buckets */
+        remove_module_names( wm );
         RtlInitUnicodeString( &mod->FullDllName, buffer );
         RtlInitUnicodeString( &mod->BaseDllName, p );
+        add_module_names( wm );
     }
 }
 
@@ -1488,6 +1488,10 @@
 # signal handling
 @ cdecl __wine_set_signal_handler(long ptr)
 
+# Synchronization
+@ cdecl __wine_futex_wait(ptr long)
+@ cdecl __wine_futex_wake(ptr long)
+
 # Filesystem
 @ cdecl wine_nt_to_unix_file_name(ptr ptr long long)
 @ cdecl wine_unix_to_nt_file_name(ptr ptr)
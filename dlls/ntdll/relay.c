@@ -23,9 +23,21 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -69,6 +81,7 @@ struct relay_private_data
 {
     HMODULE                  module;            /* module handle of this dll */
     unsigned int             base;              /* ordinal base */
+    unsigned int             log_index;         /* module index in the binary log */
     char                     dllname[40];       /* dll name (without .dll extension) */
     struct relay_entry_point entry_points[1];   /* list of dll entry points */
 };
@@ -84,6 +97,208 @@ static const WCHAR **debug_from_snoop_includelist;
 
 static RTL_RUN_ONCE init_once = RTL_RUN_ONCE_INIT;
 
+/* Binary relay log
+ *
+ * When WINERELAYLOG is set to a directory, calls traced by +relay and +snoop are not
+ * printed but stored as fixed-size records in a ring buffer mapped from the file
+ * <dir>/<pid>-<tid>.relay, one per thread. Module and function names go once to
+ * <dir>/<pid>.modules. The logs are decoded with tools/decode-relay.
+ */
+
+#define RELAY_LOG_MAGIC      0x474f4c52  /* "RLOG" */
+#define RELAY_LOG_VERSION    1
+#define RELAY_LOG_RECORDS    65536       /* records per thread, must be a power of 2 */
+#define RELAY_LOG_MAX_ARGS   8
+
+/* record types */
+#define RELAY_LOG_CALL       1
+#define RELAY_LOG_RET        2
+#define RELAY_LOG_SNOOP_CALL 3
+#define RELAY_LOG_SNOOP_RET  4
+#define RELAY_LOG_RETVAL64   0x8000      /* flag: 64-bit return value */
+
+#define RELAY_LOG_UNKNOWN_ARGS 0xffff
+
+struct relay_log_header
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int header_size;
+    unsigned int record_size;
+    unsigned int nb_records;          /* size of the ring buffer */
+    unsigned int pid;
+    unsigned int tid;
+    unsigned int ptr_size;            /* size of pointers in the traced process */
+    ULONGLONG    frequency;           /* timestamp ticks per second */
+    ULONGLONG    count;               /* number of records written so far */
+};
+
+struct relay_log_record
+{
+    ULONGLONG      time;              /* performance counter */
+    unsigned int   func;              /* module index << 16 | ordinal - ordinal base */
+    unsigned short type;              /* record type */
+    unsigned short nb_args;           /* number of arguments of the call */
+    ULONGLONG      ret_addr;          /* caller return address */
+    ULONGLONG      args[RELAY_LOG_MAX_ARGS];  /* call arguments, or return value in args[0] */
+};
+
+C_ASSERT( sizeof(struct relay_log_header) == 48 );
+C_ASSERT( sizeof(struct relay_log_record) == 88 );
+
+#define RELAY_LOG_FAILED ((struct relay_log_header *)~(ULONG_PTR)0)
+
+static char *relay_log_dir;
+static int relay_log_modules_fd = -1;
+static LONG relay_log_nb_modules;
+static ULONGLONG relay_log_frequency;
+
+/***********************************************************************
+ *           init_relay_log
+ */
+static void init_relay_log(void)
+{
+    const char *dir = getenv( "WINERELAYLOG" );
+    LARGE_INTEGER counter, frequency;
+    char *name;
+
+    if (!dir || !*dir) return;
+
+    mkdir( dir, 0777 );
+    if (!(name = RtlAllocateHeap( GetProcessHeap(), 0, strlen(dir) + sizeof("/12345678.modules") )))
+        return;
+    sprintf( name, "%s/%04x.modules", dir, GetCurrentProcessId() );
+    if ((relay_log_modules_fd = open( name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666 )) == -1)
+    {
+        ERR( "cannot create %s (%s), binary relay log disabled\n", name, strerror(errno) );
+        RtlFreeHeap( GetProcessHeap(), 0, name );
+        return;
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, name );
+
+    NtQueryPerformanceCounter( &counter, &frequency );
+    relay_log_frequency = frequency.QuadPart;
+    if ((relay_log_dir = RtlAllocateHeap( GetProcessHeap(), 0, strlen(dir) + 1 )))
+        strcpy( relay_log_dir, dir );
+}
+
+/***********************************************************************
+ *           relay_log_add_module
+ *
+ * Allocate a binary log index for a module and store the names of its exports.
+ */
+static unsigned int relay_log_add_module( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+                                          const char *name )
+{
+    const DWORD *names = (const DWORD *)((const char *)module + exports->AddressOfNames);
+    const WORD *ordinals = (const WORD *)((const char *)module + exports->AddressOfNameOrdinals);
+    unsigned int i, index = interlocked_xchg_add( &relay_log_nb_modules, 1 );
+    char buffer[1024];
+    int pos;
+
+    pos = sprintf( buffer, "module %u %.64s %u\n", index, name, exports->Base );
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        if (pos > sizeof(buffer) - 300)
+        {
+            write( relay_log_modules_fd, buffer, pos );
+            pos = 0;
+        }
+        pos += sprintf( buffer + pos, "func %u %u %.256s\n", index, ordinals[i],
+                        (const char *)module + names[i] );
+    }
+    write( relay_log_modules_fd, buffer, pos );
+    return index;
+}
+
+/***********************************************************************
+ *           create_thread_relay_log
+ */
+static struct relay_log_header *create_thread_relay_log(void)
+{
+    const size_t size = sizeof(struct relay_log_header) + RELAY_LOG_RECORDS * sizeof(struct relay_log_record);
+    struct relay_log_header *log = RELAY_LOG_FAILED;
+    char *name;
+    void *ptr;
+    int fd;
+
+    if (!(name = RtlAllocateHeap( GetProcessHeap(), 0, strlen(relay_log_dir) + sizeof("/12345678-12345678.relay") )))
+        goto done;
+    sprintf( name, "%s/%04x-%04x.relay", relay_log_dir, GetCurrentProcessId(), GetCurrentThreadId() );
+    if ((fd = open( name, O_RDWR | O_CREAT | O_TRUNC, 0666 )) == -1)
+    {
+        ERR( "cannot create %s (%s)\n", name, strerror(errno) );
+        goto done;
+    }
+    if (ftruncate( fd, size ) != -1 &&
+        (ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) != MAP_FAILED)
+    {
+        log = ptr;
+        log->magic       = RELAY_LOG_MAGIC;
+        log->version     = RELAY_LOG_VERSION;
+        log->header_size = sizeof(*log);
+        log->record_size = sizeof(struct relay_log_record);
+        log->nb_records  = RELAY_LOG_RECORDS;
+        log->pid         = GetCurrentProcessId();
+        log->tid         = GetCurrentThreadId();
+        log->ptr_size    = sizeof(void *);
+        log->frequency   = relay_log_frequency;
+        log->count       = 0;
+    }
+    else ERR( "cannot map %s (%s)\n", name, strerror(errno) );
+    close( fd );
+
+done:
+    RtlFreeHeap( GetProcessHeap(), 0, name );
+    return log;
+}
+
+/***********************************************************************
+ *           relay_log_write
+ *
+ * Append a record to the binary log of the current thread.
+ */
+static void relay_log_write( unsigned short type, unsigned int func, ULONG_PTR ret_addr,
+                             const INT_PTR *args, unsigned int nb_args, ULONGLONG retval )
+{
+    struct relay_log_header *log = ntdll_get_thread_data()->relay_log;
+    struct relay_log_record *record;
+    LARGE_INTEGER counter;
+    unsigned int i;
+
+    if (!log) log = ntdll_get_thread_data()->relay_log = create_thread_relay_log();
+    if (log == RELAY_LOG_FAILED) return;
+
+    NtQueryPerformanceCounter( &counter, NULL );
+    record = (struct relay_log_record *)(log + 1) + (log->count & (RELAY_LOG_RECORDS - 1));
+    record->time     = counter.QuadPart;
+    record->func     = func;
+    record->type     = type;
+    record->nb_args  = nb_args;
+    record->ret_addr = ret_addr;
+    if (args)
+    {
+        if (nb_args > RELAY_LOG_MAX_ARGS) nb_args = RELAY_LOG_MAX_ARGS;
+        for (i = 0; i < nb_args; i++) record->args[i] = (ULONG_PTR)args[i];
+    }
+    else record->args[0] = retval;
+    log->count++;  /* only count the record once it's complete */
+}
+
+/***********************************************************************
+ *           RELAY_CloseThreadLog
+ *
+ * Unmap the binary relay log of the current thread on thread exit.
+ */
+void RELAY_CloseThreadLog(void)
+{
+    struct relay_log_header *log = ntdll_get_thread_data()->relay_log;
+
+    if (!log || log == RELAY_LOG_FAILED) return;
+    ntdll_get_thread_data()->relay_log = RELAY_LOG_FAILED;
+    munmap( log, sizeof(*log) + RELAY_LOG_RECORDS * sizeof(struct relay_log_record) );
+}
+
 /* compare an ASCII and a Unicode string without depending on the current codepage */
 static inline int strcmpAW( const char *strA, const WCHAR *strW )
 {
@@ -190,6 +405,8 @@ static DWORD WINAPI init_debug_lists( RTL_RUN_ONCE *once, void *param, void **co
     static const WCHAR SnoopFromIncludeW[] = {'S','n','o','o','p','F','r','o','m','I','n','c','l','u','d','e',0};
     static const WCHAR SnoopFromExcludeW[] = {'S','n','o','o','p','F','r','o','m','E','x','c','l','u','d','e',0};
 
+    init_relay_log();
+
     RtlOpenCurrentUser( KEY_ALL_ACCESS, &root );
     attr.Length = sizeof(attr);
     attr.RootDirectory = root;
@@ -339,6 +556,13 @@ void * WINAPI relay_trace_entry( struct relay_descr *descr, unsigned int idx, co
 
     if (TRACE_ON(relay))
     {
+        if (relay_log_dir)
+        {
+            relay_log_write( RELAY_LOG_CALL, (data->log_index << 16) | ordinal, stack[0],
+                             stack + 1, nb_args, 0 );
+            return entry_point->orig_func;
+        }
+
         if (TRACE_ON(timestamp)) print_timestamp();
 
         if (TRACE_ON(pid))
@@ -367,6 +591,14 @@ void WINAPI relay_trace_exit( struct relay_descr *descr, unsigned int idx,
 
     if (!TRACE_ON(relay)) return;
 
+    if (relay_log_dir)
+    {
+        relay_log_write( (flags & 1) ? RELAY_LOG_RET | RELAY_LOG_RETVAL64 : RELAY_LOG_RET,
+                         (data->log_index << 16) | ordinal, stack[0], NULL, 0,
+                         (flags & 1) ? retval : (UINT_PTR)retval );
+        return;
+    }
+
     if (TRACE_ON(timestamp)) print_timestamp();
 
     if (TRACE_ON(pid))
@@ -726,6 +958,7 @@ void RELAY_SetupDLL( HMODULE module )
     len = min( len, sizeof(data->dllname) - 1 );
     memcpy( data->dllname, (char *)module + exports->Name, len );
     data->dllname[len] = 0;
+    if (relay_log_dir) data->log_index = relay_log_add_module( module, exports, data->dllname );
 
     /* fetch name pointer for all entry points and store them in the private structure */
 
@@ -763,6 +996,10 @@ void RELAY_SetupDLL( HMODULE module )
 {
 }
 
+void RELAY_CloseThreadLog(void)
+{
+}
+
 #endif  /* __i386__ || __x86_64__ || __arm__ */
 
 
@@ -797,6 +1034,7 @@ typedef struct tagSNOOP_DLL {
 	DWORD		ordbase;
 	DWORD		nrofordinals;
 	struct tagSNOOP_DLL	*next;
+	unsigned int	log_index;	/* module index in the binary log */
 	char name[1];
 } SNOOP_DLL;
 
@@ -894,6 +1132,7 @@ void SNOOP_SetupDLL(HMODULE hmod)
     strcpy( (*dll)->name, name );
     p = (*dll)->name + strlen((*dll)->name) - 4;
     if (p > (*dll)->name && !strcasecmp( p, ".dll" )) *p = 0;
+    if (relay_log_dir) (*dll)->log_index = relay_log_add_module( hmod, exports, (*dll)->name );
 
     size = exports->NumberOfFunctions * sizeof(SNOOP_FUN);
     addr = NULL;
@@ -1087,6 +1326,14 @@ void WINAPI __regs_SNOOP_Entry( CONTEXT *context )
 
         if (!TRACE_ON(snoop)) return;
 
+        if (relay_log_dir)
+        {
+            relay_log_write( RELAY_LOG_SNOOP_CALL, (dll->log_index << 16) | ordinal,
+                             (ULONG_PTR)ret->origreturn, (const INT_PTR *)(context->Esp + 4),
+                             fun->nrofargs < 0 ? RELAY_LOG_UNKNOWN_ARGS : fun->nrofargs, 0 );
+            return;
+        }
+
 	if (TRACE_ON(timestamp))
 		print_timestamp();
 	if (fun->name) DPRINTF("%04x:CALL %s.%s(",GetCurrentThreadId(),dll->name,fun->name);
@@ -1129,6 +1376,14 @@ void WINAPI __regs_SNOOP_Return( CONTEXT *context )
             return;
         }
 
+        if (relay_log_dir)
+        {
+            relay_log_write( RELAY_LOG_SNOOP_RET, (ret->dll->log_index << 16) | ret->ordinal,
+                             (ULONG_PTR)ret->origreturn, NULL, 0, context->Eax );
+            ret->origreturn = NULL; /* mark as empty */
+            return;
+        }
+
 	if (TRACE_ON(timestamp))
 		print_timestamp();
 	if (ret->args) {
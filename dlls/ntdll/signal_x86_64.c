@@ -64,7 +64,6 @@
 #include "winternl.h"
 #include "wine/library.h"
 #include "wine/exception.h"
-#include "wine/list.h"
 #include "ntdll_misc.h"
 #include "wine/debug.h"
 
@@ -314,12 +313,13 @@ static wine_signal_handler handlers[256];
 
 struct dynamic_unwind_entry
 {
-    struct list entry;
-
     /* memory region which matches this entry */
     DWORD64 base;
     DWORD size;
 
+    /* highest end address of this entry and of all the preceding ones in the table */
+    DWORD64 max_end;
+
     /* lookup table */
     RUNTIME_FUNCTION *table;
     DWORD table_size;
@@ -329,7 +329,11 @@ struct dynamic_unwind_entry
     PVOID context;
 };
 
-static struct list dynamic_unwind_list = LIST_INIT(dynamic_unwind_list);
+/* entries sorted by base address; modified with the dynamic_unwind_section held,
+ * and read by lookups under the shared lock only */
+static struct dynamic_unwind_entry **dynamic_unwind_table;
+static unsigned int dynamic_unwind_count, dynamic_unwind_max;
+static RTL_SRWLOCK dynamic_unwind_lock = RTL_SRWLOCK_INIT;
 
 static RTL_CRITICAL_SECTION dynamic_unwind_section;
 static RTL_CRITICAL_SECTION_DEBUG dynamic_unwind_debug =
@@ -2205,6 +2209,31 @@ static RUNTIME_FUNCTION *find_function_info( ULONG64 pc, HMODULE module,
     return NULL;
 }
 
+/**********************************************************************
+ *           find_dynamic_unwind_entry
+ *
+ * The dynamic_unwind_lock must be held while calling this function.
+ */
+static struct dynamic_unwind_entry *find_dynamic_unwind_entry( ULONG64 pc )
+{
+    int min = 0, max = dynamic_unwind_count - 1, pos;
+
+    /* find the last entry starting at or before pc... */
+    while (min <= max)
+    {
+        pos = (min + max) / 2;
+        if (pc < dynamic_unwind_table[pos]->base) max = pos - 1;
+        else min = pos + 1;
+    }
+    /* ...and walk back through the entries which may still cover it */
+    for (pos = max; pos >= 0 && pc < dynamic_unwind_table[pos]->max_end; pos--)
+    {
+        if (pc < dynamic_unwind_table[pos]->base + dynamic_unwind_table[pos]->size)
+            return dynamic_unwind_table[pos];
+    }
+    return NULL;
+}
+
 /**********************************************************************
  *           lookup_function_info
  */
@@ -2212,6 +2241,8 @@ static RUNTIME_FUNCTION *lookup_function_info( ULONG64 pc, ULONG64 *base, LDR_MO
 {
     RUNTIME_FUNCTION *func = NULL;
     struct dynamic_unwind_entry *entry;
+    PGET_RUNTIME_FUNCTION_CALLBACK callback = NULL;
+    PVOID context = NULL;
     ULONG size;
 
     /* PE module or wine module */
@@ -2229,22 +2260,24 @@ static RUNTIME_FUNCTION *lookup_function_info( ULONG64 pc, ULONG64 *base, LDR_MO
     {
         *module = NULL;
 
-        RtlEnterCriticalSection( &dynamic_unwind_section );
-        LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
+        RtlAcquireSRWLockShared( &dynamic_unwind_lock );
+        if ((entry = find_dynamic_unwind_entry( pc )))
         {
-            if (pc >= entry->base && pc < entry->base + entry->size)
-            {
-                *base = entry->base;
+            *base = entry->base;
 
-                /* use callback or lookup in function table */
-                if (entry->callback)
-                    func = entry->callback( pc, entry->context );
-                else
-                    func = find_function_info( pc, (HMODULE)entry->base, entry->table, entry->table_size );
-                break;
+            /* use callback or lookup in function table */
+            if (entry->callback)
+            {
+                callback = entry->callback;
+                context  = entry->context;
             }
+            else
+                func = find_function_info( pc, (HMODULE)entry->base, entry->table, entry->table_size );
         }
-        RtlLeaveCriticalSection( &dynamic_unwind_section );
+        RtlReleaseSRWLockShared( &dynamic_unwind_lock );
+
+        /* the callback may add or delete function tables itself */
+        if (callback) func = callback( pc, context );
     }
 
     return func;
@@ -3000,6 +3033,67 @@ void signal_init_process(void)
 }
 
 
+/**********************************************************************
+ *           update_dynamic_unwind_max_end
+ *
+ * The dynamic_unwind_lock must be held exclusively while calling this function.
+ */
+static void update_dynamic_unwind_max_end( unsigned int pos )
+{
+    for (; pos < dynamic_unwind_count; pos++)
+    {
+        struct dynamic_unwind_entry *entry = dynamic_unwind_table[pos];
+
+        entry->max_end = entry->base + entry->size;
+        if (pos && dynamic_unwind_table[pos - 1]->max_end > entry->max_end)
+            entry->max_end = dynamic_unwind_table[pos - 1]->max_end;
+    }
+}
+
+/**********************************************************************
+ *           add_dynamic_unwind_entry
+ */
+static BOOL add_dynamic_unwind_entry( struct dynamic_unwind_entry *entry )
+{
+    struct dynamic_unwind_entry **new_table = NULL, **old_table = NULL;
+    unsigned int pos, new_max = 0;
+
+    RtlEnterCriticalSection( &dynamic_unwind_section );
+    if (dynamic_unwind_count == dynamic_unwind_max)
+    {
+        /* allocate outside of the lock, writers are serialized by the critical section */
+        new_max = max( 16, dynamic_unwind_max * 2 );
+        if (!(new_table = RtlAllocateHeap( GetProcessHeap(), 0, new_max * sizeof(*new_table) )))
+        {
+            RtlLeaveCriticalSection( &dynamic_unwind_section );
+            return FALSE;
+        }
+        memcpy( new_table, dynamic_unwind_table, dynamic_unwind_count * sizeof(*new_table) );
+    }
+
+    RtlAcquireSRWLockExclusive( &dynamic_unwind_lock );
+    if (new_table)
+    {
+        old_table = dynamic_unwind_table;
+        dynamic_unwind_table = new_table;
+        dynamic_unwind_max = new_max;
+    }
+    /* lookups walk backwards, insert before the entries with the same base so that
+     * the older ones still take precedence */
+    for (pos = dynamic_unwind_count; pos > 0; pos--)
+        if (dynamic_unwind_table[pos - 1]->base < entry->base) break;
+    memmove( &dynamic_unwind_table[pos + 1], &dynamic_unwind_table[pos],
+             (dynamic_unwind_count - pos) * sizeof(*dynamic_unwind_table) );
+    dynamic_unwind_table[pos] = entry;
+    dynamic_unwind_count++;
+    update_dynamic_unwind_max_end( pos );
+    RtlReleaseSRWLockExclusive( &dynamic_unwind_lock );
+    RtlLeaveCriticalSection( &dynamic_unwind_section );
+
+    RtlFreeHeap( GetProcessHeap(), 0, old_table );
+    return TRUE;
+}
+
 /**********************************************************************
  *              RtlAddFunctionTable   (NTDLL.@)
  */
@@ -3022,11 +3116,9 @@ BOOLEAN CDECL RtlAddFunctionTable( RUNTIME_FUNCTION *table, DWORD count, DWORD64
     entry->callback   = NULL;
     entry->context    = NULL;
 
-    RtlEnterCriticalSection( &dynamic_unwind_section );
-    list_add_tail( &dynamic_unwind_list, &entry->entry );
-    RtlLeaveCriticalSection( &dynamic_unwind_section );
-
-    return TRUE;
+    if (add_dynamic_unwind_entry( entry )) return TRUE;
+    RtlFreeHeap( GetProcessHeap(), 0, entry );
+    return FALSE;
 }
 
 
@@ -3057,11 +3149,9 @@ BOOLEAN CDECL RtlInstallFunctionTableCallback( DWORD64 table, DWORD64 base, DWOR
     entry->callback   = callback;
     entry->context    = context;
 
-    RtlEnterCriticalSection( &dynamic_unwind_section );
-    list_add_tail( &dynamic_unwind_list, &entry->entry );
-    RtlLeaveCriticalSection( &dynamic_unwind_section );
-
-    return TRUE;
+    if (add_dynamic_unwind_entry( entry )) return TRUE;
+    RtlFreeHeap( GetProcessHeap(), 0, entry );
+    return FALSE;
 }
 
 
@@ -3070,17 +3160,23 @@ BOOLEAN CDECL RtlInstallFunctionTableCallback( DWORD64 table, DWORD64 base, DWOR
  */
 BOOLEAN CDECL RtlDeleteFunctionTable( RUNTIME_FUNCTION *table )
 {
-    struct dynamic_unwind_entry *entry, *to_free = NULL;
+    struct dynamic_unwind_entry *to_free = NULL;
+    unsigned int pos;
 
     TRACE( "%p\n", table );
 
     RtlEnterCriticalSection( &dynamic_unwind_section );
-    LIST_FOR_EACH_ENTRY( entry, &dynamic_unwind_list, struct dynamic_unwind_entry, entry )
+    for (pos = 0; pos < dynamic_unwind_count; pos++)
     {
-        if (entry->table == table)
+        if (dynamic_unwind_table[pos]->table == table)
         {
-            to_free = entry;
-            list_remove( &entry->entry );
+            to_free = dynamic_unwind_table[pos];
+            RtlAcquireSRWLockExclusive( &dynamic_unwind_lock );
+            dynamic_unwind_count--;
+            memmove( &dynamic_unwind_table[pos], &dynamic_unwind_table[pos + 1],
+                     (dynamic_unwind_count - pos) * sizeof(*dynamic_unwind_table) );
+            update_dynamic_unwind_max_end( pos );
+            RtlReleaseSRWLockExclusive( &dynamic_unwind_lock );
             break;
         }
     }
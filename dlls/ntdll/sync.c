@@ -42,6 +42,9 @@
 #ifdef HAVE_SCHED_H
 # include <sched.h>
 #endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -1881,3 +1884,62 @@ NTSTATUS WINAPI RtlSleepConditionVariableSRW( RTL_CONDITION_VARIABLE *variable,
         RtlAcquireSRWLockExclusive( lock );
     return status;
 }
+
+#if defined(__linux__) && defined(__NR_futex)
+
+static inline int shared_futex_wait( LONG *addr, LONG val )
+{
+    return syscall( __NR_futex, addr, 0 /* FUTEX_WAIT */, val, NULL, 0, 0 );
+}
+
+static inline int shared_futex_wake( LONG *addr, LONG count )
+{
+    return syscall( __NR_futex, addr, 1 /* FUTEX_WAKE */, count, NULL, 0, 0 );
+}
+
+static inline BOOL use_shared_futexes(void)
+{
+    static LONG supported = -1;
+
+    if (supported == -1)
+    {
+        shared_futex_wait( &supported, 10 );
+        supported = (errno != ENOSYS);
+    }
+    return supported;
+}
+
+#else
+
+static inline int shared_futex_wait( LONG *addr, LONG val ) { return -1; }
+static inline int shared_futex_wake( LONG *addr, LONG count ) { return -1; }
+static inline BOOL use_shared_futexes(void) { return FALSE; }
+
+#endif
+
+/***********************************************************************
+ *           __wine_futex_wait   (NTDLL.@)
+ *
+ * Wait until the value at addr differs from val or a wake-up is sent to
+ * addr with __wine_futex_wake. The value may live in memory shared with
+ * other processes. The caller has to check the value again on return,
+ * the wait can end spuriously.
+ */
+NTSTATUS CDECL __wine_futex_wait( LONG *addr, LONG val )
+{
+    if (!use_shared_futexes()) return STATUS_NOT_IMPLEMENTED;
+    shared_futex_wait( addr, val );
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           __wine_futex_wake   (NTDLL.@)
+ *
+ * Wake up to count threads waiting on addr with __wine_futex_wait.
+ */
+NTSTATUS CDECL __wine_futex_wake( LONG *addr, LONG count )
+{
+    if (!use_shared_futexes()) return STATUS_NOT_IMPLEMENTED;
+    shared_futex_wake( addr, count );
+    return STATUS_SUCCESS;
+}
@@ -1833,10 +1833,13 @@ static RUNTIME_FUNCTION* CALLBACK dynamic_unwind_callback( DWORD64 pc, PVOID con
 static void test_dynamic_unwind(void)
 {
     static const int code_offset = 1024;
+    static const unsigned int order[] = { 3, 0, 4, 2, 1 };
     char buf[sizeof(RUNTIME_FUNCTION) + 4];
     RUNTIME_FUNCTION *runtime_func, *func;
+    RUNTIME_FUNCTION tables[5];
     ULONG_PTR table, base;
     DWORD count;
+    unsigned int i;
 
     /* Test RtlAddFunctionTable with aligned RUNTIME_FUNCTION pointer */
     runtime_func = (RUNTIME_FUNCTION *)buf;
@@ -1932,6 +1935,31 @@ static void test_dynamic_unwind(void)
     ok( !pRtlDeleteFunctionTable( (PRUNTIME_FUNCTION)table ),
         "RtlDeleteFunctionTable returned success for nonexistent table = %p\n", (PVOID)table );
 
+    /* Several tables, not added in address order */
+    for (i = 0; i < sizeof(order) / sizeof(order[0]); i++)
+    {
+        tables[order[i]].BeginAddress = 0;
+        tables[order[i]].EndAddress   = 16;
+        tables[order[i]].UnwindData   = 0;
+        ok( pRtlAddFunctionTable( &tables[order[i]], 1, (ULONG_PTR)code_mem + order[i] * 64 ),
+            "RtlAddFunctionTable failed for table %u\n", order[i] );
+    }
+    for (i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+    {
+        base = 0xdeadbeef;
+        func = pRtlLookupFunctionEntry( (ULONG_PTR)code_mem + i * 64 + 8, &base, NULL );
+        ok( func == &tables[i], "%u: RtlLookupFunctionEntry returned %p, expected %p\n", i, func, &tables[i] );
+        ok( base == (ULONG_PTR)code_mem + i * 64, "%u: RtlLookupFunctionEntry returned base %lx\n", i, base );
+        func = pRtlLookupFunctionEntry( (ULONG_PTR)code_mem + i * 64 + 32, &base, NULL );
+        ok( func == NULL, "%u: RtlLookupFunctionEntry returned unexpected function %p\n", i, func );
+    }
+    ok( pRtlDeleteFunctionTable( &tables[2] ), "RtlDeleteFunctionTable failed for table 2\n" );
+    func = pRtlLookupFunctionEntry( (ULONG_PTR)code_mem + 2 * 64 + 8, &base, NULL );
+    ok( func == NULL, "RtlLookupFunctionEntry returned deleted function %p\n", func );
+    func = pRtlLookupFunctionEntry( (ULONG_PTR)code_mem + 3 * 64 + 8, &base, NULL );
+    ok( func == &tables[3], "RtlLookupFunctionEntry returned %p, expected %p\n", func, &tables[3] );
+    for (i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+        if (i != 2) ok( pRtlDeleteFunctionTable( &tables[i] ), "RtlDeleteFunctionTable failed for table %u\n", i );
 }
 
 static int termination_handler_called;
@@ -41,6 +41,12 @@
 #ifdef HAVE_SYS_SYSINFO_H
 # include <sys/sysinfo.h>
 #endif
+#ifdef HAVE_SYS_SYSCALL_H
+# include <sys/syscall.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
 #ifdef HAVE_VALGRIND_VALGRIND_H
 # include <valgrind/valgrind.h>
 #endif
@@ -2960,6 +2966,74 @@ NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 }
 
 
+#if defined(__linux__) && defined(__NR_process_vm_readv) && defined(__NR_process_vm_writev)
+
+static int process_vm_disabled;  /* set once the kernel refused a direct access */
+
+/***********************************************************************
+ *           get_process_vm_unix_pid
+ *
+ * Get the Unix pid to use for a direct access to the address space of a process.
+ * The access rights of the handle are checked by the server.
+ */
+static int get_process_vm_unix_pid( HANDLE process, unsigned int access )
+{
+    int pid = -1;
+
+    if (process_vm_disabled) return -1;
+    if (process == NtCurrentProcess()) return getpid();
+
+    SERVER_START_REQ( get_process_vm_access )
+    {
+        req->handle = wine_server_obj_handle( process );
+        req->access = access;
+        if (!wine_server_call( req )) pid = reply->unix_pid;
+    }
+    SERVER_END_REQ;
+    return pid;
+}
+
+/***********************************************************************
+ *           process_vm_transfer
+ *
+ * Copy memory to or from another process without going through ptrace in the server.
+ * Only a complete transfer counts as success; anything else (partial copy, protected
+ * pages, ptrace restrictions) is left to the server, which has the proper error semantics.
+ */
+static BOOL process_vm_transfer( HANDLE process, void *addr, void *buffer, SIZE_T size, BOOL write )
+{
+    struct iovec local, remote;
+    ssize_t ret;
+    int pid;
+
+    if (!size) return FALSE;
+    if ((pid = get_process_vm_unix_pid( process, write ? PROCESS_VM_WRITE : PROCESS_VM_READ )) == -1)
+        return FALSE;
+
+    local.iov_base  = buffer;
+    local.iov_len   = size;
+    remote.iov_base = addr;
+    remote.iov_len  = size;
+    ret = syscall( write ? __NR_process_vm_writev : __NR_process_vm_readv, pid, &local, 1, &remote, 1, 0 );
+    if (ret >= 0 && ret == size) return TRUE;
+    if (ret == -1 && (errno == ENOSYS || errno == EPERM))
+    {
+        /* not supported, or restricted by the ptrace scope; don't bother trying again */
+        TRACE( "process_vm_%s failed (%s), using the server\n", write ? "writev" : "readv", strerror(errno) );
+        process_vm_disabled = 1;
+    }
+    return FALSE;
+}
+
+#else
+
+static BOOL process_vm_transfer( HANDLE process, void *addr, void *buffer, SIZE_T size, BOOL write )
+{
+    return FALSE;
+}
+
+#endif
+
 /***********************************************************************
  *             NtReadVirtualMemory   (NTDLL.@)
  *             ZwReadVirtualMemory   (NTDLL.@)
@@ -2969,7 +3043,16 @@ NTSTATUS WINAPI NtReadVirtualMemory( HANDLE process, const void *addr, void *buf
 {
     NTSTATUS status;
 
-    if (virtual_check_buffer_for_write( buffer, size ))
+    if (!virtual_check_buffer_for_write( buffer, size ))
+    {
+        status = STATUS_ACCESS_VIOLATION;
+        size = 0;
+    }
+    else if (process_vm_transfer( process, (void *)addr, buffer, size, FALSE ))
+    {
+        status = STATUS_SUCCESS;
+    }
+    else
     {
         SERVER_START_REQ( read_process_memory )
         {
@@ -2980,11 +3063,6 @@ NTSTATUS WINAPI NtReadVirtualMemory( HANDLE process, const void *addr, void *buf
         }
         SERVER_END_REQ;
     }
-    else
-    {
-        status = STATUS_ACCESS_VIOLATION;
-        size = 0;
-    }
     if (bytes_read) *bytes_read = size;
     return status;
 }
@@ -2999,7 +3077,16 @@ NTSTATUS WINAPI NtWriteVirtualMemory( HANDLE process, void *addr, const void *bu
 {
     NTSTATUS status;
 
-    if (virtual_check_buffer_for_read( buffer, size ))
+    if (!virtual_check_buffer_for_read( buffer, size ))
+    {
+        status = STATUS_PARTIAL_COPY;
+        size = 0;
+    }
+    else if (process_vm_transfer( process, addr, (void *)buffer, size, TRUE ))
+    {
+        status = STATUS_SUCCESS;
+    }
+    else
     {
         SERVER_START_REQ( write_process_memory )
         {
@@ -3010,11 +3097,6 @@ NTSTATUS WINAPI NtWriteVirtualMemory( HANDLE process, void *addr, const void *bu
         }
         SERVER_END_REQ;
     }
-    else
-    {
-        status = STATUS_PARTIAL_COPY;
-        size = 0;
-    }
     if (bytes_written) *bytes_written = size;
     return status;
 }
@@ -67,6 +67,7 @@
 
 #include "wine/unicode.h"
 #include "wine/debug.h"
+#include "wine/rbtree.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(ole);
 
@@ -150,6 +151,15 @@ struct progidredirect_data
     ULONG clsid_offset;
 };
 
+/* class server registration read from the registry */
+struct class_server_data
+{
+    HRESULT hr;        /* result of opening the server key */
+    DWORD path_ret;    /* result of reading the server path */
+    WCHAR path[MAX_PATH+1];
+    enum comclass_threadingmodel model;
+};
+
 struct class_reg_data
 {
     union
@@ -160,9 +170,9 @@ struct class_reg_data
             void *section;
             HANDLE hactctx;
         } actctx;
-        HKEY hkey;
+        struct class_server_data registry;
     } u;
-    BOOL hkey;
+    BOOL registry;
 };
 
 struct registered_psclsid
@@ -1379,38 +1389,50 @@ static HRESULT apartment_getclassobject(struct apartment *apt, LPCWSTR dllpath,
 }
 
 /***********************************************************************
- *	COM_RegReadPath	[internal]
+ *	COM_RegReadKeyPath	[internal]
  *
- *	Reads a registry value and expands it when necessary
+ *	Reads the default value of a server key and expands it when necessary
  */
-static DWORD COM_RegReadPath(const struct class_reg_data *regdata, WCHAR *dst, DWORD dstlen)
+static DWORD COM_RegReadKeyPath(HKEY hkey, WCHAR *dst, DWORD dstlen)
 {
     DWORD ret;
-
-    if (regdata->hkey)
-    {
-	DWORD keytype;
-	WCHAR src[MAX_PATH];
-	DWORD dwLength = dstlen * sizeof(WCHAR);
-
-        if( (ret = RegQueryValueExW(regdata->u.hkey, NULL, NULL, &keytype, (BYTE*)src, &dwLength)) == ERROR_SUCCESS ) {
-            if (keytype == REG_EXPAND_SZ) {
-              if (dstlen <= ExpandEnvironmentStringsW(src, dst, dstlen)) ret = ERROR_MORE_DATA;
-            } else {
-              const WCHAR *quote_start;
-              quote_start = strchrW(src, '\"');
-              if (quote_start) {
-                const WCHAR *quote_end = strchrW(quote_start + 1, '\"');
-                if (quote_end) {
-                  memmove(src, quote_start + 1,
-                          (quote_end - quote_start - 1) * sizeof(WCHAR));
-                  src[quote_end - quote_start - 1] = '\0';
-                }
-              }
-              lstrcpynW(dst, src, dstlen);
+    DWORD keytype;
+    WCHAR src[MAX_PATH];
+    DWORD dwLength = dstlen * sizeof(WCHAR);
+
+    if( (ret = RegQueryValueExW(hkey, NULL, NULL, &keytype, (BYTE*)src, &dwLength)) == ERROR_SUCCESS ) {
+        if (keytype == REG_EXPAND_SZ) {
+          if (dstlen <= ExpandEnvironmentStringsW(src, dst, dstlen)) ret = ERROR_MORE_DATA;
+        } else {
+          const WCHAR *quote_start;
+          quote_start = strchrW(src, '\"');
+          if (quote_start) {
+            const WCHAR *quote_end = strchrW(quote_start + 1, '\"');
+            if (quote_end) {
+              memmove(src, quote_start + 1,
+                      (quote_end - quote_start - 1) * sizeof(WCHAR));
+              src[quote_end - quote_start - 1] = '\0';
             }
+          }
+          lstrcpynW(dst, src, dstlen);
         }
-	return ret;
+    }
+    return ret;
+}
+
+/***********************************************************************
+ *	COM_RegReadPath	[internal]
+ *
+ *	Returns the server path of a class, either from the data read from
+ *	the registry or from the activation context
+ */
+static DWORD COM_RegReadPath(const struct class_reg_data *regdata, WCHAR *dst, DWORD dstlen)
+{
+    if (regdata->registry)
+    {
+        if (regdata->u.registry.path_ret == ERROR_SUCCESS)
+            lstrcpynW(dst, regdata->u.registry.path, dstlen);
+        return regdata->u.registry.path_ret;
     }
     else
     {
@@ -1420,7 +1442,7 @@ static DWORD COM_RegReadPath(const struct class_reg_data *regdata, WCHAR *dst, D
         *dst = 0;
         nameW = (WCHAR*)((BYTE*)regdata->u.actctx.section + regdata->u.actctx.data->name_offset);
         ActivateActCtx(regdata->u.actctx.hactctx, &cookie);
-        ret = SearchPathW(NULL, nameW, NULL, dstlen, dst, NULL);
+        SearchPathW(NULL, nameW, NULL, dstlen, dst, NULL);
         DeactivateActCtx(0, cookie);
         return !*dst;
     }
@@ -2851,33 +2873,207 @@ HRESULT WINAPI CoRegisterClassObject(
   return S_OK;
 }
 
+static enum comclass_threadingmodel get_key_threading_model(HKEY hkey)
+{
+    static const WCHAR wszThreadingModel[] = {'T','h','r','e','a','d','i','n','g','M','o','d','e','l',0};
+    static const WCHAR wszApartment[] = {'A','p','a','r','t','m','e','n','t',0};
+    static const WCHAR wszFree[] = {'F','r','e','e',0};
+    static const WCHAR wszBoth[] = {'B','o','t','h',0};
+    WCHAR threading_model[10 /* strlenW(L"apartment")+1 */];
+    DWORD dwLength = sizeof(threading_model);
+    DWORD keytype;
+    DWORD ret;
+
+    ret = RegQueryValueExW(hkey, wszThreadingModel, NULL, &keytype, (BYTE*)threading_model, &dwLength);
+    if ((ret != ERROR_SUCCESS) || (keytype != REG_SZ))
+        threading_model[0] = '\0';
+
+    if (!strcmpiW(threading_model, wszApartment)) return ThreadingModel_Apartment;
+    if (!strcmpiW(threading_model, wszFree)) return ThreadingModel_Free;
+    if (!strcmpiW(threading_model, wszBoth)) return ThreadingModel_Both;
+
+    /* there's not specific handling for this case */
+    if (threading_model[0]) return ThreadingModel_Neutral;
+    return ThreadingModel_No;
+}
+
 static enum comclass_threadingmodel get_threading_model(const struct class_reg_data *data)
 {
-    if (data->hkey)
+    if (data->registry)
+        return data->u.registry.model;
+    else
+        return data->u.actctx.data->model;
+}
+
+/*
+ * Registry data of the classes activated by CoGetClassObject() and
+ * CoGetTreatAsClass() is cached per CLSID, so that creating the same class
+ * over and over does not need to open and query several registry keys each
+ * time. The whole cache is flushed as soon as anything changes below
+ * HKEY_CLASSES_ROOT; the change notification is set up before the first
+ * entry is filled, so no stale data can be returned once the registry
+ * write has completed.
+ */
+enum class_server
+{
+    CLASS_SERVER_INPROC,
+    CLASS_SERVER_INPROC_HANDLER,
+    CLASS_SERVER_COUNT
+};
+
+struct class_cache_entry
+{
+    struct wine_rb_entry entry;
+    CLSID clsid;
+    BOOL treatas_valid;
+    HRESULT treatas_hr;
+    CLSID treatas;
+    BOOL server_valid[CLASS_SERVER_COUNT];
+    struct class_server_data server[CLASS_SERVER_COUNT];
+};
+
+/* maximum number of cached classes, the cache is flushed when it is full */
+#define CLASS_CACHE_MAX_ENTRIES 256
+
+static int class_cache_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct class_cache_entry *class = WINE_RB_ENTRY_VALUE(entry, const struct class_cache_entry, entry);
+    return memcmp(key, &class->clsid, sizeof(class->clsid));
+}
+
+static struct wine_rb_tree class_cache = { class_cache_compare };
+static unsigned int class_cache_count;
+static HKEY class_cache_key;      /* HKEY_CLASSES_ROOT, watched for changes */
+static HANDLE class_cache_event;  /* signaled when the registry has changed */
+static BOOL class_cache_disabled; /* change notifications are not available */
+
+static CRITICAL_SECTION csClassCache;
+static CRITICAL_SECTION_DEBUG class_cache_cs_debug =
+{
+    0, 0, &csClassCache,
+    { &class_cache_cs_debug.ProcessLocksList, &class_cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": csClassCache") }
+};
+static CRITICAL_SECTION csClassCache = { &class_cache_cs_debug, -1, 0, 0, 0, 0 };
+
+static void class_cache_free_entry(struct wine_rb_entry *entry, void *context)
+{
+    HeapFree(GetProcessHeap(), 0, WINE_RB_ENTRY_VALUE(entry, struct class_cache_entry, entry));
+}
+
+static void class_cache_flush(void)
+{
+    wine_rb_clear(&class_cache, class_cache_free_entry, NULL);
+    class_cache_count = 0;
+}
+
+static BOOL class_cache_watch(void)
+{
+    static const WCHAR emptyW[] = {0};
+
+    if (!class_cache_event)
     {
-        static const WCHAR wszThreadingModel[] = {'T','h','r','e','a','d','i','n','g','M','o','d','e','l',0};
-        static const WCHAR wszApartment[] = {'A','p','a','r','t','m','e','n','t',0};
-        static const WCHAR wszFree[] = {'F','r','e','e',0};
-        static const WCHAR wszBoth[] = {'B','o','t','h',0};
-        WCHAR threading_model[10 /* strlenW(L"apartment")+1 */];
-        DWORD dwLength = sizeof(threading_model);
-        DWORD keytype;
-        DWORD ret;
-
-        ret = RegQueryValueExW(data->u.hkey, wszThreadingModel, NULL, &keytype, (BYTE*)threading_model, &dwLength);
-        if ((ret != ERROR_SUCCESS) || (keytype != REG_SZ))
-            threading_model[0] = '\0';
-
-        if (!strcmpiW(threading_model, wszApartment)) return ThreadingModel_Apartment;
-        if (!strcmpiW(threading_model, wszFree)) return ThreadingModel_Free;
-        if (!strcmpiW(threading_model, wszBoth)) return ThreadingModel_Both;
-
-        /* there's not specific handling for this case */
-        if (threading_model[0]) return ThreadingModel_Neutral;
-        return ThreadingModel_No;
+        if (open_classes_key(HKEY_CLASSES_ROOT, emptyW, KEY_NOTIFY, &class_cache_key))
+            return FALSE;
+        if (!(class_cache_event = CreateEventW(NULL, FALSE, FALSE, NULL)))
+        {
+            RegCloseKey(class_cache_key);
+            class_cache_key = NULL;
+            return FALSE;
+        }
+    }
+    return !RegNotifyChangeKeyValue(class_cache_key, TRUE,
+                                    REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET,
+                                    class_cache_event, TRUE);
+}
+
+/* returns the cache entry of a class, or NULL if the class can't be cached;
+ * must be called with csClassCache held */
+static struct class_cache_entry *class_cache_get_entry(REFCLSID clsid)
+{
+    struct class_cache_entry *class;
+    struct wine_rb_entry *entry;
+
+    if (class_cache_disabled)
+        return NULL;
+
+    if (!class_cache_event || WaitForSingleObject(class_cache_event, 0) == WAIT_OBJECT_0)
+    {
+        /* watch again before flushing, so that changes made meanwhile are not missed */
+        if (!class_cache_watch())
+        {
+            class_cache_flush();
+            WARN("registry change notifications not available, not caching class data\n");
+            class_cache_disabled = TRUE;
+            return NULL;
+        }
+        class_cache_flush();
+    }
+
+    if ((entry = wine_rb_get(&class_cache, clsid)))
+        return WINE_RB_ENTRY_VALUE(entry, struct class_cache_entry, entry);
+
+    if (class_cache_count >= CLASS_CACHE_MAX_ENTRIES)
+        class_cache_flush();
+
+    if (!(class = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*class))))
+        return NULL;
+    class->clsid = *clsid;
+    wine_rb_put(&class_cache, clsid, &class->entry);
+    class_cache_count++;
+    return class;
+}
+
+static void class_cache_free(void)
+{
+    class_cache_flush();
+    if (class_cache_key) RegCloseKey(class_cache_key);
+    if (class_cache_event) CloseHandle(class_cache_event);
+    DeleteCriticalSection(&csClassCache);
+}
+
+static void read_class_server_data(REFCLSID clsid, enum class_server server, struct class_server_data *data)
+{
+    static const WCHAR wszInprocServer32[] = {'I','n','p','r','o','c','S','e','r','v','e','r','3','2',0};
+    static const WCHAR wszInprocHandler32[] = {'I','n','p','r','o','c','H','a','n','d','l','e','r','3','2',0};
+    static const WCHAR * const keynames[CLASS_SERVER_COUNT] = { wszInprocServer32, wszInprocHandler32 };
+    HKEY hkey;
+
+    data->path[0] = 0;
+    data->path_ret = ERROR_FILE_NOT_FOUND;
+    data->model = ThreadingModel_No;
+
+    data->hr = COM_OpenKeyForCLSID(clsid, keynames[server], KEY_READ, &hkey);
+    if (FAILED(data->hr))
+        return;
+
+    data->path_ret = COM_RegReadKeyPath(hkey, data->path, ARRAYSIZE(data->path));
+    data->model = get_key_threading_model(hkey);
+    RegCloseKey(hkey);
+}
+
+/* fills the registry data of a class server, returns the result of opening its key */
+static HRESULT get_class_reg_data(REFCLSID clsid, enum class_server server, struct class_reg_data *regdata)
+{
+    struct class_cache_entry *class;
+
+    regdata->registry = TRUE;
+
+    EnterCriticalSection(&csClassCache);
+    if ((class = class_cache_get_entry(clsid)))
+    {
+        if (!class->server_valid[server])
+        {
+            read_class_server_data(clsid, server, &class->server[server]);
+            class->server_valid[server] = TRUE;
+        }
+        regdata->u.registry = class->server[server];
     }
     else
-        return data->u.actctx.data->model;
+        read_class_server_data(clsid, server, &regdata->u.registry);
+    LeaveCriticalSection(&csClassCache);
+
+    return regdata->u.registry.hr;
 }
 
 static HRESULT get_inproc_class_object(APARTMENT *apt, const struct class_reg_data *regdata,
@@ -3013,7 +3209,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
             clsreg.u.actctx.hactctx = data.hActCtx;
             clsreg.u.actctx.data = data.lpData;
             clsreg.u.actctx.section = data.lpSectionBase;
-            clsreg.hkey = FALSE;
+            clsreg.registry = FALSE;
 
             hres = get_inproc_class_object(apt, &clsreg, &comclass->clsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
             ReleaseActCtx(data.hActCtx);
@@ -3045,10 +3241,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
     /* First try in-process server */
     if (CLSCTX_INPROC_SERVER & dwClsContext)
     {
-        static const WCHAR wszInprocServer32[] = {'I','n','p','r','o','c','S','e','r','v','e','r','3','2',0};
-        HKEY hkey;
-
-        hres = COM_OpenKeyForCLSID(rclsid, wszInprocServer32, KEY_READ, &hkey);
+        hres = get_class_reg_data(rclsid, CLASS_SERVER_INPROC, &clsreg);
         if (FAILED(hres))
         {
             if (hres == REGDB_E_CLASSNOTREG)
@@ -3061,13 +3254,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
         }
 
         if (SUCCEEDED(hres))
-        {
-            clsreg.u.hkey = hkey;
-            clsreg.hkey = TRUE;
-
             hres = get_inproc_class_object(apt, &clsreg, rclsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
-            RegCloseKey(hkey);
-        }
 
         /* return if we got a class, otherwise fall through to one of the
          * other types */
@@ -3081,10 +3268,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
     /* Next try in-process handler */
     if (CLSCTX_INPROC_HANDLER & dwClsContext)
     {
-        static const WCHAR wszInprocHandler32[] = {'I','n','p','r','o','c','H','a','n','d','l','e','r','3','2',0};
-        HKEY hkey;
-
-        hres = COM_OpenKeyForCLSID(rclsid, wszInprocHandler32, KEY_READ, &hkey);
+        hres = get_class_reg_data(rclsid, CLASS_SERVER_INPROC_HANDLER, &clsreg);
         if (FAILED(hres))
         {
             if (hres == REGDB_E_CLASSNOTREG)
@@ -3097,13 +3281,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
         }
 
         if (SUCCEEDED(hres))
-        {
-            clsreg.u.hkey = hkey;
-            clsreg.hkey = TRUE;
-
             hres = get_inproc_class_object(apt, &clsreg, rclsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
-            RegCloseKey(hkey);
-        }
 
         /* return if we got a class, otherwise fall through to one of the
          * other types */
@@ -3798,23 +3976,7 @@ done:
     return res;
 }
 
-/******************************************************************************
- *              CoGetTreatAsClass        [OLE32.@]
- *
- * Gets the TreatAs value of a class.
- *
- * PARAMS
- *  clsidOld [I] Class to get the TreatAs value of.
- *  clsidNew [I] The class the clsidOld should be treated as.
- *
- * RETURNS
- *  Success: S_OK.
- *  Failure: HRESULT code.
- *
- * SEE ALSO
- *  CoSetTreatAsClass
- */
-HRESULT WINAPI CoGetTreatAsClass(REFCLSID clsidOld, LPCLSID clsidNew)
+static HRESULT read_treat_as_class(REFCLSID clsidOld, LPCLSID clsidNew)
 {
     static const WCHAR wszTreatAs[] = {'T','r','e','a','t','A','s',0};
     HKEY hkey = NULL;
@@ -3822,7 +3984,6 @@ HRESULT WINAPI CoGetTreatAsClass(REFCLSID clsidOld, LPCLSID clsidNew)
     HRESULT res = S_OK;
     LONG len = sizeof(szClsidNew);
 
-    TRACE("(%s,%p)\n", debugstr_guid(clsidOld), clsidNew);
     *clsidNew = *clsidOld; /* copy over old value */
 
     res = COM_OpenKeyForCLSID(clsidOld, wszTreatAs, KEY_READ, &hkey);
@@ -3844,6 +4005,47 @@ done:
     return res;
 }
 
+/******************************************************************************
+ *              CoGetTreatAsClass        [OLE32.@]
+ *
+ * Gets the TreatAs value of a class.
+ *
+ * PARAMS
+ *  clsidOld [I] Class to get the TreatAs value of.
+ *  clsidNew [I] The class the clsidOld should be treated as.
+ *
+ * RETURNS
+ *  Success: S_OK.
+ *  Failure: HRESULT code.
+ *
+ * SEE ALSO
+ *  CoSetTreatAsClass
+ */
+HRESULT WINAPI CoGetTreatAsClass(REFCLSID clsidOld, LPCLSID clsidNew)
+{
+    struct class_cache_entry *class;
+    HRESULT res;
+
+    TRACE("(%s,%p)\n", debugstr_guid(clsidOld), clsidNew);
+
+    EnterCriticalSection(&csClassCache);
+    if ((class = class_cache_get_entry(clsidOld)))
+    {
+        if (!class->treatas_valid)
+        {
+            class->treatas_hr = read_treat_as_class(clsidOld, &class->treatas);
+            class->treatas_valid = TRUE;
+        }
+        *clsidNew = class->treatas;
+        res = class->treatas_hr;
+    }
+    else
+        res = read_treat_as_class(clsidOld, clsidNew);
+    LeaveCriticalSection(&csClassCache);
+
+    return res;
+}
+
 /******************************************************************************
  *		CoGetCurrentProcess	[OLE32.@]
  *
@@ -5013,31 +5215,22 @@ HRESULT WINAPI CoGetDefaultContext(APTTYPE type, REFIID riid, LPVOID *ppv)
 
 HRESULT Handler_DllGetClassObject(REFCLSID rclsid, REFIID riid, LPVOID *ppv)
 {
-    static const WCHAR wszInprocHandler32[] = {'I','n','p','r','o','c','H','a','n','d','l','e','r','3','2',0};
-    HKEY hkey;
+    struct class_reg_data regdata;
     HRESULT hres;
 
-    hres = COM_OpenKeyForCLSID(rclsid, wszInprocHandler32, KEY_READ, &hkey);
+    hres = get_class_reg_data(rclsid, CLASS_SERVER_INPROC_HANDLER, &regdata);
     if (SUCCEEDED(hres))
     {
-        struct class_reg_data regdata;
         WCHAR dllpath[MAX_PATH+1];
 
-        regdata.u.hkey = hkey;
-        regdata.hkey = TRUE;
-
         if (COM_RegReadPath(&regdata, dllpath, ARRAYSIZE(dllpath)) == ERROR_SUCCESS)
         {
             static const WCHAR wszOle32[] = {'o','l','e','3','2','.','d','l','l',0};
             if (!strcmpiW(dllpath, wszOle32))
-            {
-                RegCloseKey(hkey);
                 return HandlerCF_Create(rclsid, riid, ppv);
-            }
         }
         else
             WARN("not creating object for inproc handler path %s\n", debugstr_w(dllpath));
-        RegCloseKey(hkey);
     }
 
     return CLASS_E_CLASSNOTAVAILABLE;
@@ -5090,6 +5283,7 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID reserved)
         UnregisterClassW( wszAptWinClass, hProxyDll );
         RPC_UnregisterAllChannelHooks();
         COMPOBJ_DllList_Free();
+        class_cache_free();
         DeleteCriticalSection(&csRegisteredClassList);
         DeleteCriticalSection(&csApartment);
 	break;
@@ -187,7 +187,8 @@ static HRESULT WINAPI FileLockBytesImpl_ReadAt(
     ULONG bytes_left = cb;
     LPBYTE readPtr = pv;
     BOOL ret;
-    LARGE_INTEGER offset;
+    ULARGE_INTEGER offset;
+    OVERLAPPED ol;
     ULONG cbRead;
 
     TRACE("(%p)-> %i %p %i %p\n",This, ulOffset.u.LowPart, pv, cb, pcbRead);
@@ -200,14 +201,15 @@ static HRESULT WINAPI FileLockBytesImpl_ReadAt(
 
     offset.QuadPart = ulOffset.QuadPart;
 
-    ret = SetFilePointerEx(This->hfile, offset, NULL, FILE_BEGIN);
-
-    if (!ret)
-        return STG_E_READFAULT;
+    /* pass the offset along with the read instead of seeking first */
+    memset(&ol, 0, sizeof(ol));
 
     while (bytes_left)
     {
-        ret = ReadFile(This->hfile, readPtr, bytes_left, &cbRead, NULL);
+        ol.u.s.Offset = offset.u.LowPart;
+        ol.u.s.OffsetHigh = offset.u.HighPart;
+
+        ret = ReadFile(This->hfile, readPtr, bytes_left, &cbRead, &ol);
 
         if (!ret || cbRead == 0)
             return STG_E_READFAULT;
@@ -217,6 +219,7 @@ static HRESULT WINAPI FileLockBytesImpl_ReadAt(
 
         bytes_left -= cbRead;
         readPtr += cbRead;
+        offset.QuadPart += cbRead;
     }
 
     TRACE("finished\n");
@@ -4030,6 +4030,7 @@ static HRESULT StorageImpl_GetNextBlockInChain(
   BYTE depotBuffer[MAX_BIG_BLOCK_SIZE];
   ULONG read;
   ULONG depotBlockIndexPos;
+  ULONG cacheIndex;
   int index, num_blocks;
 
   *nextBlockIndex   = BLOCK_SPECIAL;
@@ -4042,11 +4043,13 @@ static HRESULT StorageImpl_GetNextBlockInChain(
   }
 
   /*
-   * Cache the currently accessed depot block.
+   * Cache the currently accessed depot block, the cache is direct-mapped
+   * so that walking chains spread over several depot blocks does not
+   * re-read the same depot blocks over and over.
    */
-  if (depotBlockCount != This->indexBlockDepotCached)
+  cacheIndex = depotBlockCount % BLOCKDEPOT_CACHE_SIZE;
+  if (depotBlockCount != This->indexBlockDepotCached[cacheIndex])
   {
-    This->indexBlockDepotCached = depotBlockCount;
 
     if (depotBlockCount < COUNT_BBDEPOTINHEADER)
     {
@@ -4063,18 +4066,23 @@ static HRESULT StorageImpl_GetNextBlockInChain(
     StorageImpl_ReadBigBlock(This, depotBlockIndexPos, depotBuffer, &read);
 
     if (!read)
+    {
+      This->indexBlockDepotCached[cacheIndex] = 0xFFFFFFFF;
       return STG_E_READFAULT;
+    }
 
     num_blocks = This->bigBlockSize / 4;
 
     for (index = 0; index < num_blocks; index++)
     {
       StorageUtl_ReadDWord(depotBuffer, index*sizeof(ULONG), nextBlockIndex);
-      This->blockDepotCached[index] = *nextBlockIndex;
+      This->blockDepotCached[cacheIndex][index] = *nextBlockIndex;
     }
+
+    This->indexBlockDepotCached[cacheIndex] = depotBlockCount;
   }
 
-  *nextBlockIndex = This->blockDepotCached[depotBlockOffset/sizeof(ULONG)];
+  *nextBlockIndex = This->blockDepotCached[cacheIndex][depotBlockOffset/sizeof(ULONG)];
 
   return S_OK;
 }
@@ -4156,9 +4164,9 @@ static void StorageImpl_SetNextBlockInChain(
   /*
    * Update the cached block depot, if necessary.
    */
-  if (depotBlockCount == This->indexBlockDepotCached)
+  if (depotBlockCount == This->indexBlockDepotCached[depotBlockCount % BLOCKDEPOT_CACHE_SIZE])
   {
-    This->blockDepotCached[depotBlockOffset/sizeof(ULONG)] = nextBlock;
+    This->blockDepotCached[depotBlockCount % BLOCKDEPOT_CACHE_SIZE][depotBlockOffset/sizeof(ULONG)] = nextBlock;
   }
 }
 
@@ -4693,7 +4701,7 @@ static HRESULT StorageImpl_Refresh(StorageImpl *This, BOOL new_object, BOOL crea
   /*
    * There is no block depot cached yet.
    */
-  This->indexBlockDepotCached = 0xFFFFFFFF;
+  memset(This->indexBlockDepotCached, 0xff, sizeof(This->indexBlockDepotCached));
   This->indexExtBlockDepotCached = 0xFFFFFFFF;
 
   /*
@@ -7182,14 +7190,14 @@ static HRESULT BlockChainStream_UpdateIndexCache(BlockChainStream* This)
   return S_OK;
 }
 
-/* Locate the nth block in this stream. */
-static ULONG BlockChainStream_GetSectorOfOffset(BlockChainStream *This, ULONG offset)
+/* Locate the run containing the nth block in this stream. */
+static struct BlockChainRun *BlockChainStream_GetRunOfOffset(BlockChainStream *This, ULONG offset)
 {
   ULONG min_offset = 0, max_offset = This->numBlocks-1;
   ULONG min_run = 0, max_run = This->indexCacheLen-1;
 
   if (offset >= This->numBlocks)
-    return BLOCK_END_OF_CHAIN;
+    return NULL;
 
   while (min_run < max_run)
   {
@@ -7209,7 +7217,39 @@ static ULONG BlockChainStream_GetSectorOfOffset(BlockChainStream *This, ULONG of
       min_run = max_run = run_to_check;
   }
 
-  return This->indexCache[min_run].firstSector + offset - This->indexCache[min_run].firstOffset;
+  return &This->indexCache[min_run];
+}
+
+/* Locate the nth block in this stream. */
+static ULONG BlockChainStream_GetSectorOfOffset(BlockChainStream *This, ULONG offset)
+{
+  struct BlockChainRun *run = BlockChainStream_GetRunOfOffset(This, offset);
+
+  if (!run)
+    return BLOCK_END_OF_CHAIN;
+
+  return run->firstSector + offset - run->firstOffset;
+}
+
+/* Returns how many blocks, at most max_count, starting with the nth block
+ * are stored in consecutive sectors and can be read from the file at once. */
+static ULONG BlockChainStream_GetContiguousBlocks(BlockChainStream *This, ULONG offset, ULONG max_count)
+{
+  struct BlockChainRun *run = BlockChainStream_GetRunOfOffset(This, offset);
+  ULONG count;
+  int i;
+
+  if (!run)
+    return 0;
+
+  count = min(run->lastOffset - offset + 1, max_count);
+
+  /* Cached blocks may hold data that was not written yet. */
+  for (i=0; i<2; i++)
+    if (This->cachedBlocks[i].index > offset && This->cachedBlocks[i].index < offset + count)
+      count = This->cachedBlocks[i].index - offset;
+
+  return count;
 }
 
 static HRESULT BlockChainStream_GetBlockAtOffset(BlockChainStream *This,
@@ -7640,6 +7680,7 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
   {
     ULARGE_INTEGER ulOffset;
     DWORD bytesReadAt;
+    ULONG blockCount = 1;
 
     /*
      * Calculate how many bytes we can copy from this big block.
@@ -7654,7 +7695,16 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
 
     if (!cachedBlock)
     {
-      /* Not in cache, and we're going to read past the end of the block. */
+      /*
+       * Not in cache, and we're going to read past the end of the block.
+       * Read all the following blocks that are entirely covered by the
+       * request and stored in consecutive sectors with a single call.
+       */
+      blockCount = BlockChainStream_GetContiguousBlocks(This, blockNoInSequence,
+          (offsetInBlock + size) / This->parentStorage->bigBlockSize);
+      if (blockCount > 1)
+        bytesToReadInBuffer = blockCount * This->parentStorage->bigBlockSize - offsetInBlock;
+
       ulOffset.QuadPart = StorageImpl_GetBigBlockOffset(This->parentStorage, blockIndex) +
                                offsetInBlock;
 
@@ -7679,7 +7729,7 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
       bytesReadAt = bytesToReadInBuffer;
     }
 
-    blockNoInSequence++;
+    blockNoInSequence += blockCount;
     bufferWalker += bytesReadAt;
     size         -= bytesReadAt;
     *bytesRead   += bytesReadAt;
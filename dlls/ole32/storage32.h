@@ -362,6 +362,9 @@ void StorageBaseImpl_RemoveStream(StorageBaseImpl * stg, StgStreamImpl * strm) D
 /* Number of BlockChainStream objects to cache in a StorageImpl */
 #define BLOCKCHAIN_CACHE_SIZE 4
 
+/* Number of big block depot sectors to cache in a StorageImpl */
+#define BLOCKDEPOT_CACHE_SIZE 8
+
 /****************************************************************************
  * StorageImpl definitions.
  *
@@ -393,8 +396,8 @@ struct StorageImpl
   ULONG extBlockDepotCached[MAX_BIG_BLOCK_SIZE / 4];
   ULONG indexExtBlockDepotCached;
 
-  ULONG blockDepotCached[MAX_BIG_BLOCK_SIZE / 4];
-  ULONG indexBlockDepotCached;
+  ULONG blockDepotCached[BLOCKDEPOT_CACHE_SIZE][MAX_BIG_BLOCK_SIZE / 4];
+  ULONG indexBlockDepotCached[BLOCKDEPOT_CACHE_SIZE];
   ULONG prevFreeBlock;
 
   /* All small blocks before this one are known to be in use. */
@@ -2200,6 +2200,17 @@ static void test_TreatAsClass(void)
     ok(hr == S_OK, "CoGetTreatAsClass failed: %08x\n",hr);
     ok(IsEqualGUID(&out, &CLSID_FileProtocol), "expected to get substituted clsid\n");
 
+    /* changes made directly in the registry are seen as well */
+    lr = RegSetValueA(deadbeefkey, "TreatAs", REG_SZ, deadbeefA, 0);
+    ok(!lr, "RegSetValueA failed, error %d\n", lr);
+
+    hr = pCoGetTreatAsClass(&deadbeef, &out);
+    ok(hr == S_OK, "CoGetTreatAsClass failed: %08x\n",hr);
+    ok(IsEqualGUID(&out, &deadbeef), "expected to get substituted clsid\n");
+
+    hr = pCoTreatAsClass(&deadbeef, &CLSID_FileProtocol);
+    ok(hr == S_OK, "CoTreatAsClass failed: %08x\n", hr);
+
     OleInitialize(NULL);
 
     hr = CoCreateInstance(&deadbeef, NULL, CLSCTX_INPROC_SERVER, &IID_IInternetProtocol, (void **)&pIP);
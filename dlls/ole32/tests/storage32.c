@@ -3871,6 +3871,93 @@ static void test_overwrite(void)
     DeleteFileA(filenameA);
 }
 
+static BYTE fragmented_data(int stream, ULONG pos)
+{
+    return (BYTE)(pos * 13 + pos / 511 + stream * 101);
+}
+
+static void test_fragmented_read(void)
+{
+    IStorage *stg = NULL;
+    IStream *stm[2];
+    HRESULT r;
+    static const WCHAR *names[2] = { strmA_name, strmB_name };
+    static const ULONG stream_size = 512 * 1024, chunk_size = 1536;
+    static const ULONG offset = 700, read_size = 70000;
+    LARGE_INTEGER pos;
+    ULONG written, bytesread, i;
+    BYTE *buffer;
+    int j;
+
+    DeleteFileA(filenameA);
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, stream_size);
+
+    r = StgCreateDocfile(filename, STGM_CREATE | STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, &stg);
+    ok(r==S_OK, "StgCreateDocfile failed %x\n", r);
+
+    for (j=0; j<2; j++)
+    {
+        r = IStorage_CreateStream(stg, names[j], STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, 0, &stm[j]);
+        ok(r==S_OK, "IStorage->CreateStream failed %x\n", r);
+    }
+
+    /* interleave the writes so that the sector chains of both streams are fragmented */
+    for (written = 0; written < stream_size; written += chunk_size)
+    {
+        for (j=0; j<2; j++)
+        {
+            for (i=0; i<chunk_size; i++)
+                buffer[i] = fragmented_data(j, written + i);
+            r = IStream_Write(stm[j], buffer, min(chunk_size, stream_size - written), NULL);
+            ok(r==S_OK, "IStream->Write failed %x\n", r);
+        }
+    }
+
+    for (j=0; j<2; j++)
+        IStream_Release(stm[j]);
+    IStorage_Release(stg);
+
+    r = StgOpenStorage(filename, NULL, STGM_READ | STGM_SHARE_EXCLUSIVE, NULL, 0, &stg);
+    ok(r==S_OK, "StgOpenStorage failed %x\n", r);
+
+    for (j=0; j<2; j++)
+    {
+        r = IStorage_OpenStream(stg, names[j], NULL, STGM_READ | STGM_SHARE_EXCLUSIVE, 0, &stm[j]);
+        ok(r==S_OK, "IStorage->OpenStream failed %x\n", r);
+
+        memset(buffer, 0, stream_size);
+        r = IStream_Read(stm[j], buffer, stream_size, &bytesread);
+        ok(r==S_OK, "IStream->Read failed %x\n", r);
+        ok(bytesread == stream_size, "only read %u bytes\n", bytesread);
+        for (i=0; i<stream_size; i++)
+            if (buffer[i] != fragmented_data(j, i))
+                break;
+        ok(i == stream_size, "stream %d: unexpected data at byte %u\n", j, i);
+
+        pos.QuadPart = offset;
+        r = IStream_Seek(stm[j], pos, STREAM_SEEK_SET, NULL);
+        ok(r==S_OK, "IStream->Seek failed %x\n", r);
+
+        memset(buffer, 0, read_size);
+        r = IStream_Read(stm[j], buffer, read_size, &bytesread);
+        ok(r==S_OK, "IStream->Read failed %x\n", r);
+        ok(bytesread == read_size, "only read %u bytes\n", bytesread);
+        for (i=0; i<read_size; i++)
+            if (buffer[i] != fragmented_data(j, offset + i))
+                break;
+        ok(i == read_size, "stream %d: unexpected data at byte %u\n", j, offset + i);
+
+        IStream_Release(stm[j]);
+    }
+
+    IStorage_Release(stg);
+
+    HeapFree(GetProcessHeap(), 0, buffer);
+
+    DeleteFileA(filenameA);
+}
+
 static void test_custom_lockbytes(void)
 {
     static const WCHAR stmname[] = { 'C','O','N','T','E','N','T','S',0 };
@@ -3967,5 +4054,6 @@ START_TEST(storage32)
     test_locking();
     test_transacted_shared();
     test_overwrite();
+    test_fragmented_read();
     test_custom_lockbytes();
 }
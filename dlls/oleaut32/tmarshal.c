@@ -125,6 +125,33 @@ xbuf_skip(marshal_state *buf, DWORD size) {
     return S_OK;
 }
 
+/* start with the buffer left over by a previous call, if any */
+static void
+xbuf_init_cached(marshal_state *buf, LPBYTE *cache) {
+    memset(buf,0,sizeof(*buf));
+    if ((buf->base = InterlockedExchangePointer((void **)cache, NULL)))
+        buf->size = HeapSize(GetProcessHeap(), 0, buf->base);
+}
+
+/* keep the buffer for the next call, unless another one is kept already */
+static void
+xbuf_release_cached(marshal_state *buf, LPBYTE *cache) {
+    if (buf->base && !InterlockedCompareExchangePointer((void **)cache, buf->base, NULL))
+        return;
+    HeapFree(GetProcessHeap(), 0, buf->base);
+}
+
+/* make the buffer hold a copy of size bytes of data */
+static HRESULT
+xbuf_set(marshal_state *buf, const void *data, DWORD size) {
+    if (buf->base) buf->size = HeapSize(GetProcessHeap(), 0, buf->base);
+    if (FAILED(xbuf_resize(buf, size))) return E_OUTOFMEMORY;
+    memcpy(buf->base, data, size);
+    buf->size = size;
+    buf->curoff = 0;
+    return S_OK;
+}
+
 static HRESULT
 _unmarshal_interface(marshal_state *buf, REFIID riid, LPUNKNOWN *pUnk) {
     IStream		*pStm;
@@ -513,6 +540,50 @@ typedef struct _TMAsmProxy {
 } TMAsmProxy;
 #endif
 
+/* Marshalling plan of a method, built from its FUNCDESC on the first call
+ * and kept for the lifetime of the proxy or stub. */
+struct param_plan
+{
+    DWORD   argsize;    /* stack size in DWORDs */
+    DWORD   outsize;    /* size of the target of an [out]-only pointer */
+    BOOL    in;
+    BOOL    out;
+};
+
+struct method_plan
+{
+    ITypeInfo       *tinfo;         /* type info the FUNCDESC belongs to */
+    const FUNCDESC  *fdesc;
+    BSTR             iname;
+    BSTR             fname;
+    BSTR             names[10];     /* method and parameter names, for tracing */
+    UINT             nrofnames;
+    DWORD            nrofargs;      /* stack size of the parameters in DWORDs */
+    struct param_plan params[1];
+};
+
+static void free_method_plan(struct method_plan *plan)
+{
+    unsigned int i;
+
+    for (i = 0; i < plan->nrofnames; i++)
+        SysFreeString(plan->names[i]);
+    SysFreeString(plan->iname);
+    SysFreeString(plan->fname);
+    ITypeInfo_Release(plan->tinfo);
+    HeapFree(GetProcessHeap(), 0, plan);
+}
+
+static void free_method_plans(struct method_plan **plans, unsigned int count)
+{
+    unsigned int i;
+
+    if (!plans) return;
+    for (i = 0; i < count; i++)
+        if (plans[i]) free_method_plan(plans[i]);
+    HeapFree(GetProcessHeap(), 0, plans);
+}
+
 typedef struct _TMProxyImpl {
     LPVOID                             *lpvtbl;
     IRpcProxyBuffer                     IRpcProxyBuffer_iface;
@@ -526,6 +597,9 @@ typedef struct _TMProxyImpl {
     IUnknown				*outerunknown;
     IDispatch				*dispatch;
     IRpcProxyBuffer			*dispatch_proxy;
+    struct method_plan			**plans;
+    unsigned int			nroffuncs;
+    LPBYTE				buf_cache;
 } TMProxyImpl;
 
 static inline TMProxyImpl *impl_from_IRpcProxyBuffer( IRpcProxyBuffer *iface )
@@ -573,6 +647,8 @@ TMProxyImpl_Release(LPRPCPROXYBUFFER iface)
         if (This->chanbuf) IRpcChannelBuffer_Release(This->chanbuf);
         VirtualFree(This->asmstubs, 0, MEM_RELEASE);
         HeapFree(GetProcessHeap(), 0, This->lpvtbl);
+        free_method_plans(This->plans, This->nroffuncs);
+        HeapFree(GetProcessHeap(), 0, This->buf_cache);
         ITypeInfo_Release(This->tinfo);
         CoTaskMemFree(This);
     }
@@ -1412,9 +1488,76 @@ static inline BOOL is_out_elem(const ELEMDESC *elem)
     return (elem->u.paramdesc.wParamFlags & PARAMFLAG_FOUT || !elem->u.paramdesc.wParamFlags);
 }
 
+static HRESULT create_method_plan(ITypeInfo *iface_tinfo, int method, struct method_plan **ret)
+{
+    struct method_plan *plan;
+    const FUNCDESC *fdesc;
+    ITypeInfo *tinfo;
+    BSTR iname, fname;
+    HRESULT hres;
+    int i;
+
+    hres = get_funcdesc(iface_tinfo, method, &tinfo, &fdesc, &iname, &fname, NULL);
+    if (hres) return hres;
+
+    plan = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, FIELD_OFFSET(struct method_plan, params[fdesc->cParams]));
+    if (!plan)
+    {
+        SysFreeString(iname);
+        SysFreeString(fname);
+        ITypeInfo_Release(tinfo);
+        return E_OUTOFMEMORY;
+    }
+
+    plan->tinfo = tinfo;
+    plan->fdesc = fdesc;
+    plan->iname = iname;
+    plan->fname = fname;
+
+    if (ITypeInfo_GetNames(tinfo,fdesc->memid,plan->names,sizeof(plan->names)/sizeof(plan->names[0]),&plan->nrofnames))
+        plan->nrofnames = 0;
+
+    for (i = 0; i < fdesc->cParams; i++)
+    {
+        ELEMDESC *elem = fdesc->lprgelemdescParam + i;
+        struct param_plan *param = &plan->params[i];
+
+        param->argsize = _argsize(&elem->tdesc, tinfo);
+        param->in = is_in_elem(elem);
+        param->out = is_out_elem(elem);
+        if (!param->in && elem->tdesc.vt == VT_PTR)
+            param->outsize = _xsize(elem->tdesc.u.lptdesc, tinfo);
+        plan->nrofargs += param->argsize;
+    }
+
+    *ret = plan;
+    return S_OK;
+}
+
+/* returns the plan of a method, creating it on first use */
+static HRESULT get_method_plan(ITypeInfo *tinfo, struct method_plan **plans, int method,
+                               const struct method_plan **ret)
+{
+    struct method_plan *plan;
+    HRESULT hres;
+
+    if ((*ret = plans[method]))
+        return S_OK;
+
+    hres = create_method_plan(tinfo, method, &plan);
+    if (hres) return hres;
+
+    if ((*ret = InterlockedCompareExchangePointer((void **)&plans[method], plan, NULL)))
+        free_method_plan(plan);  /* another thread was faster */
+    else
+        *ret = plan;
+    return S_OK;
+}
+
 static DWORD WINAPI xCall(int method, void **args)
 {
     TMProxyImpl *tpinfo = args[0];
+    const struct method_plan *plan;
     DWORD *xargs;
     const FUNCDESC	*fdesc;
     HRESULT		hres;
@@ -1422,26 +1565,23 @@ static DWORD WINAPI xCall(int method, void **args)
     marshal_state	buf;
     RPCOLEMESSAGE	msg;
     ULONG		status;
-    BSTR		fname,iname;
-    BSTR		names[10];
-    UINT		nrofnames;
     DWORD		remoteresult = 0;
     ITypeInfo 		*tinfo;
     IRpcChannelBuffer *chanbuf;
 
-    EnterCriticalSection(&tpinfo->crit);
-
-    hres = get_funcdesc(tpinfo->tinfo,method,&tinfo,&fdesc,&iname,&fname,NULL);
+    hres = get_method_plan(tpinfo->tinfo,tpinfo->plans,method,&plan);
     if (hres) {
         ERR("Did not find typeinfo/funcdesc entry for method %d!\n",method);
-        LeaveCriticalSection(&tpinfo->crit);
         return E_FAIL;
     }
+    tinfo = plan->tinfo;
+    fdesc = plan->fdesc;
+
+    EnterCriticalSection(&tpinfo->crit);
 
     if (!tpinfo->chanbuf)
     {
         WARN("Tried to use disconnected proxy\n");
-        ITypeInfo_Release(tinfo);
         LeaveCriticalSection(&tpinfo->crit);
         return RPC_E_DISCONNECTED;
     }
@@ -1452,55 +1592,46 @@ static DWORD WINAPI xCall(int method, void **args)
 
     if (TRACE_ON(olerelay)) {
        TRACE_(olerelay)("->");
-	if (iname)
-	    TRACE_(olerelay)("%s:",relaystr(iname));
-	if (fname)
-	    TRACE_(olerelay)("%s(%d)",relaystr(fname),method);
+	if (plan->iname)
+	    TRACE_(olerelay)("%s:",relaystr(plan->iname));
+	if (plan->fname)
+	    TRACE_(olerelay)("%s(%d)",relaystr(plan->fname),method);
 	else
 	    TRACE_(olerelay)("%d",method);
 	TRACE_(olerelay)("(");
     }
 
-    SysFreeString(iname);
-    SysFreeString(fname);
-
-    memset(&buf,0,sizeof(buf));
+    xbuf_init_cached(&buf, &tpinfo->buf_cache);
 
     /* normal typelib driven serializing */
 
-    /* Need them for hack below */
-    memset(names,0,sizeof(names));
-    if (ITypeInfo_GetNames(tinfo,fdesc->memid,names,sizeof(names)/sizeof(names[0]),&nrofnames))
-	nrofnames = 0;
-    if (nrofnames > sizeof(names)/sizeof(names[0]))
-	ERR("Need more names!\n");
-
     xargs = (DWORD *)(args + 1);
     for (i=0;i<fdesc->cParams;i++) {
 	ELEMDESC	*elem = fdesc->lprgelemdescParam+i;
+	const struct param_plan *param = &plan->params[i];
 	if (TRACE_ON(olerelay)) {
 	    if (i) TRACE_(olerelay)(",");
-	    if (i+1<nrofnames && names[i+1])
-		TRACE_(olerelay)("%s=",relaystr(names[i+1]));
+	    if (i+1<plan->nrofnames && plan->names[i+1])
+		TRACE_(olerelay)("%s=",relaystr(plan->names[i+1]));
 	}
 	/* No need to marshal other data than FIN and any VT_PTR. */
-        if (!is_in_elem(elem))
+        if (!param->in)
         {
             if (elem->tdesc.vt != VT_PTR)
             {
-                xargs+=_argsize(&elem->tdesc, tinfo);
+                xargs+=param->argsize;
                 TRACE_(olerelay)("[out]");
                 continue;
             }
             else
             {
-                memset( *(void **)xargs, 0, _xsize( elem->tdesc.u.lptdesc, tinfo ) );
+                memset( *(void **)xargs, 0, param->outsize );
             }
         }
 
 	hres = serialize_param(
 	    tinfo,
-	    is_in_elem(elem),
+	    param->in,
 	    TRACE_ON(olerelay),
 	    FALSE,
 	    &elem->tdesc,
@@ -1512,7 +1643,7 @@ static DWORD WINAPI xCall(int method, void **args)
 	    ERR("Failed to serialize param, hres %x\n",hres);
 	    break;
 	}
-	xargs+=_argsize(&elem->tdesc, tinfo);
+	xargs+=param->argsize;
     }
     TRACE_(olerelay)(")");
 
@@ -1533,32 +1664,29 @@ static DWORD WINAPI xCall(int method, void **args)
     }
 
     TRACE_(olerelay)(" status = %08x (",status);
-    if (buf.base)
-	buf.base = HeapReAlloc(GetProcessHeap(),0,buf.base,msg.cbBuffer);
-    else
-	buf.base = HeapAlloc(GetProcessHeap(),0,msg.cbBuffer);
-    buf.size = msg.cbBuffer;
-    memcpy(buf.base,msg.Buffer,buf.size);
-    buf.curoff = 0;
+    hres = xbuf_set(&buf, msg.Buffer, msg.cbBuffer);
+    if (hres)
+        goto exit;
 
     /* generic deserializer using typelib description */
     xargs = (DWORD *)(args + 1);
     status = S_OK;
     for (i=0;i<fdesc->cParams;i++) {
 	ELEMDESC	*elem = fdesc->lprgelemdescParam+i;
+	const struct param_plan *param = &plan->params[i];
 
         if (i) TRACE_(olerelay)(",");
-        if (i+1<nrofnames && names[i+1]) TRACE_(olerelay)("%s=",relaystr(names[i+1]));
+        if (i+1<plan->nrofnames && plan->names[i+1]) TRACE_(olerelay)("%s=",relaystr(plan->names[i+1]));
 
 	/* No need to marshal other data than FOUT and any VT_PTR */
-	if (!is_out_elem(elem) && (elem->tdesc.vt != VT_PTR)) {
-	    xargs += _argsize(&elem->tdesc, tinfo);
+	if (!param->out && (elem->tdesc.vt != VT_PTR)) {
+	    xargs += param->argsize;
 	    TRACE_(olerelay)("[in]");
 	    continue;
 	}
 	hres = deserialize_param(
 	    tinfo,
-	    is_out_elem(elem),
+	    param->out,
 	    TRACE_ON(olerelay),
 	    FALSE,
 	    &(elem->tdesc),
@@ -1570,7 +1698,7 @@ static DWORD WINAPI xCall(int method, void **args)
 	    status = hres;
 	    break;
 	}
-	xargs += _argsize(&elem->tdesc, tinfo);
+	xargs += param->argsize;
     }
 
     hres = xbuf_get(&buf, (LPBYTE)&remoteresult, sizeof(DWORD));
@@ -1582,11 +1710,8 @@ static DWORD WINAPI xCall(int method, void **args)
 
 exit:
     IRpcChannelBuffer_FreeBuffer(chanbuf,&msg);
-    for (i = 0; i < nrofnames; i++)
-        SysFreeString(names[i]);
-    HeapFree(GetProcessHeap(),0,buf.base);
+    xbuf_release_cached(&buf, &tpinfo->buf_cache);
     IRpcChannelBuffer_Release(chanbuf);
-    ITypeInfo_Release(tinfo);
     TRACE("-- 0x%08x\n", hres);
     return hres;
 }
@@ -1885,6 +2010,14 @@ PSFacBuf_CreateProxy(
         CoTaskMemFree(proxy);
         return E_OUTOFMEMORY;
     }
+    proxy->plans = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, nroffuncs * sizeof(*proxy->plans));
+    if (!proxy->plans) {
+        VirtualFree(proxy->asmstubs, 0, MEM_RELEASE);
+        CoTaskMemFree(proxy);
+        return E_OUTOFMEMORY;
+    }
+    proxy->nroffuncs = nroffuncs;
+    proxy->buf_cache = NULL;
     proxy->IRpcProxyBuffer_iface.lpVtbl = &tmproxyvtable;
     /* one reference for the proxy */
     proxy->ref		= 1;
@@ -1978,6 +2111,9 @@ typedef struct _TMStubImpl {
     IID				iid;
     IRpcStubBuffer		*dispatch_stub;
     BOOL			dispatch_derivative;
+    struct method_plan		**plans;
+    unsigned int		nroffuncs;
+    LPBYTE			buf_cache;
 } TMStubImpl;
 
 static inline TMStubImpl *impl_from_IRpcStubBuffer(IRpcStubBuffer *iface)
@@ -2022,6 +2158,8 @@ TMStubImpl_Release(LPRPCSTUBBUFFER iface)
         ITypeInfo_Release(This->tinfo);
         if (This->dispatch_stub)
             IRpcStubBuffer_Release(This->dispatch_stub);
+        free_method_plans(This->plans, This->nroffuncs);
+        HeapFree(GetProcessHeap(), 0, This->buf_cache);
         CoTaskMemFree(This);
     }
     return refCount;
@@ -2067,14 +2205,12 @@ TMStubImpl_Invoke(
 #ifdef __i386__
     int		i;
     const FUNCDESC *fdesc;
+    const struct method_plan *plan;
     TMStubImpl *This = impl_from_IRpcStubBuffer(iface);
     HRESULT	hres;
-    DWORD	*args = NULL, res, *xargs, nrofargs;
+    DWORD	*args = NULL, res, *xargs;
     marshal_state	buf;
-    UINT	nrofnames = 0;
-    BSTR	names[10];
-    BSTR	iname = NULL;
-    ITypeInfo 	*tinfo = NULL;
+    ITypeInfo 	*tinfo;
 
     TRACE("...\n");
 
@@ -2101,45 +2237,34 @@ TMStubImpl_Invoke(
         return IRpcStubBuffer_Invoke(This->dispatch_stub, xmsg, rpcchanbuf);
     }
 
-    memset(&buf,0,sizeof(buf));
-    buf.size	= xmsg->cbBuffer;
-    buf.base	= HeapAlloc(GetProcessHeap(), 0, xmsg->cbBuffer);
-    memcpy(buf.base, xmsg->Buffer, xmsg->cbBuffer);
-    buf.curoff	= 0;
+    if (xmsg->iMethod >= This->nroffuncs) {
+        ERR("Invalid method %d\n",xmsg->iMethod);
+        return E_UNEXPECTED;
+    }
 
-    hres = get_funcdesc(This->tinfo,xmsg->iMethod,&tinfo,&fdesc,&iname,NULL,NULL);
+    hres = get_method_plan(This->tinfo,This->plans,xmsg->iMethod,&plan);
     if (hres) {
 	ERR("GetFuncDesc on method %d failed with %x\n",xmsg->iMethod,hres);
 	return hres;
     }
+    tinfo = plan->tinfo;
+    fdesc = plan->fdesc;
 
-    if (iname && !lstrcmpW(iname, IDispatchW))
+    if (plan->iname && !lstrcmpW(plan->iname, IDispatchW))
     {
         ERR("IDispatch cannot be marshaled by the typelib marshaler\n");
-        hres = E_UNEXPECTED;
-        SysFreeString (iname);
-        goto exit;
-    }
-
-    SysFreeString (iname);
-
-    /* Need them for hack below */
-    memset(names,0,sizeof(names));
-    ITypeInfo_GetNames(tinfo,fdesc->memid,names,sizeof(names)/sizeof(names[0]),&nrofnames);
-    if (nrofnames > sizeof(names)/sizeof(names[0])) {
-	ERR("Need more names!\n");
+        return E_UNEXPECTED;
     }
 
     /*dump_FUNCDESC(fdesc);*/
-    nrofargs = 0;
-    for (i=0;i<fdesc->cParams;i++)
-	nrofargs += _argsize(&fdesc->lprgelemdescParam[i].tdesc, tinfo);
-    args = HeapAlloc(GetProcessHeap(),HEAP_ZERO_MEMORY,(nrofargs+1)*sizeof(DWORD));
+    args = HeapAlloc(GetProcessHeap(),HEAP_ZERO_MEMORY,(plan->nrofargs+1)*sizeof(DWORD));
     if (!args)
-    {
-        hres = E_OUTOFMEMORY;
+        return E_OUTOFMEMORY;
+
+    xbuf_init_cached(&buf, &This->buf_cache);
+    hres = xbuf_set(&buf, xmsg->Buffer, xmsg->cbBuffer);
+    if (hres)
         goto exit;
-    }
 
     /* Allocate all stuff used by call. */
     xargs = args+1;
@@ -2148,16 +2273,17 @@ TMStubImpl_Invoke(
 
 	hres = deserialize_param(
 	   tinfo,
-	   is_in_elem(elem),
+	   plan->params[i].in,
 	   FALSE,
 	   TRUE,
 	   &(elem->tdesc),
 	   xargs,
 	   &buf
 	);
-	xargs += _argsize(&elem->tdesc, tinfo);
+	xargs += plan->params[i].argsize;
 	if (hres) {
-	    ERR("Failed to deserialize param %s, hres %x\n",relaystr(names[i+1]),hres);
+	    ERR("Failed to deserialize param %s, hres %x\n",
+	        i+1<plan->nrofnames ? relaystr(plan->names[i+1]) : "",hres);
 	    break;
 	}
     }
@@ -2187,6 +2313,8 @@ TMStubImpl_Invoke(
     if (hres != S_OK)
         goto exit;
 
+    /* reuse the whole buffer for the reply */
+    if (buf.base) buf.size = HeapSize(GetProcessHeap(), 0, buf.base);
     buf.curoff = 0;
 
     xargs = args+1;
@@ -2194,14 +2322,14 @@ TMStubImpl_Invoke(
 	ELEMDESC	*elem = fdesc->lprgelemdescParam+i;
 	hres = serialize_param(
 	   tinfo,
-	   is_out_elem(elem),
+	   plan->params[i].out,
 	   FALSE,
 	   TRUE,
 	   &elem->tdesc,
 	   xargs,
 	   &buf
 	);
-	xargs += _argsize(&elem->tdesc, tinfo);
+	xargs += plan->params[i].argsize;
 	if (hres) {
 	    ERR("Failed to stuballoc param, hres %x\n",hres);
 	    break;
@@ -2222,13 +2350,9 @@ TMStubImpl_Invoke(
         memcpy(xmsg->Buffer, buf.base, buf.curoff);
 
 exit:
-    for (i = 0; i < nrofnames; i++)
-        SysFreeString(names[i]);
-
-    ITypeInfo_Release(tinfo);
     HeapFree(GetProcessHeap(), 0, args);
 
-    HeapFree(GetProcessHeap(), 0, buf.base);
+    xbuf_release_cached(&buf, &This->buf_cache);
 
     TRACE("returning\n");
     return hres;
@@ -2285,6 +2409,7 @@ PSFacBuf_CreateStub(
     TMStubImpl	*stub;
     TYPEATTR *typeattr;
     IUnknown *obj;
+    unsigned int nroffuncs;
 
     TRACE("(%s,%p,%p)\n",debugstr_guid(riid),pUnkServer,ppStub);
 
@@ -2294,6 +2419,13 @@ PSFacBuf_CreateStub(
 	return hres;
     }
 
+    hres = num_of_funcs(tinfo, &nroffuncs, NULL);
+    if (FAILED(hres)) {
+        ERR("Cannot get number of functions for typeinfo %s\n",debugstr_guid(riid));
+        ITypeInfo_Release(tinfo);
+        return hres;
+    }
+
     /* FIXME: This is not exactly right. We should probably call QI later. */
     hres = IUnknown_QueryInterface(pUnkServer, riid, (void**)&obj);
     if (FAILED(hres)) {
@@ -2307,6 +2439,14 @@ PSFacBuf_CreateStub(
         IUnknown_Release(obj);
 	return E_OUTOFMEMORY;
     }
+    stub->plans = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, nroffuncs * sizeof(*stub->plans));
+    if (!stub->plans) {
+        CoTaskMemFree(stub);
+        IUnknown_Release(obj);
+        return E_OUTOFMEMORY;
+    }
+    stub->nroffuncs = nroffuncs;
+    stub->buf_cache = NULL;
     stub->IRpcStubBuffer_iface.lpVtbl = &tmstubvtbl;
     stub->ref		= 1;
     stub->tinfo		= tinfo;
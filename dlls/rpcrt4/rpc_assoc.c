@@ -236,6 +236,7 @@ static RPC_STATUS RpcAssoc_BindConnection(const RpcAssoc *assoc, RpcConnection *
     RPC_STATUS status;
     unsigned char *auth_data = NULL;
     ULONG auth_length;
+    BOOL shm;
 
     TRACE("sending bind request to server\n");
 
@@ -244,6 +245,9 @@ static RPC_STATUS RpcAssoc_BindConnection(const RpcAssoc *assoc, RpcConnection *
                                  assoc->assoc_group_id,
                                  InterfaceId, TransferSyntax);
 
+    if ((shm = rpcrt4_conn_shm_supported(conn)))
+        hdr->common.flags |= RPC_FLG_WINE_SHM;
+
     status = RPCRT4_Send(conn, hdr, NULL, 0);
     RPCRT4_FreeHeader(hdr);
     if (status != RPC_S_OK)
@@ -274,8 +278,11 @@ static RPC_STATUS RpcAssoc_BindConnection(const RpcAssoc *assoc, RpcConnection *
                 switch (results->results[0].result)
                 {
                 case RESULT_ACCEPT:
+                    /* the server agreed to use shared memory, switch before sending anything else */
+                    if (shm && (response_hdr->common.flags & RPC_FLG_WINE_SHM))
+                        status = rpcrt4_conn_shm_negotiated(conn);
                     /* respond to authorization request */
-                    if (auth_length > sizeof(RpcAuthVerifier))
+                    if (status == RPC_S_OK && auth_length > sizeof(RpcAuthVerifier))
                         status = RPCRT4_ClientConnectionAuth(conn,
                                                              auth_data + sizeof(RpcAuthVerifier),
                                                              auth_length);
@@ -115,6 +115,8 @@ struct connection_ops {
   RPC_STATUS (*impersonate_client)(RpcConnection *conn);
   RPC_STATUS (*revert_to_self)(RpcConnection *conn);
   RPC_STATUS (*inquire_auth_client)(RpcConnection *, RPC_AUTHZ_HANDLE *, RPC_WSTR *, ULONG *, ULONG *, ULONG *, ULONG);
+  BOOL (*shm_supported)(RpcConnection *conn);
+  RPC_STATUS (*shm_negotiated)(RpcConnection *conn);
 };
 
 /* don't know what MS's structure looks like */
@@ -246,6 +248,18 @@ static inline RPC_STATUS rpcrt4_conn_inquire_auth_client(
     return conn->ops->inquire_auth_client(conn, privs, server_princ_name, authn_level, authn_svc, authz_svc, flags);
 }
 
+/* whether the connection can offer or accept RPC_FLG_WINE_SHM in a bind */
+static inline BOOL rpcrt4_conn_shm_supported(RpcConnection *conn)
+{
+    return conn->ops->shm_supported && conn->ops->shm_supported(conn);
+}
+
+/* called when both sides agreed on RPC_FLG_WINE_SHM, before any other packet */
+static inline RPC_STATUS rpcrt4_conn_shm_negotiated(RpcConnection *conn)
+{
+    return conn->ops->shm_negotiated(conn);
+}
+
 /* floors 3 and up */
 RPC_STATUS RpcTransport_GetTopOfTower(unsigned char *tower_data, size_t *tower_size, const char *protseq, const char *networkaddr, const char *endpoint) DECLSPEC_HIDDEN;
 RPC_STATUS RpcTransport_ParseTopOfTower(const unsigned char *tower_data, size_t tower_size, char **protseq, char **networkaddr, char **endpoint) DECLSPEC_HIDDEN;
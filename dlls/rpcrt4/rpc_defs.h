@@ -178,6 +178,7 @@ typedef struct
 
 #define RPC_FLG_FIRST             1
 #define RPC_FLG_LAST              2
+#define RPC_FLG_WINE_SHM       0x08  /* Wine extension in bind and bind_ack: ncalrpc over shared memory */
 #define RPC_FLG_OBJECT_UUID    0x80
 
 #define RPC_MIN_PACKET_SIZE  0x1000
@@ -329,12 +329,21 @@ static RPC_STATUS process_bind_packet_no_send(
                                             conn->server_binding->Assoc->assoc_group_id,
                                             conn->Endpoint, hdr->num_elements,
                                             results);
-  HeapFree(GetProcessHeap(), 0, results);
 
   if (*ack_response)
+  {
       conn->MaxTransmissionSize = hdr->max_tsize;
+
+      /* the client asks for shared memory right after an accepted bind */
+      if ((hdr->common.flags & RPC_FLG_WINE_SHM) &&
+          hdr->num_elements == 1 && results[0].result == RESULT_ACCEPT &&
+          rpcrt4_conn_shm_supported(conn) &&
+          rpcrt4_conn_shm_negotiated(conn) == RPC_S_OK)
+          (*ack_response)->common.flags |= RPC_FLG_WINE_SHM;
+  }
   else
       status = RPC_S_OUT_OF_RESOURCES;
+  HeapFree(GetProcessHeap(), 0, results);
 
   return status;
 }
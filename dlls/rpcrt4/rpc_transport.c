@@ -31,6 +31,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <sys/types.h>
 
 #include "ntstatus.h"
@@ -113,12 +114,23 @@ static RPC_STATUS RPCRT4_SpawnConnection(RpcConnection** Connection, RpcConnecti
 
 /**** ncacn_np support ****/
 
+struct lrpc_shm;
+
 typedef struct _RpcConnection_np
 {
   RpcConnection common;
   HANDLE pipe;
   HANDLE listen_thread;
   BOOL listening;
+  /* ncalrpc only: shared memory used instead of the pipe */
+  struct lrpc_shm *shm;
+  BOOL shm_pending;       /* the bind agreed on shared memory, waiting for the client request */
+  HANDLE shm_peer;        /* process at the other end */
+  HANDLE shm_peer_wait;   /* thread pool wait for its exit */
+  LONG shm_users;         /* threads currently accessing shm */
+  LONG shm_closing;       /* the connection is being closed */
+  LONG shm_cancelled;     /* a call was cancelled */
+  LONG shm_peer_gone;     /* the other process exited */
 } RpcConnection_np;
 
 static RpcConnection *rpcrt4_conn_np_alloc(void)
@@ -529,6 +541,442 @@ static int rpcrt4_conn_np_wait_for_incoming_data(RpcConnection *Connection)
     return -1;
 }
 
+/**** ncalrpc shared memory support ****/
+
+/* Packets of ncalrpc connections between two Wine processes can be passed
+ * through a pair of ring buffers in a shared memory section instead of the
+ * named pipe, with futexes used to wake up the other side. Both sides agree
+ * on it with RPC_FLG_WINE_SHM in the bind and bind_ack. The client then
+ * asks for the section with a special packet on the pipe, and the server
+ * creates it and duplicates it into the client process. The pipe is kept
+ * open for client impersonation. */
+
+#define LRPC_SHM_RING_SIZE 0x10000
+#define LRPC_SHM_REQUEST   0xff  /* not a valid rpc_ver */
+
+struct lrpc_shm_ring
+{
+  LONG head;    /* total number of bytes written */
+  LONG tail;    /* total number of bytes read */
+  BYTE data[LRPC_SHM_RING_SIZE];
+};
+
+struct lrpc_shm
+{
+  struct lrpc_shm_ring ring[2];  /* client to server, server to client */
+  LONG signal[2];   /* bumped to wake up the client and the server side */
+  LONG waiters[2];  /* threads waiting on signal on each side */
+  LONG closed;      /* one of the sides closed the connection */
+};
+
+/* exchanged on the pipe right after the bind: the client request, the
+ * server reply, and the client confirmation that it mapped the section */
+struct lrpc_shm_message
+{
+  BYTE  rpc_ver;  /* LRPC_SHM_REQUEST */
+  BYTE  pad[3];
+  DWORD status;   /* reply and confirmation: RPC_S_OK if the section is used */
+  DWORD section;  /* reply: section handle in the client process */
+  DWORD process;  /* reply: server process handle in the client process */
+};
+
+/* the server reads the common header of the first packet in one go */
+C_ASSERT(sizeof(struct lrpc_shm_message) == sizeof(RpcPktCommonHdr));
+
+extern NTSTATUS CDECL __wine_futex_wait(LONG *addr, LONG val);
+extern NTSTATUS CDECL __wine_futex_wake(LONG *addr, LONG count);
+
+static BOOL lrpc_shm_available(void)
+{
+  static LONG supported = -1;
+
+  if (supported == -1)
+    supported = (__wine_futex_wake(&supported, 0) != STATUS_NOT_IMPLEMENTED);
+  return supported;
+}
+
+/* read a value stored by another thread or the other side, the reads
+ * that follow are ordered after it */
+static inline LONG lrpc_shm_load(LONG *addr)
+{
+  return InterlockedCompareExchange(addr, 0, 0);
+}
+
+static inline int lrpc_shm_side(RpcConnection_np *npc)
+{
+  return npc->common.server ? 1 : 0;
+}
+
+/* wake up the threads of one side waiting on the section */
+static void lrpc_shm_signal(struct lrpc_shm *shm, int side)
+{
+  InterlockedIncrement(&shm->signal[side]);
+  if (lrpc_shm_load(&shm->waiters[side]))
+    __wine_futex_wake(&shm->signal[side], INT_MAX);
+}
+
+/* keep the section mapped while a thread uses it */
+static BOOL lrpc_shm_enter(RpcConnection_np *npc)
+{
+  InterlockedIncrement(&npc->shm_users);
+  if (!lrpc_shm_load(&npc->shm_closing) && npc->shm)
+    return TRUE;
+  if (!InterlockedDecrement(&npc->shm_users))
+    __wine_futex_wake(&npc->shm_users, INT_MAX);
+  return FALSE;
+}
+
+static void lrpc_shm_leave(RpcConnection_np *npc)
+{
+  if (!InterlockedDecrement(&npc->shm_users) && lrpc_shm_load(&npc->shm_closing))
+    __wine_futex_wake(&npc->shm_users, INT_MAX);
+}
+
+/* wait until there's data to read in the ring, or space to write into it,
+ * returns FALSE if the connection is closed or the call cancelled */
+static BOOL lrpc_shm_wait(RpcConnection_np *npc, struct lrpc_shm_ring *ring, BOOL write)
+{
+  struct lrpc_shm *shm = npc->shm;
+  int side = lrpc_shm_side(npc);
+  unsigned int used;
+  LONG signal;
+
+  for (;;)
+  {
+    signal = lrpc_shm_load(&shm->signal[side]);
+    if (write && lrpc_shm_load(&shm->closed))
+      return FALSE;
+
+    used = lrpc_shm_load(&ring->head) - lrpc_shm_load(&ring->tail);
+    if (write ? used < LRPC_SHM_RING_SIZE : used != 0)
+      return TRUE;
+
+    if (lrpc_shm_load(&shm->closed) || lrpc_shm_load(&npc->shm_peer_gone) ||
+        InterlockedExchange(&npc->shm_cancelled, FALSE))
+      return FALSE;
+
+    InterlockedIncrement(&shm->waiters[side]);
+    __wine_futex_wait(&shm->signal[side], signal);
+    InterlockedDecrement(&shm->waiters[side]);
+  }
+}
+
+static int lrpc_shm_read(RpcConnection_np *npc, void *buffer, unsigned int count)
+{
+  struct lrpc_shm_ring *ring = &npc->shm->ring[lrpc_shm_side(npc)];
+  unsigned int bytes_left = count, head, tail = ring->tail, pos, len;
+  char *buf = buffer;
+
+  while (bytes_left)
+  {
+    if (!lrpc_shm_wait(npc, ring, FALSE))
+      return -1;
+
+    head = lrpc_shm_load(&ring->head);
+    pos = tail % LRPC_SHM_RING_SIZE;
+    len = min(min(head - tail, bytes_left), LRPC_SHM_RING_SIZE - pos);
+    memcpy(buf, ring->data + pos, len);
+    buf += len;
+    bytes_left -= len;
+    tail += len;
+
+    InterlockedExchange(&ring->tail, tail);
+    lrpc_shm_signal(npc->shm, !lrpc_shm_side(npc));
+  }
+  return count;
+}
+
+static int lrpc_shm_write(RpcConnection_np *npc, const void *buffer, unsigned int count)
+{
+  struct lrpc_shm_ring *ring = &npc->shm->ring[!lrpc_shm_side(npc)];
+  unsigned int bytes_left = count, head = ring->head, tail, pos, len;
+  const char *buf = buffer;
+
+  while (bytes_left)
+  {
+    if (!lrpc_shm_wait(npc, ring, TRUE))
+      return -1;
+
+    tail = lrpc_shm_load(&ring->tail);
+    pos = head % LRPC_SHM_RING_SIZE;
+    len = min(min(LRPC_SHM_RING_SIZE - (head - tail), bytes_left), LRPC_SHM_RING_SIZE - pos);
+    memcpy(ring->data + pos, buf, len);
+    buf += len;
+    bytes_left -= len;
+    head += len;
+
+    InterlockedExchange(&ring->head, head);
+    lrpc_shm_signal(npc->shm, !lrpc_shm_side(npc));
+  }
+  return count;
+}
+
+static void CALLBACK lrpc_shm_peer_exited(void *arg, BOOLEAN timed_out)
+{
+  RpcConnection_np *npc = arg;
+
+  TRACE("%p\n", npc);
+  InterlockedExchange(&npc->shm_peer_gone, TRUE);
+  lrpc_shm_signal(npc->shm, lrpc_shm_side(npc));
+}
+
+/* switch the connection to the section, watching the other process */
+static BOOL lrpc_shm_start(RpcConnection_np *npc, struct lrpc_shm *shm, HANDLE peer)
+{
+  npc->shm_closing = FALSE;
+  npc->shm_cancelled = FALSE;
+  npc->shm_peer_gone = FALSE;
+  npc->shm = shm;
+  npc->shm_peer = peer;
+  if (RegisterWaitForSingleObject(&npc->shm_peer_wait, peer, lrpc_shm_peer_exited,
+                                  npc, INFINITE, WT_EXECUTEONLYONCE))
+    return TRUE;
+
+  ERR("couldn't wait for the other process, error %u\n", GetLastError());
+  npc->shm = NULL;
+  npc->shm_peer = NULL;
+  return FALSE;
+}
+
+static void lrpc_shm_close(RpcConnection_np *npc)
+{
+  struct lrpc_shm *shm = npc->shm;
+  LONG users;
+
+  InterlockedExchange(&npc->shm_closing, TRUE);
+  InterlockedExchange(&shm->closed, TRUE);
+  lrpc_shm_signal(shm, 0);
+  lrpc_shm_signal(shm, 1);
+
+  UnregisterWaitEx(npc->shm_peer_wait, INVALID_HANDLE_VALUE);
+  while ((users = lrpc_shm_load(&npc->shm_users)))
+    __wine_futex_wait(&npc->shm_users, users);
+
+  UnmapViewOfFile(shm);
+  CloseHandle(npc->shm_peer);
+  npc->shm = NULL;
+  npc->shm_peer = NULL;
+  npc->shm_peer_wait = NULL;
+}
+
+/* server side: create a section for the client that sent the request,
+ * returns an error if the pipe can't be used any more */
+static RPC_STATUS lrpc_shm_accept(RpcConnection_np *npc)
+{
+  struct lrpc_shm_message msg;
+  struct lrpc_shm *shm = NULL;
+  HANDLE client = NULL, section = NULL, remote_section = NULL, remote_process = NULL;
+  ULONG client_pid = 0;
+  RPC_STATUS status = RPC_S_OK;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.rpc_ver = LRPC_SHM_REQUEST;
+  msg.status = RPC_S_OUT_OF_RESOURCES;
+
+  /* only trust the pipe about who the client is */
+  if (GetNamedPipeClientProcessId(npc->pipe, &client_pid) &&
+      (client = OpenProcess(PROCESS_DUP_HANDLE | SYNCHRONIZE, FALSE, client_pid)) &&
+      (section = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(*shm), NULL)) &&
+      (shm = MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(*shm))) &&
+      DuplicateHandle(GetCurrentProcess(), section, client, &remote_section,
+                      FILE_MAP_READ | FILE_MAP_WRITE, FALSE, 0) &&
+      DuplicateHandle(GetCurrentProcess(), GetCurrentProcess(), client, &remote_process,
+                      SYNCHRONIZE, FALSE, 0))
+  {
+    msg.status = RPC_S_OK;
+    msg.section = HandleToULong(remote_section);
+    msg.process = HandleToULong(remote_process);
+  }
+  else
+    WARN("no shared memory for process %04x, error %u\n", client_pid, GetLastError());
+  if (section) CloseHandle(section);
+
+  if (rpcrt4_conn_np_write(&npc->common, &msg, sizeof(msg)) != sizeof(msg))
+  {
+    /* the client never got the handles */
+    if (remote_section)
+      DuplicateHandle(client, remote_section, NULL, NULL, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+    if (remote_process)
+      DuplicateHandle(client, remote_process, NULL, NULL, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+    status = RPC_S_SERVER_UNAVAILABLE;
+  }
+  else if (msg.status == RPC_S_OK)
+  {
+    if (rpcrt4_conn_np_read(&npc->common, &msg, sizeof(msg)) != sizeof(msg) ||
+        msg.rpc_ver != LRPC_SHM_REQUEST)
+      status = RPC_S_SERVER_UNAVAILABLE;
+    else if (msg.status == RPC_S_OK)
+    {
+      /* the client switched already */
+      if (lrpc_shm_start(npc, shm, client))
+      {
+        TRACE("using shared memory with process %04x\n", client_pid);
+        return RPC_S_OK;
+      }
+      status = RPC_S_OUT_OF_RESOURCES;
+    }
+  }
+
+  if (shm) UnmapViewOfFile(shm);
+  if (client) CloseHandle(client);
+  return status;
+}
+
+/* client side: ask the server for the section, returns an error if the
+ * pipe can't be used any more */
+static RPC_STATUS lrpc_shm_connect(RpcConnection_np *npc)
+{
+  struct lrpc_shm_message msg;
+  struct lrpc_shm *shm = NULL;
+  HANDLE section, process;
+  ULONG server_pid;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.rpc_ver = LRPC_SHM_REQUEST;
+  if (rpcrt4_conn_np_write(&npc->common, &msg, sizeof(msg)) != sizeof(msg) ||
+      rpcrt4_conn_np_read(&npc->common, &msg, sizeof(msg)) != sizeof(msg))
+    return RPC_S_SERVER_UNAVAILABLE;
+  if (msg.rpc_ver != LRPC_SHM_REQUEST)
+    return RPC_S_PROTOCOL_ERROR;
+  if (msg.status != RPC_S_OK)
+  {
+    TRACE("no shared memory, status %u\n", msg.status);
+    return RPC_S_OK;
+  }
+
+  /* don't close handles that may not come from the server */
+  section = ULongToHandle(msg.section);
+  process = ULongToHandle(msg.process);
+  if (!GetNamedPipeServerProcessId(npc->pipe, &server_pid) || GetProcessId(process) != server_pid)
+    ERR("invalid process handle %p from the server\n", process);
+  else if (!(shm = MapViewOfFile(section, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(*shm))))
+  {
+    WARN("couldn't map section %p, error %u\n", section, GetLastError());
+    CloseHandle(process);
+  }
+  else
+  {
+    CloseHandle(section);
+    if (!lrpc_shm_start(npc, shm, process))
+    {
+      UnmapViewOfFile(shm);
+      CloseHandle(process);
+    }
+  }
+
+  msg.status = npc->shm ? RPC_S_OK : RPC_S_OUT_OF_RESOURCES;
+  msg.section = msg.process = 0;
+  /* on failure closing the connection also releases the section */
+  if (rpcrt4_conn_np_write(&npc->common, &msg, sizeof(msg)) != sizeof(msg))
+    return RPC_S_SERVER_UNAVAILABLE;
+
+  if (npc->shm) TRACE("using shared memory with process %04x\n", server_pid);
+  return RPC_S_OK;
+}
+
+static BOOL rpcrt4_ncalrpc_shm_supported(RpcConnection *Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  return lrpc_shm_available() && !npc->shm && !npc->shm_pending;
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_shm_negotiated(RpcConnection *Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  if (!Connection->server)
+    return lrpc_shm_connect(npc);
+
+  /* the request is the next thing the client sends */
+  npc->shm_pending = TRUE;
+  return RPC_S_OK;
+}
+
+static int rpcrt4_conn_ncalrpc_read(RpcConnection *Connection,
+                                    void *buffer, unsigned int count)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+  int ret;
+
+  if (npc->shm_pending)
+  {
+    npc->shm_pending = FALSE;
+    ret = rpcrt4_conn_np_read(Connection, buffer, count);
+    /* a client that ignored the flag goes on with the pipe */
+    if (ret != sizeof(struct lrpc_shm_message) || *(BYTE *)buffer != LRPC_SHM_REQUEST)
+      return ret;
+    if (lrpc_shm_accept(npc) != RPC_S_OK)
+      return -1;
+  }
+
+  if (npc->shm)
+  {
+    if (!lrpc_shm_enter(npc))
+      return -1;
+    ret = lrpc_shm_read(npc, buffer, count);
+    lrpc_shm_leave(npc);
+    return ret;
+  }
+  return rpcrt4_conn_np_read(Connection, buffer, count);
+}
+
+static int rpcrt4_conn_ncalrpc_write(RpcConnection *Connection,
+                                     const void *buffer, unsigned int count)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+  int ret;
+
+  if (npc->shm)
+  {
+    if (!lrpc_shm_enter(npc))
+      return -1;
+    ret = lrpc_shm_write(npc, buffer, count);
+    lrpc_shm_leave(npc);
+    return ret;
+  }
+  return rpcrt4_conn_np_write(Connection, buffer, count);
+}
+
+static int rpcrt4_conn_ncalrpc_close(RpcConnection *Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  if (npc->shm)
+    lrpc_shm_close(npc);
+  return rpcrt4_conn_np_close(Connection);
+}
+
+static void rpcrt4_conn_ncalrpc_cancel_call(RpcConnection *Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  TRACE("%p\n", Connection);
+
+  if (!npc->shm || !lrpc_shm_enter(npc))
+  {
+    rpcrt4_conn_np_cancel_call(Connection);
+    return;
+  }
+  InterlockedExchange(&npc->shm_cancelled, TRUE);
+  lrpc_shm_signal(npc->shm, lrpc_shm_side(npc));
+  lrpc_shm_leave(npc);
+}
+
+static int rpcrt4_conn_ncalrpc_wait_for_incoming_data(RpcConnection *Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+  int ret;
+
+  TRACE("%p\n", Connection);
+
+  if (!npc->shm || !lrpc_shm_enter(npc))
+    return rpcrt4_conn_np_wait_for_incoming_data(Connection);
+  ret = lrpc_shm_wait(npc, &npc->shm->ring[lrpc_shm_side(npc)], FALSE) ? 0 : -1;
+  lrpc_shm_leave(npc);
+  return ret;
+}
+
 static size_t rpcrt4_ncacn_np_get_top_of_tower(unsigned char *tower_data,
                                                const char *networkaddr,
                                                const char *endpoint)
@@ -3422,18 +3870,20 @@ static const struct connection_ops conn_protseq_list[] = {
     rpcrt4_conn_np_impersonate_client,
     rpcrt4_conn_np_revert_to_self,
     RPCRT4_default_inquire_auth_client,
+    NULL,
+    NULL,
   },
   { "ncalrpc",
     { EPM_PROTOCOL_NCALRPC, EPM_PROTOCOL_PIPE },
     rpcrt4_conn_np_alloc,
     rpcrt4_ncalrpc_open,
     rpcrt4_ncalrpc_handoff,
-    rpcrt4_conn_np_read,
-    rpcrt4_conn_np_write,
-    rpcrt4_conn_np_close,
-    rpcrt4_conn_np_cancel_call,
+    rpcrt4_conn_ncalrpc_read,
+    rpcrt4_conn_ncalrpc_write,
+    rpcrt4_conn_ncalrpc_close,
+    rpcrt4_conn_ncalrpc_cancel_call,
     rpcrt4_ncalrpc_np_is_server_listening,
-    rpcrt4_conn_np_wait_for_incoming_data,
+    rpcrt4_conn_ncalrpc_wait_for_incoming_data,
     rpcrt4_ncalrpc_get_top_of_tower,
     rpcrt4_ncalrpc_parse_top_of_tower,
     NULL,
@@ -3443,6 +3893,8 @@ static const struct connection_ops conn_protseq_list[] = {
     rpcrt4_conn_np_impersonate_client,
     rpcrt4_conn_np_revert_to_self,
     rpcrt4_ncalrpc_inquire_auth_client,
+    rpcrt4_ncalrpc_shm_supported,
+    rpcrt4_ncalrpc_shm_negotiated,
   },
   { "ncacn_ip_tcp",
     { EPM_PROTOCOL_NCACN, EPM_PROTOCOL_TCP },
@@ -3464,6 +3916,8 @@ static const struct connection_ops conn_protseq_list[] = {
     RPCRT4_default_impersonate_client,
     RPCRT4_default_revert_to_self,
     RPCRT4_default_inquire_auth_client,
+    NULL,
+    NULL,
   },
   { "ncacn_http",
     { EPM_PROTOCOL_NCACN, EPM_PROTOCOL_HTTP },
@@ -3485,6 +3939,8 @@ static const struct connection_ops conn_protseq_list[] = {
     RPCRT4_default_impersonate_client,
     RPCRT4_default_revert_to_self,
     RPCRT4_default_inquire_auth_client,
+    NULL,
+    NULL,
   },
 };
 
@@ -835,6 +835,11 @@ void __cdecl s_stop(void)
   ok(SetEvent(stop_event), "SetEvent\n");
 }
 
+void __cdecl s_exit_server(void)
+{
+  ExitProcess(0);
+}
+
 static void
 make_cmdline(char buffer[MAX_PATH], const char *test)
 {
@@ -1601,6 +1606,226 @@ static void _test_is_server_listening2(unsigned line, RPC_BINDING_HANDLE binding
                        status, expected_status, expected_status2);
 }
 
+static void
+large_array_test(void)
+{
+  int *x, n = 100000, sum = 0, i;
+
+  /* bigger than any buffer the transport passes it through */
+  x = HeapAlloc(GetProcessHeap(), 0, n * sizeof(*x));
+  for (i = 0; i < n; i++)
+  {
+    x[i] = i % 100;
+    sum += x[i];
+  }
+  ok(sum_conf_array(x, n) == sum, "RPC sum_conf_array\n");
+  HeapFree(GetProcessHeap(), 0, x);
+}
+
+#define LRPC_PROXY_ENDPOINT "wine_rpcrt4_proxy"
+
+/* relays an ncalrpc connection to the server, making the bind look like
+ * it comes from a client that doesn't know about Wine extensions */
+struct lrpc_proxy
+{
+  HANDLE client;       /* pipe end the client connects to */
+  HANDLE server;       /* connection to the real server */
+  LONG packets;        /* packets relayed from the client */
+  BYTE bind_flags;     /* pfc_flags of the bind, before clearing them */
+  BYTE next_ver;       /* rpc_ver of the packet following the bind */
+};
+
+static BOOL lrpc_proxy_io(HANDLE pipe, BOOL write, void *buf, DWORD size, DWORD *count, HANDLE event)
+{
+  OVERLAPPED ov;
+  BOOL ret;
+
+  memset(&ov, 0, sizeof(ov));
+  ov.hEvent = event;
+  if (write)
+    ret = WriteFile(pipe, buf, size, count, &ov);
+  else
+    ret = ReadFile(pipe, buf, size, count, &ov);
+  if (!ret && GetLastError() == ERROR_IO_PENDING)
+    ret = GetOverlappedResult(pipe, &ov, count, TRUE);
+  return ret;
+}
+
+static void lrpc_proxy_relay(struct lrpc_proxy *proxy, BOOL from_client)
+{
+  HANDLE from = from_client ? proxy->client : proxy->server;
+  HANDLE to = from_client ? proxy->server : proxy->client;
+  HANDLE event = CreateEventA(NULL, TRUE, FALSE, NULL);
+  BYTE buf[0x10000];
+  DWORD size, written;
+
+  while (lrpc_proxy_io(from, FALSE, buf, sizeof(buf), &size, event))
+  {
+    if (from_client && size >= 4)
+    {
+      LONG packet = InterlockedIncrement(&proxy->packets);
+
+      if (packet == 1 && buf[2] == 11 /* bind */)
+      {
+        proxy->bind_flags = buf[3];
+        buf[3] &= ~0x08;
+      }
+      else if (packet == 2)
+        proxy->next_ver = buf[0];
+    }
+    if (!lrpc_proxy_io(to, TRUE, buf, size, &written, event) || written != size)
+      break;
+  }
+  CloseHandle(event);
+}
+
+static DWORD WINAPI lrpc_proxy_server_thread(void *arg)
+{
+  lrpc_proxy_relay(arg, FALSE);
+  return 0;
+}
+
+static DWORD WINAPI lrpc_proxy_thread(void *arg)
+{
+  static const char server_pipe[] = "\\\\.\\pipe\\lrpc\\00000000-4114-0704-2301-000000000000";
+  struct lrpc_proxy *proxy = arg;
+  DWORD mode = PIPE_READMODE_MESSAGE, size;
+  OVERLAPPED ov;
+  HANDLE thread;
+  BOOL ret;
+
+  memset(&ov, 0, sizeof(ov));
+  ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+  ret = ConnectNamedPipe(proxy->client, &ov);
+  if (!ret && GetLastError() == ERROR_IO_PENDING)
+    ret = GetOverlappedResult(proxy->client, &ov, &size, TRUE);
+  else if (!ret && GetLastError() == ERROR_PIPE_CONNECTED)
+    ret = TRUE;
+  CloseHandle(ov.hEvent);
+  ok(ret, "ConnectNamedPipe failed with error %u\n", GetLastError());
+  if (!ret) return 1;
+
+  ok(WaitNamedPipeA(server_pipe, 5000), "WaitNamedPipe failed with error %u\n", GetLastError());
+  proxy->server = CreateFileA(server_pipe, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                              FILE_FLAG_OVERLAPPED, NULL);
+  ok(proxy->server != INVALID_HANDLE_VALUE, "CreateFile failed with error %u\n", GetLastError());
+  if (proxy->server == INVALID_HANDLE_VALUE) return 1;
+  ok(SetNamedPipeHandleState(proxy->server, &mode, NULL, NULL), "SetNamedPipeHandleState failed\n");
+
+  thread = CreateThread(NULL, 0, lrpc_proxy_server_thread, proxy, 0, NULL);
+  ok(thread != NULL, "CreateThread failed with error %u\n", GetLastError());
+  CloseHandle(thread);
+
+  lrpc_proxy_relay(proxy, TRUE);
+  return 0;
+}
+
+static void
+lrpc_fallback_test(void)
+{
+  static unsigned char ncalrpc[] = "ncalrpc";
+  static unsigned char endpoint[] = LRPC_PROXY_ENDPOINT;
+  struct lrpc_proxy proxy;
+  unsigned char *binding;
+  HANDLE thread;
+
+  memset(&proxy, 0, sizeof(proxy));
+  proxy.client = CreateNamedPipeA("\\\\.\\pipe\\lrpc\\" LRPC_PROXY_ENDPOINT,
+                                  PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+                                  PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE,
+                                  1, 0x10000, 0x10000, 0, NULL);
+  ok(proxy.client != INVALID_HANDLE_VALUE, "CreateNamedPipe failed with error %u\n", GetLastError());
+  if (proxy.client == INVALID_HANDLE_VALUE) return;
+  thread = CreateThread(NULL, 0, lrpc_proxy_thread, &proxy, 0, NULL);
+  ok(thread != NULL, "CreateThread failed with error %u\n", GetLastError());
+
+  ok(RPC_S_OK == RpcStringBindingComposeA(NULL, ncalrpc, NULL, endpoint, NULL, &binding), "RpcStringBindingCompose\n");
+  ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
+
+  ok(int_return() == INT_CODE, "RPC int_return\n");
+  ok(sum(23, -4) == 19, "RPC sum\n");
+  large_array_test();
+
+  /* the client offered shared memory, and went on with the pipe when the
+   * server didn't acknowledge it */
+  ok(proxy.bind_flags & 0x08, "bind flags %#x\n", proxy.bind_flags);
+  ok(proxy.next_ver == 5, "rpc_ver %#x after the bind\n", proxy.next_ver);
+
+  ok(RPC_S_OK == RpcStringFreeA(&binding), "RpcStringFree\n");
+  ok(RPC_S_OK == RpcBindingFree(&IServer_IfHandle), "RpcBindingFree\n");
+
+  /* the relay ends when the client closes its connection */
+  ok(WaitForSingleObject(thread, 5000) == WAIT_OBJECT_0, "proxy thread didn't exit\n");
+  CloseHandle(thread);
+  CloseHandle(proxy.client);
+  CloseHandle(proxy.server);
+}
+
+static DWORD WINAPI exit_server_thread(void *arg)
+{
+  DWORD ret = RPC_S_OK;
+
+  RpcTryExcept
+  {
+    exit_server();
+  }
+  RpcExcept(TRUE)
+  {
+    ret = RpcExceptionCode();
+  }
+  RpcEndExcept
+  return ret;
+}
+
+static void
+server_exit_test(void)
+{
+  static unsigned char ncalrpc[] = "ncalrpc";
+  static unsigned char guid[] = "00000000-4114-0704-2301-000000000001";
+  char cmdline[MAX_PATH];
+  PROCESS_INFORMATION info;
+  STARTUPINFOA startup;
+  unsigned char *binding;
+  HANDLE ready, thread;
+  DWORD ret, code;
+
+  ready = CreateEventA(NULL, TRUE, FALSE, "wine_rpcrt4_server_ready");
+  ok(ready != NULL, "CreateEvent failed with error %u\n", GetLastError());
+
+  memset(&startup, 0, sizeof startup);
+  startup.cb = sizeof startup;
+  make_cmdline(cmdline, "ncalrpc_server");
+  ok(CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0L, NULL, NULL, &startup, &info), "CreateProcess\n");
+  ret = WaitForSingleObject(ready, 10000);
+  ok(ret == WAIT_OBJECT_0, "server didn't start\n");
+
+  if (ret == WAIT_OBJECT_0)
+  {
+    ok(RPC_S_OK == RpcStringBindingComposeA(NULL, ncalrpc, NULL, guid, NULL, &binding), "RpcStringBindingCompose\n");
+    ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
+    ok(int_return() == INT_CODE, "RPC int_return\n");
+
+    /* the call in flight fails instead of waiting for the reply forever */
+    thread = CreateThread(NULL, 0, exit_server_thread, NULL, 0, NULL);
+    ret = WaitForSingleObject(thread, 10000);
+    ok(ret == WAIT_OBJECT_0, "exit_server didn't return\n");
+    if (ret == WAIT_OBJECT_0)
+    {
+      GetExitCodeThread(thread, &code);
+      ok(code == RPC_S_CALL_FAILED, "exit_server got %u\n", code);
+    }
+    CloseHandle(thread);
+
+    ok(RPC_S_OK == RpcStringFreeA(&binding), "RpcStringFree\n");
+    ok(RPC_S_OK == RpcBindingFree(&IServer_IfHandle), "RpcBindingFree\n");
+  }
+
+  winetest_wait_child_process( info.hProcess );
+  ok(CloseHandle(info.hProcess), "CloseHandle\n");
+  ok(CloseHandle(info.hThread), "CloseHandle\n");
+  CloseHandle(ready);
+}
+
 static void
 client(const char *test)
 {
@@ -1645,6 +1870,7 @@ client(const char *test)
     ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
 
     run_tests(); /* can cause RPC_X_BAD_STUB_DATA exception */
+    large_array_test();
     authinfo_test(RPC_PROTSEQ_LRPC, 0);
     test_is_server_listening(IServer_IfHandle, RPC_S_OK);
 
@@ -1663,6 +1889,27 @@ client(const char *test)
     ok(RPC_S_OK == RpcStringFreeA(&binding), "RpcStringFree\n");
     ok(RPC_S_OK == RpcBindingFree(&IServer_IfHandle), "RpcBindingFree\n");
   }
+  else if (strcmp(test, "ncalrpc_fallback") == 0)
+  {
+    if (strcmp(winetest_platform, "wine"))
+      skip("shared memory for ncalrpc is a Wine extension\n");
+    else
+      lrpc_fallback_test();
+  }
+  else if (strcmp(test, "ncalrpc_server") == 0)
+  {
+    static unsigned char guid_exit[] = "00000000-4114-0704-2301-000000000001";
+    HANDLE ready = OpenEventA(EVENT_MODIFY_STATE, FALSE, "wine_rpcrt4_server_ready");
+
+    /* serve on another endpoint until the client calls exit_server */
+    ok(RPC_S_OK == RpcServerUseProtseqEpA(ncalrpc, 0, guid_exit, NULL), "RpcServerUseProtseqEp\n");
+    ok(RPC_S_OK == RpcServerRegisterIf(s_IServer_v0_0_s_ifspec, NULL, NULL), "RpcServerRegisterIf\n");
+    ok(RPC_S_OK == RpcServerListen(1, 20, TRUE), "RpcServerListen\n");
+    ok(SetEvent(ready), "SetEvent\n");
+    Sleep(30000);
+    ok(0, "exit_server wasn't called\n");
+    CloseHandle(ready);
+  }
   else if (strcmp(test, "np_basic") == 0)
   {
     ok(RPC_S_OK == RpcStringBindingComposeA(NULL, np, address_np, pipe, NULL, &binding), "RpcStringBindingCompose\n");
@@ -1732,6 +1979,9 @@ server(void)
 
     /* we don't need to register RPC_C_AUTHN_WINNT for ncalrpc */
     run_client("ncalrpc_secure");
+
+    run_client("ncalrpc_fallback");
+    server_exit_test();
   }
   else
     skip("lrpc tests skipped due to earlier failure\n");
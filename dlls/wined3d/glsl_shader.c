@@ -42,6 +42,7 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
 WINE_DECLARE_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 #define WINED3D_GLSL_SAMPLE_PROJECTED   0x01
@@ -113,6 +114,32 @@ struct constant_heap
     unsigned int size;
 };
 
+#define WINED3D_GLSL_CACHE_MAGIC    0x4c534757 /* "WGSL" */
+#define WINED3D_GLSL_CACHE_VERSION  1
+#define WINED3D_GLSL_CACHE_MAX_SIZE (64 * 1024 * 1024)
+
+/* On-disk cache of linked GLSL program binaries. Entries are keyed by a hash
+ * of the driver identity, the source of the attached shader objects and the
+ * link-time program parameters. */
+struct glsl_program_cache
+{
+    char *path;
+    UINT64 driver_hash;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int rejects;
+    unsigned int stores;
+};
+
+struct glsl_program_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    UINT64 key;
+    GLenum format;
+    DWORD size;
+};
+
 /* GLSL shader private data */
 struct shader_glsl_priv {
     struct wined3d_string_buffer shader_buffer;
@@ -129,6 +156,8 @@ struct shader_glsl_priv {
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct glsl_program_cache program_cache;
 };
 
 struct glsl_vs_program
@@ -226,6 +255,16 @@ struct glsl_program_key
     GLuint ps_id;
 };
 
+/* Program state that is set before linking and not reflected in the shader
+ * sources. */
+struct glsl_program_link_args
+{
+    DWORD attribs_map;
+    DWORD gs_input_type;
+    DWORD gs_output_type;
+    DWORD gs_vertices_out;
+};
+
 struct shader_glsl_ctx_priv {
     const struct vs_compile_args    *cur_vs_args;
     const struct ps_compile_args    *cur_ps_args;
@@ -550,6 +589,315 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+static UINT64 glsl_program_cache_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *ptr = data;
+
+    /* 64-bit FNV-1a. */
+    while (size--)
+    {
+        hash ^= *ptr++;
+        hash *= 0x00000100000001b3ull;
+    }
+
+    return hash;
+}
+
+static int glsl_program_cache_hash_compare(const void *a, const void *b)
+{
+    UINT64 hash_a = *(const UINT64 *)a, hash_b = *(const UINT64 *)b;
+
+    return hash_a < hash_b ? -1 : hash_a > hash_b;
+}
+
+static BOOL shader_glsl_create_cache_directory(char *path)
+{
+    DWORD attributes;
+    char *p, c;
+
+    /* Create the parent directories first, skipping the drive root. */
+    for (p = path + 1; *p; ++p)
+    {
+        if ((*p != '\\' && *p != '/') || p[-1] == ':')
+            continue;
+        c = *p;
+        *p = 0;
+        CreateDirectoryA(path, NULL);
+        *p = c;
+    }
+    CreateDirectoryA(path, NULL);
+
+    attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+static void shader_glsl_init_program_cache(struct glsl_program_cache *cache, const struct wined3d_gl_info *gl_info)
+{
+    static const char default_path[] = "%USERPROFILE%\\Local Settings\\Application Data\\wine\\wined3d\\shader_cache";
+    char path[MAX_PATH];
+    DWORD len;
+
+    memset(cache, 0, sizeof(*cache));
+
+    if (!wined3d_settings.shader_cache)
+        return;
+    if (!gl_info->supported[ARB_GET_PROGRAM_BINARY])
+    {
+        TRACE("ARB_get_program_binary not supported, not using the program cache.\n");
+        return;
+    }
+
+    len = ExpandEnvironmentStringsA(wined3d_settings.shader_cache_path
+            ? wined3d_settings.shader_cache_path : default_path, path, sizeof(path));
+    if (!len || len > sizeof(path) - 32 || strchr(path, '%'))
+    {
+        WARN("Invalid shader cache path %s.\n", debugstr_a(path));
+        return;
+    }
+
+    if (!shader_glsl_create_cache_directory(path))
+    {
+        WARN("Failed to create shader cache directory %s.\n", debugstr_a(path));
+        return;
+    }
+
+    if (!(cache->path = HeapAlloc(GetProcessHeap(), 0, len)))
+    {
+        ERR("Failed to allocate shader cache path memory.\n");
+        return;
+    }
+    memcpy(cache->path, path, len);
+
+    TRACE("Using shader cache directory %s.\n", debugstr_a(cache->path));
+}
+
+static void shader_glsl_free_program_cache(struct glsl_program_cache *cache)
+{
+    if (!cache->path)
+        return;
+
+    TRACE_(d3d_perf)("GLSL program cache: %u hits, %u misses, %u rejected, %u stored.\n",
+            cache->hits, cache->misses, cache->rejects, cache->stores);
+    HeapFree(GetProcessHeap(), 0, cache->path);
+    cache->path = NULL;
+}
+
+/* Context activation is done by the caller. */
+static UINT64 shader_glsl_program_cache_key(const struct wined3d_gl_info *gl_info,
+        struct glsl_program_cache *cache, GLuint program_id, const struct glsl_program_link_args *args)
+{
+    GLint i, shader_count, length, source_size = 0;
+    UINT64 key, *shader_hashes;
+    char *source = NULL;
+    GLuint *shaders;
+
+    if (!cache->driver_hash)
+    {
+        static const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+        DWORD ptr_size = sizeof(void *);
+        const char *str;
+        unsigned int j;
+
+        key = 0xcbf29ce484222325ull;
+        for (j = 0; j < sizeof(names) / sizeof(*names); ++j)
+        {
+            if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(names[j])))
+                key = glsl_program_cache_hash(key, str, strlen(str) + 1);
+        }
+        cache->driver_hash = glsl_program_cache_hash(key, &ptr_size, sizeof(ptr_size));
+    }
+
+    key = glsl_program_cache_hash(cache->driver_hash, args, sizeof(*args));
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_ATTACHED_SHADERS, &shader_count));
+    if (!(shader_hashes = wined3d_calloc(shader_count, sizeof(*shader_hashes) + sizeof(*shaders))))
+        return 0;
+    shaders = (GLuint *)(shader_hashes + shader_count);
+    GL_EXTCALL(glGetAttachedShaders(program_id, shader_count, NULL, shaders));
+
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (length > source_size)
+        {
+            HeapFree(GetProcessHeap(), 0, source);
+            if (!(source = HeapAlloc(GetProcessHeap(), 0, length)))
+            {
+                HeapFree(GetProcessHeap(), 0, shader_hashes);
+                return 0;
+            }
+            source_size = length;
+        }
+        length = 0;
+        if (source_size)
+            GL_EXTCALL(glGetShaderSource(shaders[i], source_size, &length, source));
+        shader_hashes[i] = glsl_program_cache_hash(0xcbf29ce484222325ull, source, length);
+    }
+    checkGLcall("get shader sources");
+
+    /* The order in which attached shaders are returned is up to the driver. */
+    qsort(shader_hashes, shader_count, sizeof(*shader_hashes), glsl_program_cache_hash_compare);
+    key = glsl_program_cache_hash(key, shader_hashes, shader_count * sizeof(*shader_hashes));
+
+    HeapFree(GetProcessHeap(), 0, source);
+    HeapFree(GetProcessHeap(), 0, shader_hashes);
+
+    return key;
+}
+
+static void shader_glsl_program_cache_filename(const struct glsl_program_cache *cache,
+        UINT64 key, char *filename, const char *suffix)
+{
+    sprintf(filename, "%s\\%08x%08x%s", cache->path, (DWORD)(key >> 32), (DWORD)key, suffix);
+}
+
+static void *shader_glsl_program_cache_load(const struct glsl_program_cache *cache,
+        UINT64 key, GLenum *format, DWORD *size)
+{
+    struct glsl_program_cache_header header;
+    char filename[MAX_PATH];
+    void *data = NULL;
+    HANDLE file;
+    DWORD count;
+
+    shader_glsl_program_cache_filename(cache, key, filename, ".bin");
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (ReadFile(file, &header, sizeof(header), &count, NULL) && count == sizeof(header)
+            && header.magic == WINED3D_GLSL_CACHE_MAGIC && header.version == WINED3D_GLSL_CACHE_VERSION
+            && header.key == key && header.size && header.size <= WINED3D_GLSL_CACHE_MAX_SIZE
+            && (data = HeapAlloc(GetProcessHeap(), 0, header.size)))
+    {
+        if (!ReadFile(file, data, header.size, &count, NULL) || count != header.size)
+        {
+            WARN("Truncated shader cache entry %s.\n", debugstr_a(filename));
+            HeapFree(GetProcessHeap(), 0, data);
+            data = NULL;
+        }
+    }
+    CloseHandle(file);
+
+    if (data)
+    {
+        *format = header.format;
+        *size = header.size;
+    }
+    return data;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_program_cache_store(const struct wined3d_gl_info *gl_info,
+        struct glsl_program_cache *cache, UINT64 key, GLuint program_id)
+{
+    struct glsl_program_cache_header header;
+    char filename[MAX_PATH], tmp_filename[MAX_PATH], suffix[16];
+    GLint length = 0;
+    GLsizei size = 0;
+    GLenum format;
+    HANDLE file;
+    DWORD count;
+    void *data;
+    BOOL ret;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0 || length > WINED3D_GLSL_CACHE_MAX_SIZE)
+        return;
+    if (!(data = HeapAlloc(GetProcessHeap(), 0, length)))
+        return;
+    GL_EXTCALL(glGetProgramBinary(program_id, length, &size, &format, data));
+    checkGLcall("glGetProgramBinary");
+    if (size <= 0)
+    {
+        HeapFree(GetProcessHeap(), 0, data);
+        return;
+    }
+
+    header.magic = WINED3D_GLSL_CACHE_MAGIC;
+    header.version = WINED3D_GLSL_CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.size = size;
+
+    /* Write to a temporary file first, so that other processes never see a
+     * partially written entry. */
+    sprintf(suffix, ".%x.tmp", GetCurrentProcessId());
+    shader_glsl_program_cache_filename(cache, key, tmp_filename, suffix);
+    shader_glsl_program_cache_filename(cache, key, filename, ".bin");
+    file = CreateFileA(tmp_filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create shader cache entry %s, error %u.\n", debugstr_a(tmp_filename), GetLastError());
+        HeapFree(GetProcessHeap(), 0, data);
+        return;
+    }
+    ret = WriteFile(file, &header, sizeof(header), &count, NULL) && count == sizeof(header)
+            && WriteFile(file, data, size, &count, NULL) && count == size;
+    CloseHandle(file);
+    HeapFree(GetProcessHeap(), 0, data);
+
+    if (ret && MoveFileExA(tmp_filename, filename, MOVEFILE_REPLACE_EXISTING))
+    {
+        ++cache->stores;
+        return;
+    }
+
+    WARN("Failed to write shader cache entry %s, error %u.\n", debugstr_a(filename), GetLastError());
+    DeleteFileA(tmp_filename);
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv,
+        GLuint program_id, const struct glsl_program_link_args *args)
+{
+    struct glsl_program_cache *cache = &priv->program_cache;
+    GLint status = GL_FALSE;
+    GLenum format;
+    DWORD size;
+    UINT64 key;
+    void *data;
+
+    if (!cache->path || !(key = shader_glsl_program_cache_key(gl_info, cache, program_id, args)))
+    {
+        TRACE("Linking GLSL shader program %u.\n", program_id);
+        GL_EXTCALL(glLinkProgram(program_id));
+        shader_glsl_validate_link(gl_info, program_id);
+        return;
+    }
+
+    if ((data = shader_glsl_program_cache_load(cache, key, &format, &size)))
+    {
+        TRACE("Loading GLSL shader program %u from cache entry %s.\n", program_id, wine_dbgstr_longlong(key));
+        GL_EXTCALL(glProgramBinary(program_id, format, data, size));
+        HeapFree(GetProcessHeap(), 0, data);
+        GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+        if (status)
+        {
+            checkGLcall("glProgramBinary");
+            ++cache->hits;
+            return;
+        }
+
+        /* Typically the result of a driver update. Swallow the error and
+         * relink from source; the stale entry gets overwritten below. */
+        WARN("Driver rejected cache entry %s for program %u.\n", wine_dbgstr_longlong(key), program_id);
+        gl_info->gl_ops.gl.p_glGetError();
+        ++cache->rejects;
+    }
+
+    ++cache->misses;
+    GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    TRACE("Linking GLSL shader program %u.\n", program_id);
+    GL_EXTCALL(glLinkProgram(program_id));
+    shader_glsl_validate_link(gl_info, program_id);
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    if (status)
+        shader_glsl_program_cache_store(gl_info, cache, key, program_id);
+}
+
 /* Context activation is done by the caller. */
 static void shader_glsl_load_samplers(const struct wined3d_gl_info *gl_info,
         struct shader_glsl_priv *priv, const DWORD *tex_unit_map, GLuint program_id)
@@ -7991,6 +8339,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     struct list *ps_list, *vs_list;
     WORD attribs_map;
     struct wined3d_string_buffer *tmp_name;
+    struct glsl_program_link_args link_args;
 
     if (!(context->shader_update_mask & (1u << WINED3D_SHADER_TYPE_VERTEX)) && ctx_data->glsl_program)
     {
@@ -8135,6 +8484,9 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         attribs_map = (1u << WINED3D_FFP_ATTRIBS_COUNT) - 1;
     }
 
+    memset(&link_args, 0, sizeof(link_args));
+    link_args.attribs_map = attribs_map;
+
     if (!shader_glsl_use_explicit_attrib_location(gl_info))
     {
         /* Bind vertex attributes to a corresponding index number to match
@@ -8185,6 +8537,10 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
             GL_EXTCALL(glProgramParameteriARB(program_id, GL_GEOMETRY_VERTICES_OUT_ARB,
                     gshader->u.gs.vertices_out));
             checkGLcall("glProgramParameteriARB");
+
+            link_args.gs_input_type = gshader->u.gs.input_type;
+            link_args.gs_output_type = gshader->u.gs.output_type;
+            link_args.gs_vertices_out = gshader->u.gs.vertices_out;
         }
 
         list_add_head(&gshader->linked_programs, &entry->gs.shader_entry);
@@ -8201,9 +8557,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     }
 
     /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, priv, program_id, &link_args);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -8655,6 +9009,7 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     }
 
     wine_rb_init(&priv->program_lookup, glsl_program_key_compare);
+    shader_glsl_init_program_cache(&priv->program_cache, gl_info);
 
     priv->next_constant_version = 1;
     priv->vertex_pipe = vertex_pipe;
@@ -8686,6 +9041,7 @@ static void shader_glsl_free(struct wined3d_device *device)
     struct shader_glsl_priv *priv = device->shader_priv;
 
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
+    shader_glsl_free_program_cache(&priv->program_cache);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
     HeapFree(GetProcessHeap(), 0, priv->stack);
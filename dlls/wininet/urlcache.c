@@ -46,6 +46,7 @@
 #include "internet.h"
 
 #include "wine/unicode.h"
+#include "wine/exception.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(wininet);
@@ -160,7 +161,7 @@ typedef struct
     DWORD hash_table_off;
     DWORD capacity_in_blocks;
     DWORD blocks_in_use;
-    DWORD unk1;
+    DWORD seq; /* incremented on lock and unlock, odd while the index is being modified */
     ULARGE_INTEGER cache_limit;
     ULARGE_INTEGER cache_usage;
     ULARGE_INTEGER exempt_usage;
@@ -189,6 +190,9 @@ typedef struct
     DWORD file_size; /* size of file when mapping was opened */
     HANDLE mutex; /* handle of mutex */
     DWORD default_entry_type;
+    SRWLOCK view_lock; /* protects view against unmapping by another thread */
+    const urlcache_header *view; /* read-only view used for lookups without the mutex */
+    DWORD view_size;
 } cache_container;
 
 typedef struct
@@ -684,10 +688,34 @@ static DWORD cache_container_open_index(cache_container *container, DWORD blocks
  */
 static void cache_container_close_index(cache_container *pContainer)
 {
+    AcquireSRWLockExclusive(&pContainer->view_lock);
+    if (pContainer->view)
+        UnmapViewOfFile(pContainer->view);
+    pContainer->view = NULL;
+    pContainer->view_size = 0;
+    ReleaseSRWLockExclusive(&pContainer->view_lock);
+
     CloseHandle(pContainer->mapping);
     pContainer->mapping = NULL;
 }
 
+/* Caller must hold container lock */
+static void cache_container_map_view(cache_container *container)
+{
+    const urlcache_header *view;
+
+    if (container->view)
+        return;
+
+    if (!(view = MapViewOfFile(container->mapping, FILE_MAP_READ, 0, 0, 0)))
+        return;
+
+    AcquireSRWLockExclusive(&container->view_lock);
+    container->view = view;
+    container->view_size = container->file_size;
+    ReleaseSRWLockExclusive(&container->view_lock);
+}
+
 static BOOL cache_containers_add(const char *cache_prefix, LPCWSTR path,
         DWORD default_entry_type, LPWSTR mutex_name)
 {
@@ -702,6 +730,9 @@ static BOOL cache_containers_add(const char *cache_prefix, LPCWSTR path,
     pContainer->mapping = NULL;
     pContainer->file_size = 0;
     pContainer->default_entry_type = default_entry_type;
+    InitializeSRWLock(&pContainer->view_lock);
+    pContainer->view = NULL;
+    pContainer->view_size = 0;
 
     pContainer->path = heap_strdupW(path);
     if (!pContainer->path)
@@ -940,6 +971,13 @@ static urlcache_header* cache_container_lock_index(cache_container *pContainer)
         pHeader = (urlcache_header*)pIndexData;
     }
 
+    /* odd counter tells lockless readers the index is being modified; it may be
+     * odd already if previous owner died while holding the lock */
+    if (!(InterlockedIncrement((LONG *)&pHeader->seq) & 1))
+        InterlockedIncrement((LONG *)&pHeader->seq);
+
+    cache_container_map_view(pContainer);
+
     TRACE("Signature: %s, file size: %d bytes\n", pHeader->signature, pHeader->size);
 
     for (index = 0; index < pHeader->dirs_no; index++)
@@ -956,6 +994,8 @@ static urlcache_header* cache_container_lock_index(cache_container *pContainer)
  */
 static BOOL cache_container_unlock_index(cache_container *pContainer, urlcache_header *pHeader)
 {
+    InterlockedIncrement((LONG *)&pHeader->seq);
+
     /* release mutex */
     ReleaseMutex(pContainer->mutex);
     return UnmapViewOfFile(pHeader);
@@ -1522,6 +1562,10 @@ static BOOL urlcache_find_hash_entry(const urlcache_header *pHeader, LPCSTR lpsz
          pHashEntry; pHashEntry = urlcache_get_hash_table(pHeader, pHashEntry->next))
     {
         int i;
+
+        /* chain can't be longer than that, unless it's broken or being modified */
+        if (id >= MAX_BLOCK_NO)
+            break;
         if (pHashEntry->id != id++)
         {
             ERR("Error: not right hash table number (%d) expected %d\n", pHashEntry->id, id);
@@ -1771,12 +1815,96 @@ static BOOL urlcache_hash_entry_is_locked(struct hash_entry *hash_entry, entry_u
     return TRUE;
 }
 
+static DWORD urlcache_find_entry_info(cache_container *container, const urlcache_header *header,
+        const char *url, void *entry_info, DWORD *size, DWORD flags, BOOL unicode)
+{
+    struct hash_entry *hash_entry;
+    const entry_url *url_entry;
+    DWORD error;
+
+    if(!urlcache_find_hash_entry(header, url, &hash_entry)) {
+        WARN("entry %s not found!\n", debugstr_a(url));
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    url_entry = (const entry_url*)((LPBYTE)header + hash_entry->offset);
+    if(url_entry->header.signature != URL_SIGNATURE) {
+        FIXME("Trying to retrieve entry of unknown format %s\n",
+                debugstr_an((LPCSTR)&url_entry->header.signature, sizeof(DWORD)));
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    TRACE("Found URL: %s\n", debugstr_a((LPCSTR)url_entry + url_entry->url_off));
+    TRACE("Header info: %s\n", debugstr_an((LPCSTR)url_entry +
+                url_entry->header_info_off, url_entry->header_info_size));
+
+    if((flags & GET_INSTALLED_ENTRY) && !(url_entry->cache_entry_type & INSTALLED_CACHE_ENTRY))
+        return ERROR_FILE_NOT_FOUND;
+
+    if(size) {
+        if(!entry_info)
+            *size = 0;
+
+        error = urlcache_copy_entry(container, header, entry_info, size, url_entry, unicode);
+        if(error != ERROR_SUCCESS)
+            return error;
+        if(url_entry->local_name_off)
+            TRACE("Local File Name: %s\n", debugstr_a((LPCSTR)url_entry + url_entry->local_name_off));
+    }
+
+    return ERROR_SUCCESS;
+}
+
+static inline void urlcache_memory_barrier(void)
+{
+    LONG dummy = 0;
+    InterlockedExchange(&dummy, 1);
+}
+
+/* Looks the entry up in a read-only view without taking the mutex, which is shared
+ * by all processes using the cache. Index may be modified by another process meanwhile,
+ * that's detected by a change of header sequence counter, the result is thrown away
+ * in such case and FALSE is returned, so the caller has to repeat it with mutex held. */
+static BOOL urlcache_find_entry_info_lockless(cache_container *container, const char *url,
+        void *entry_info, DWORD *size, DWORD flags, BOOL unicode, DWORD *error)
+{
+    const urlcache_header *header;
+    DWORD seq, orig_size = size ? *size : 0;
+    BOOL ret = FALSE;
+
+    AcquireSRWLockShared(&container->view_lock);
+
+    header = container->view;
+    if(header && header->size == container->view_size) {
+        seq = *(volatile const DWORD *)&header->seq;
+        urlcache_memory_barrier();
+
+        if(!(seq & 1)) {
+            __TRY
+            {
+                *error = urlcache_find_entry_info(container, header, url, entry_info, size, flags, unicode);
+                urlcache_memory_barrier();
+                ret = *(volatile const DWORD *)&header->seq == seq;
+            }
+            __EXCEPT_PAGE_FAULT
+            {
+                ret = FALSE;
+            }
+            __ENDTRY
+        }
+    }
+
+    ReleaseSRWLockShared(&container->view_lock);
+
+    if(!ret && size)
+        *size = orig_size;
+    return ret;
+}
+
 static BOOL urlcache_get_entry_info(const char *url, void *entry_info,
         DWORD *size, DWORD flags, BOOL unicode)
 {
     urlcache_header *header;
-    struct hash_entry *hash_entry;
-    const entry_url *url_entry;
     cache_container *container;
     DWORD error;
 
@@ -1797,50 +1925,18 @@ static BOOL urlcache_get_entry_info(const char *url, void *entry_info,
         return FALSE;
     }
 
-    if(!(header = cache_container_lock_index(container)))
-        return FALSE;
-
-    if(!urlcache_find_hash_entry(header, url, &hash_entry)) {
-        cache_container_unlock_index(container, header);
-        WARN("entry %s not found!\n", debugstr_a(url));
-        SetLastError(ERROR_FILE_NOT_FOUND);
-        return FALSE;
-    }
+    if(!urlcache_find_entry_info_lockless(container, url, entry_info, size, flags, unicode, &error)) {
+        if(!(header = cache_container_lock_index(container)))
+            return FALSE;
 
-    url_entry = (const entry_url*)((LPBYTE)header + hash_entry->offset);
-    if(url_entry->header.signature != URL_SIGNATURE) {
+        error = urlcache_find_entry_info(container, header, url, entry_info, size, flags, unicode);
         cache_container_unlock_index(container, header);
-        FIXME("Trying to retrieve entry of unknown format %s\n",
-                debugstr_an((LPCSTR)&url_entry->header.signature, sizeof(DWORD)));
-        SetLastError(ERROR_FILE_NOT_FOUND);
-        return FALSE;
     }
 
-    TRACE("Found URL: %s\n", debugstr_a((LPCSTR)url_entry + url_entry->url_off));
-    TRACE("Header info: %s\n", debugstr_an((LPCSTR)url_entry +
-                url_entry->header_info_off, url_entry->header_info_size));
-
-    if((flags & GET_INSTALLED_ENTRY) && !(url_entry->cache_entry_type & INSTALLED_CACHE_ENTRY)) {
-        cache_container_unlock_index(container, header);
-        SetLastError(ERROR_FILE_NOT_FOUND);
+    if(error != ERROR_SUCCESS) {
+        SetLastError(error);
         return FALSE;
     }
-
-    if(size) {
-        if(!entry_info)
-            *size = 0;
-
-        error = urlcache_copy_entry(container, header, entry_info, size, url_entry, unicode);
-        if(error != ERROR_SUCCESS) {
-            cache_container_unlock_index(container, header);
-            SetLastError(error);
-            return FALSE;
-        }
-        if(url_entry->local_name_off)
-            TRACE("Local File Name: %s\n", debugstr_a((LPCSTR)url_entry + url_entry->local_name_off));
-    }
-
-    cache_container_unlock_index(container, header);
     return TRUE;
 }
 
@@ -926,15 +926,44 @@ static void readerinput_shrinkraw(xmlreaderinput *readerinput, int len)
     buffer->cur = 0;
 }
 
+/* converts len bytes of raw data to UTF-16 and appends them to the UTF-16 buffer */
+static void readerinput_convert(xmlreaderinput *readerinput, UINT cp, const char *data, int len)
+{
+    encoded_buffer *dest = &readerinput->buffer->utf16;
+    int dest_len, i;
+    WCHAR *ptr;
+
+    if (cp == CP_UTF8)
+    {
+        /* UTF-8 never needs more WCHARs than bytes, and ASCII runs map one to one,
+           so most documents are converted in a single pass without sizing them first */
+        readerinput_grow(readerinput, len);
+        ptr = (WCHAR*)(dest->data + dest->written);
+        for (i = 0; i < len && !(data[i] & 0x80); i++)
+            ptr[i] = data[i];
+        dest_len = i;
+        if (i < len)
+            dest_len += MultiByteToWideChar(cp, 0, data + i, len - i, ptr + i, len - i);
+    }
+    else
+    {
+        dest_len = MultiByteToWideChar(cp, 0, data, len, NULL, 0);
+        readerinput_grow(readerinput, dest_len);
+        ptr = (WCHAR*)(dest->data + dest->written);
+        MultiByteToWideChar(cp, 0, data, len, ptr, dest_len);
+    }
+    ptr[dest_len] = 0;
+    dest->written += dest_len*sizeof(WCHAR);
+}
+
 /* note that raw buffer content is kept */
 static void readerinput_switchencoding(xmlreaderinput *readerinput, xml_encoding enc)
 {
     encoded_buffer *src = &readerinput->buffer->encoded;
     encoded_buffer *dest = &readerinput->buffer->utf16;
-    int len, dest_len;
     HRESULT hr;
-    WCHAR *ptr;
     UINT cp;
+    int len;
 
     hr = get_code_page(enc, &cp);
     if (FAILED(hr)) return;
@@ -953,12 +982,7 @@ static void readerinput_switchencoding(xmlreaderinput *readerinput, xml_encoding
         return;
     }
 
-    dest_len = MultiByteToWideChar(cp, 0, src->data + src->cur, len, NULL, 0);
-    readerinput_grow(readerinput, dest_len);
-    ptr = (WCHAR*)dest->data;
-    MultiByteToWideChar(cp, 0, src->data + src->cur, len, ptr, dest_len);
-    ptr[dest_len] = 0;
-    dest->written += dest_len*sizeof(WCHAR);
+    readerinput_convert(readerinput, cp, src->data + src->cur, len);
 }
 
 /* shrinks parsed data a buffer begins with */
@@ -984,9 +1008,8 @@ static HRESULT reader_more(xmlreader *reader)
     encoded_buffer *src = &readerinput->buffer->encoded;
     encoded_buffer *dest = &readerinput->buffer->utf16;
     UINT cp = readerinput->buffer->code_page;
-    int len, dest_len;
     HRESULT hr;
-    WCHAR *ptr;
+    int len;
 
     /* get some raw data from stream first */
     hr = readerinput_growraw(readerinput);
@@ -1001,12 +1024,7 @@ static HRESULT reader_more(xmlreader *reader)
         return hr;
     }
 
-    dest_len = MultiByteToWideChar(cp, 0, src->data + src->cur, len, NULL, 0);
-    readerinput_grow(readerinput, dest_len);
-    ptr = (WCHAR*)(dest->data + dest->written);
-    MultiByteToWideChar(cp, 0, src->data + src->cur, len, ptr, dest_len);
-    ptr[dest_len] = 0;
-    dest->written += dest_len*sizeof(WCHAR);
+    readerinput_convert(readerinput, cp, src->data + src->cur, len);
     /* get rid of processed data */
     readerinput_shrinkraw(readerinput, len);
 
@@ -1057,6 +1075,46 @@ static void reader_skipn(xmlreader *reader, int n)
     }
 }
 
+/* moves cursor n WCHARs forward, caller guarantees they are already in the buffer */
+static inline void reader_skipn_scanned(xmlreader *reader, UINT n)
+{
+    reader->input->buffer->utf16.cur += n;
+    reader->pos += n;
+}
+
+#define WCHAR4_ONES  ((ULONGLONG)0x0001000100010001)
+#define WCHAR4_HIGHS ((ULONGLONG)0x8000800080008000)
+
+/* nonzero if any of four WCHARs packed in 'v' is zero */
+static inline ULONGLONG wchar4_haszero(ULONGLONG v)
+{
+    return (v - WCHAR4_ONES) & ~v & WCHAR4_HIGHS;
+}
+
+/* Returns a pointer to the first char that is either a terminating null or one of
+   the two delimiters. Four chars are tested at once where possible; an aligned word
+   holding the terminator never crosses a page boundary, so it's safe to read. */
+static const WCHAR *reader_scan_delims(const WCHAR *ptr, WCHAR delim1, WCHAR delim2)
+{
+    ULONGLONG d1 = delim1 * WCHAR4_ONES, d2 = delim2 * WCHAR4_ONES;
+
+    while ((ULONG_PTR)ptr & (sizeof(ULONGLONG) - 1))
+    {
+        if (!*ptr || *ptr == delim1 || *ptr == delim2) return ptr;
+        ptr++;
+    }
+
+    for (;;)
+    {
+        ULONGLONG v = *(const ULONGLONG *)ptr;
+        if (wchar4_haszero(v) || wchar4_haszero(v ^ d1) || wchar4_haszero(v ^ d2)) break;
+        ptr += 4;
+    }
+
+    while (*ptr && *ptr != delim1 && *ptr != delim2) ptr++;
+    return ptr;
+}
+
 static inline BOOL is_wchar_space(WCHAR ch)
 {
     return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
@@ -1344,6 +1402,15 @@ static HRESULT reader_parse_comment(xmlreader *reader)
        read more from stream */
     while (*ptr)
     {
+        const WCHAR *end = reader_scan_delims(ptr, '-', '-');
+
+        if (end != ptr)
+        {
+            reader_skipn_scanned(reader, end - ptr);
+            ptr += end - ptr;
+            continue;
+        }
+
         if (ptr[0] == '-')
         {
             if (ptr[1] == '-')
@@ -2124,6 +2191,14 @@ static HRESULT reader_parse_attvalue(xmlreader *reader, strval *value)
             HRESULT hr = reader_parse_reference(reader);
             if (FAILED(hr)) return hr;
         }
+        else if (!is_wchar_space(*ptr))
+        {
+            const WCHAR *end = ptr + 1;
+
+            while (*end && *end != quote && *end != '<' && *end != '&' && !is_wchar_space(*end))
+                end++;
+            reader_skipn_scanned(reader, end - ptr);
+        }
         else
         {
             reader_normalize_space(reader, ptr);
@@ -2321,6 +2396,15 @@ static HRESULT reader_parse_cdata(xmlreader *reader)
 
     while (*ptr)
     {
+        const WCHAR *end = reader_scan_delims(ptr, ']', '\r');
+
+        if (end != ptr)
+        {
+            reader_skipn_scanned(reader, end - ptr);
+            ptr += end - ptr;
+            continue;
+        }
+
         if (*ptr == ']' && *(ptr+1) == ']' && *(ptr+2) == '>')
         {
             strval value;
@@ -2382,6 +2466,22 @@ static HRESULT reader_parse_chardata(xmlreader *reader)
 
     while (*ptr)
     {
+        const WCHAR *end = reader_scan_delims(ptr, '<', ']');
+
+        if (end != ptr)
+        {
+            /* this covers a case when text has leading whitespace chars */
+            if (reader->nodetype == XmlNodeType_Whitespace)
+            {
+                const WCHAR *p = ptr;
+                while (p != end && is_wchar_space(*p)) p++;
+                if (p != end) reader->nodetype = XmlNodeType_Text;
+            }
+            reader_skipn_scanned(reader, end - ptr);
+            ptr += end - ptr;
+            continue;
+        }
+
         /* CDATA closing sequence ']]>' is not allowed */
         if (ptr[0] == ']' && ptr[1] == ']' && ptr[2] == '>')
             return WC_E_CDSECTEND;
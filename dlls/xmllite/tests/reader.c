@@ -894,6 +894,8 @@ struct test_entry {
 static struct test_entry comment_tests[] = {
     { "<!-- comment -->", "", " comment ", S_OK },
     { "<!-- - comment-->", "", " - comment", S_OK },
+    { "<!-- a longer comment - with dashes - spanning several words -->", "",
+      " a longer comment - with dashes - spanning several words ", S_OK },
     { "<!-- -- comment-->", NULL, NULL, WC_E_COMMENT, WC_E_GREATERTHAN },
     { "<!-- -- comment--->", NULL, NULL, WC_E_COMMENT, WC_E_GREATERTHAN },
     { NULL }
@@ -1657,6 +1659,9 @@ static void test_read_cdata(void)
 static struct test_entry text_tests[] = {
     { "<a>simple text</a>", "", "simple text", S_OK },
     { "<a>text ]]> text</a>", "", "", WC_E_CDSECTEND },
+    { "<a>longer text with ] and ]] in it, spanning several words</a>", "",
+      "longer text with ] and ]] in it, spanning several words", S_OK },
+    { "<a> \t  leading whitespace before a longer text</a>", "", " \t  leading whitespace before a longer text", S_OK },
     { NULL }
 };
 
@@ -710,6 +710,17 @@ struct rawinput_device
 };
 
 
+#define REQUEST_PROFILE_BUCKETS 16
+struct request_profile
+{
+    unsigned int   req;
+    unsigned int   count;
+    timeout_t      time;
+    unsigned int   histogram[REQUEST_PROFILE_BUCKETS];
+    char           name[32];
+};
+
+
 
 
 
@@ -2055,6 +2066,21 @@ enum char_info_mode
 
 
 
+struct write_console_text_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    /* VARARG(data,unicode_str); */
+};
+struct write_console_text_reply
+{
+    struct reply_header __header;
+    data_size_t  written;
+    unsigned int bells;
+};
+
+
+
 struct fill_console_output_request
 {
     struct request_header __header;
@@ -2450,6 +2476,22 @@ struct write_process_memory_reply
 
 
 
+struct get_process_vm_access_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    unsigned int access;
+    char __pad_20[4];
+};
+struct get_process_vm_access_reply
+{
+    struct reply_header __header;
+    int          unix_pid;
+    char __pad_12[4];
+};
+
+
+
 struct create_key_request
 {
     struct request_header __header;
@@ -3353,6 +3395,8 @@ struct get_named_pipe_info_reply
     unsigned int   instances;
     unsigned int   outsize;
     unsigned int   insize;
+    process_id_t   client_pid;
+    process_id_t   server_pid;
 };
 
 
@@ -5547,6 +5591,27 @@ struct terminate_job_reply
 };
 
 
+
+struct get_request_profile_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+    unsigned int flags;
+    char __pad_20[4];
+};
+struct get_request_profile_reply
+{
+    struct reply_header __header;
+    timeout_t    start_time;
+    int          enabled;
+    /* VARARG(profiles,request_profiles); */
+    char __pad_20[4];
+};
+#define REQUEST_PROFILE_ENABLE  0x01
+#define REQUEST_PROFILE_DISABLE 0x02
+#define REQUEST_PROFILE_RESET   0x04
+
+
 enum request
 {
     REQ_new_process,
@@ -5623,6 +5688,7 @@ enum request
     REQ_write_console_input,
     REQ_read_console_input,
     REQ_write_console_output,
+    REQ_write_console_text,
     REQ_fill_console_output,
     REQ_read_console_output,
     REQ_move_console_output,
@@ -5646,6 +5712,7 @@ enum request
     REQ_set_debugger_kill_on_exit,
     REQ_read_process_memory,
     REQ_write_process_memory,
+    REQ_get_process_vm_access,
     REQ_create_key,
     REQ_open_key,
     REQ_delete_key,
@@ -5832,6 +5899,7 @@ enum request
     REQ_set_job_limits,
     REQ_set_job_completion_port,
     REQ_terminate_job,
+    REQ_get_request_profile,
     REQ_NB_REQUESTS
 };
 
@@ -5913,6 +5981,7 @@ union generic_request
     struct write_console_input_request write_console_input_request;
     struct read_console_input_request read_console_input_request;
     struct write_console_output_request write_console_output_request;
+    struct write_console_text_request write_console_text_request;
     struct fill_console_output_request fill_console_output_request;
     struct read_console_output_request read_console_output_request;
     struct move_console_output_request move_console_output_request;
@@ -5936,6 +6005,7 @@ union generic_request
     struct set_debugger_kill_on_exit_request set_debugger_kill_on_exit_request;
     struct read_process_memory_request read_process_memory_request;
     struct write_process_memory_request write_process_memory_request;
+    struct get_process_vm_access_request get_process_vm_access_request;
     struct create_key_request create_key_request;
     struct open_key_request open_key_request;
     struct delete_key_request delete_key_request;
@@ -6122,6 +6192,7 @@ union generic_request
     struct set_job_limits_request set_job_limits_request;
     struct set_job_completion_port_request set_job_completion_port_request;
     struct terminate_job_request terminate_job_request;
+    struct get_request_profile_request get_request_profile_request;
 };
 union generic_reply
 {
@@ -6201,6 +6272,7 @@ union generic_reply
     struct write_console_input_reply write_console_input_reply;
     struct read_console_input_reply read_console_input_reply;
     struct write_console_output_reply write_console_output_reply;
+    struct write_console_text_reply write_console_text_reply;
     struct fill_console_output_reply fill_console_output_reply;
     struct read_console_output_reply read_console_output_reply;
     struct move_console_output_reply move_console_output_reply;
@@ -6224,6 +6296,7 @@ union generic_reply
     struct set_debugger_kill_on_exit_reply set_debugger_kill_on_exit_reply;
     struct read_process_memory_reply read_process_memory_reply;
     struct write_process_memory_reply write_process_memory_reply;
+    struct get_process_vm_access_reply get_process_vm_access_reply;
     struct create_key_reply create_key_reply;
     struct open_key_reply open_key_reply;
     struct delete_key_reply delete_key_reply;
@@ -6410,8 +6483,9 @@ union generic_reply
     struct set_job_limits_reply set_job_limits_reply;
     struct set_job_completion_port_reply set_job_completion_port_reply;
     struct terminate_job_reply terminate_job_reply;
+    struct get_request_profile_reply get_request_profile_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 524
+#define SERVER_PROTOCOL_VERSION 528
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -26,6 +26,197 @@ extern struct env_stack *saved_environment;
 
 WINE_DEFAULT_DEBUG_CHANNEL(cmd);
 
+/* Batch files larger than this are read from the disk line by line */
+#define MAX_CACHED_BATCH_SIZE (16 * 1024 * 1024)
+
+typedef struct _BATCH_LABEL {
+  WCHAR *name;          /* Label name */
+  DWORD next_line;      /* Offset of the line following the label */
+} BATCH_LABEL;
+
+/* In-memory copy of a batch file, with an index of its labels */
+typedef struct _BATCH_FILE {
+  LONG refs;            /* Number of contexts using the file */
+  char *data;           /* Contents of the file */
+  DWORD size;
+  FILETIME write_time;  /* Last write time when the contents were read */
+  UINT cp;              /* Code page used to decode the labels */
+  BATCH_LABEL *labels;  /* Labels sorted by name, then by position */
+  DWORD nb_labels;
+} BATCH_FILE;
+
+/* Returns the end of the line starting at p, as WCMD_fgets splits lines */
+static const char *batch_line_end(const char *p, const char *end, UINT cp)
+{
+  for (; p < end; p = CharNextExA(cp, p, 0))
+    if (*p == '\n' || *p == '\r') break;
+  return p;
+}
+
+/* Returns the offset of the line following a line ending at p */
+static DWORD batch_next_line(const BATCH_FILE *file, const char *p)
+{
+  DWORD next = p - file->data + 1;
+  if (p < file->data + file->size && *p == '\r') next++;
+  return next;
+}
+
+/* If the line is a label, returns its name terminated in place */
+static WCHAR *batch_label_name(WCHAR *str)
+{
+  static const WCHAR labelEndsW[] = {'>','<','|','&',' ',':','\t','\0'};
+  WCHAR *labelend;
+
+  /* Ignore leading whitespace or no-echo character */
+  while (*str=='@' || isspaceW (*str)) str++;
+
+  /* If the first real character is a : then this is a label */
+  if (*str != ':') return NULL;
+  str++;
+
+  /* Skip spaces between : and label */
+  while (isspaceW (*str)) str++;
+
+  /* Label ends at whitespace or redirection characters */
+  labelend = strpbrkW(str, labelEndsW);
+  if (labelend) *labelend = 0x00;
+  return str;
+}
+
+static int batch_label_cmp(const void *p1, const void *p2)
+{
+  const BATCH_LABEL *l1 = p1, *l2 = p2;
+  int ret = lstrcmpiW(l1->name, l2->name);
+
+  if (ret) return ret;
+  return l1->next_line < l2->next_line ? -1 : l1->next_line > l2->next_line;
+}
+
+static void batch_free_labels(BATCH_FILE *file)
+{
+  DWORD i;
+
+  for (i = 0; i < file->nb_labels; i++) heap_free(file->labels[i].name);
+  heap_free(file->labels);
+  file->labels = NULL;
+  file->nb_labels = 0;
+}
+
+/* Builds the sorted label table of a file with the current code page */
+static void batch_index_labels(BATCH_FILE *file)
+{
+  const char *p, *end = file->data + file->size, *line_end;
+  DWORD pos, alloc = 0;
+  WCHAR *line, *name;
+  int len;
+
+  batch_free_labels(file);
+  file->cp = GetConsoleCP();
+  for (pos = 0; pos < file->size; pos = batch_next_line(file, line_end)) {
+    p = file->data + pos;
+    line_end = batch_line_end(p, end, file->cp);
+
+    /* Only decode the lines that can be labels */
+    if (!memchr(p, ':', line_end - p)) continue;
+
+    len = MultiByteToWideChar(file->cp, 0, p, line_end - p, NULL, 0);
+    line = heap_alloc((len + 1) * sizeof(WCHAR));
+    MultiByteToWideChar(file->cp, 0, p, line_end - p, line, len);
+    line[len] = 0;
+    if ((name = batch_label_name(line)) && *name) {
+      if (file->nb_labels == alloc) {
+        BATCH_LABEL *labels;
+
+        alloc = max(alloc * 2, 16);
+        labels = heap_alloc(alloc * sizeof(*labels));
+        memcpy(labels, file->labels, file->nb_labels * sizeof(*labels));
+        heap_free(file->labels);
+        file->labels = labels;
+      }
+      file->labels[file->nb_labels].name = heap_strdupW(name);
+      file->labels[file->nb_labels].next_line = batch_next_line(file, line_end);
+      file->nb_labels++;
+    }
+    heap_free(line);
+  }
+  qsort(file->labels, file->nb_labels, sizeof(*file->labels), batch_label_cmp);
+  WINE_TRACE("indexed %u labels\n", file->nb_labels);
+}
+
+/* Reads the contents of a batch file, keeping the file position */
+static BOOL batch_file_read(BATCH_FILE *file, HANDLE h)
+{
+  LARGE_INTEGER size, pos, zero;
+  DWORD count;
+
+  if (!GetFileSizeEx(h, &size) || size.QuadPart > MAX_CACHED_BATCH_SIZE) return FALSE;
+  if (!GetFileTime(h, NULL, NULL, &file->write_time)) return FALSE;
+
+  heap_free(file->data);
+  file->data = heap_alloc(max(size.u.LowPart, 1));
+  file->size = 0;
+
+  zero.QuadPart = 0;
+  SetFilePointerEx(h, zero, &pos, FILE_CURRENT);
+  SetFilePointerEx(h, zero, NULL, FILE_BEGIN);
+  if (ReadFile(h, file->data, size.u.LowPart, &count, NULL)) file->size = count;
+  SetFilePointerEx(h, pos, NULL, FILE_BEGIN);
+
+  batch_index_labels(file);
+  return TRUE;
+}
+
+/* Loads a batch file in memory, returns NULL if it is read from the disk instead */
+static BATCH_FILE *batch_file_load(HANDLE h)
+{
+  BATCH_FILE *file = heap_alloc(sizeof(*file));
+
+  memset(file, 0, sizeof(*file));
+  file->refs = 1;
+  if (!batch_file_read(file, h)) {
+    heap_free(file->data);
+    heap_free(file);
+    return NULL;
+  }
+  return file;
+}
+
+static void batch_file_release(BATCH_FILE *file)
+{
+  if (!file || --file->refs) return;
+  batch_free_labels(file);
+  heap_free(file->data);
+  heap_free(file);
+}
+
+/* Reloads the cached contents if the file has been modified since they were read,
+   so that scripts modifying themselves behave as when reading from the disk */
+static BOOL batch_file_update(BATCH_FILE *file, HANDLE h)
+{
+  LARGE_INTEGER size;
+  FILETIME write_time;
+
+  if (!GetFileSizeEx(h, &size) || !GetFileTime(h, NULL, NULL, &write_time)) return FALSE;
+  if (size.QuadPart == file->size && !CompareFileTime(&write_time, &file->write_time)) {
+    if (file->cp != GetConsoleCP()) batch_index_labels(file);
+    return TRUE;
+  }
+  WINE_TRACE("batch file changed, reloading it\n");
+  return batch_file_read(file, h);
+}
+
+/* Returns the cached contents of a batch file, if h is the handle of the current one */
+static BATCH_FILE *batch_get_file(HANDLE h)
+{
+  if (!context || context->h != h || !context->file) return NULL;
+  if (batch_file_update(context->file, h)) return context->file;
+
+  /* Read the file from the disk from now on */
+  batch_file_release(context->file);
+  context->file = NULL;
+  return NULL;
+}
+
 /****************************************************************************
  * WCMD_batch
  *
@@ -68,6 +259,13 @@ void WCMD_batch (WCHAR *file, WCHAR *command, BOOL called, WCHAR *startLabel, HA
   prev_context = context;
   context = LocalAlloc (LMEM_FIXED, sizeof (BATCH_CONTEXT));
   context -> h = h;
+  /* A call to a label in the same file shares its cached contents */
+  if (startLabel && prev_context && prev_context -> file) {
+    context -> file = prev_context -> file;
+    context -> file -> refs++;
+  } else {
+    context -> file = batch_file_load (h);
+  }
   context->batchfileW = heap_strdupW(file);
   context -> command = command;
   memset(context -> shift_count, 0x00, sizeof(context -> shift_count));
@@ -110,6 +308,7 @@ void WCMD_batch (WCHAR *file, WCHAR *command, BOOL called, WCHAR *startLabel, HA
  *	to the caller's caller.
  */
 
+  batch_file_release(context->file);
   heap_free(context->batchfileW);
   LocalFree (context);
   if ((prev_context != NULL) && (!called)) {
@@ -228,6 +427,51 @@ WCHAR *WCMD_parameter (WCHAR *s, int n, WCHAR **start, BOOL raw,
   return WCMD_parameter_with_delims (s, n, start, raw, wholecmdline, defaultDelims);
 }
 
+/****************************************************************************
+ * WCMD_find_label
+ *
+ * Moves the current batch file position after the first line defining the
+ * given label. Returns FALSE if the label is not found.
+ */
+BOOL WCMD_find_label(const WCHAR *label)
+{
+  WCHAR string[MAX_PATH], *str;
+  BATCH_FILE *file;
+  LARGE_INTEGER pos;
+
+  if (!*label) return FALSE;
+
+  if ((file = batch_get_file(context->h))) {
+    BATCH_LABEL key, *found = NULL;
+    DWORD min = 0, max = file->nb_labels;
+
+    /* Find the first label with that name in the file */
+    key.name = (WCHAR *)label;
+    key.next_line = 0;
+    while (min < max) {
+      DWORD mid = (min + max) / 2;
+      if (batch_label_cmp(&key, &file->labels[mid]) <= 0) max = mid;
+      else min = mid + 1;
+    }
+    if (min < file->nb_labels && !lstrcmpiW(file->labels[min].name, label)) found = &file->labels[min];
+    if (!found) return FALSE;
+
+    pos.QuadPart = found->next_line;
+    SetFilePointerEx(context->h, pos, NULL, FILE_BEGIN);
+    return TRUE;
+  }
+
+  SetFilePointer (context -> h, 0, NULL, FILE_BEGIN);
+  while (WCMD_fgets (string, sizeof(string)/sizeof(WCHAR), context -> h)) {
+    WINE_TRACE("str before brk %s\n", wine_dbgstr_w(string));
+    if ((str = batch_label_name(string))) {
+      WINE_TRACE("comparing found label %s\n", wine_dbgstr_w(str));
+      if (lstrcmpiW (str, label) == 0) return TRUE;
+    }
+  }
+  return FALSE;
+}
+
 /****************************************************************************
  * WCMD_fgets
  *
@@ -246,11 +490,31 @@ WCHAR *WCMD_fgets(WCHAR *buf, DWORD noChars, HANDLE h)
   DWORD charsRead;
   BOOL status;
   DWORD i;
+  BATCH_FILE *file;
 
   /* We can't use the native f* functions because of the filename syntax differences
      between DOS and Unix. Also need to lose the LF (or CRLF) from the line. */
 
-  if (!WCMD_is_console_handle(h)) {
+  if ((file = batch_get_file(h))) {
+      LARGE_INTEGER filepos;
+      const char *p, *end;
+      UINT cp = GetConsoleCP();
+
+      filepos.QuadPart = 0;
+      SetFilePointerEx(h, filepos, &filepos, FILE_CURRENT);
+      if (filepos.QuadPart >= file->size) return NULL;
+
+      /* Same limits as reading noChars bytes from the file */
+      p = file->data + filepos.QuadPart;
+      end = p + min(noChars, file->size - filepos.QuadPart);
+      end = batch_line_end(p, end, cp);
+
+      filepos.QuadPart = batch_next_line(file, end);
+      SetFilePointerEx(h, filepos, NULL, FILE_BEGIN);
+
+      i = MultiByteToWideChar(cp, 0, p, end - p, buf, noChars);
+  }
+  else if (!WCMD_is_console_handle(h)) {
       LARGE_INTEGER filepos;
       char *bufA;
       UINT cp;
@@ -2967,6 +2967,24 @@ echo FAILURE at dest 10
 :dest10:this is also ignored
 echo Correctly ignored trailing information
 
+rem the first of duplicated labels is used, whatever their case
+del testgoto.bat >nul 2>&1
+echo goto DEST11>> testgoto.bat
+echo :dest11>> testgoto.bat
+echo echo goto with duplicated labels worked>> testgoto.bat
+echo goto :eof>> testgoto.bat
+echo :Dest11>> testgoto.bat
+echo echo FAILURE at dest 11>> testgoto.bat
+call testgoto.bat
+del testgoto.bat >nul 2>&1
+
+rem labels added by the batch file itself can be reached
+echo echo :dest12^>^> testgoto.bat>> testgoto.bat
+echo echo echo goto to a label added by the batch file worked^>^> testgoto.bat>> testgoto.bat
+echo goto dest12>> testgoto.bat
+call testgoto.bat
+del testgoto.bat >nul 2>&1
+
 echo ------------ Testing PATH ------------
 set WINE_backup_path=%path%
 set path=original
@@ -0,0 +1,271 @@
+/*
+ * Wine server request profiler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * Enables request profiling in the wineserver and periodically prints the
+ * requests that took the most handler time, either for all the processes
+ * or for a single one.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winbase.h"
+#include "wincon.h"
+#include "winternl.h"
+#include "wine/server.h"
+
+#define MAX_PROFILES 1024
+
+struct request_stats
+{
+    const struct request_profile *profile;  /* current statistics */
+    unsigned int count;                     /* calls since the previous sample */
+    ULONGLONG    time;                      /* handler time since the previous sample */
+    unsigned int histogram[REQUEST_PROFILE_BUCKETS];
+};
+
+static HANDLE process;
+static unsigned int max_lines = 25;
+static unsigned int delay = 2;
+static BOOL once;
+static BOOL reset;
+static BOOL enabled_here;  /* whether profiling was enabled by this instance */
+
+static struct request_profile profiles[2][MAX_PROFILES];
+static unsigned int nb_profiles[2];
+static struct request_stats stats[MAX_PROFILES];
+
+static void usage(void)
+{
+    printf( "Usage: wineserverstat [options]\n\n"
+            "  -p pid     only show the requests made by the given process\n"
+            "  -n lines   number of requests to show (default %u)\n"
+            "  -d delay   delay between updates in seconds (default %u)\n"
+            "  -1         print the statistics collected so far once and exit\n"
+            "  -r         reset the statistics first\n"
+            "  -x         disable request profiling and exit\n\n"
+            "Enabling, resetting or disabling the profiling requires the SeSystemProfilePrivilege.\n",
+            max_lines, delay );
+    exit( 1 );
+}
+
+static NTSTATUS get_profile( unsigned int flags, struct request_profile *data, unsigned int *count,
+                             ULONGLONG *start_time, BOOL *enabled )
+{
+    NTSTATUS status;
+
+    SERVER_START_REQ( get_request_profile )
+    {
+        req->handle = wine_server_obj_handle( process );
+        req->flags  = flags;
+        if (data) wine_server_set_reply( req, data, MAX_PROFILES * sizeof(*data) );
+        if (!(status = wine_server_call( req )))
+        {
+            if (count) *count = wine_server_reply_size( reply ) / sizeof(*data);
+            if (start_time) *start_time = reply->start_time;
+            if (enabled) *enabled = reply->enabled;
+        }
+    }
+    SERVER_END_REQ;
+    return status;
+}
+
+/* changing the profiling state requires the system profile privilege */
+static NTSTATUS set_profile_state( unsigned int flags, struct request_profile *data, unsigned int *count,
+                                   ULONGLONG *start_time )
+{
+    TOKEN_PRIVILEGES privs;
+    HANDLE token;
+
+    if (OpenProcessToken( GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token ))
+    {
+        privs.PrivilegeCount = 1;
+        privs.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if (LookupPrivilegeValueA( NULL, "SeSystemProfilePrivilege", &privs.Privileges[0].Luid ))
+            AdjustTokenPrivileges( token, FALSE, &privs, 0, NULL, NULL );
+        CloseHandle( token );
+    }
+    return get_profile( flags, data, count, start_time, NULL );
+}
+
+static void disable_profiling(void)
+{
+    if (enabled_here) set_profile_state( REQUEST_PROFILE_DISABLE, NULL, NULL, NULL );
+    enabled_here = FALSE;
+}
+
+static BOOL WINAPI ctrl_handler( DWORD type )
+{
+    disable_profiling();
+    return FALSE;
+}
+
+static const struct request_profile *find_profile( const struct request_profile *data, unsigned int count,
+                                                   unsigned int req )
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++) if (data[i].req == req) return &data[i];
+    return NULL;
+}
+
+static int compare_stats( const void *p1, const void *p2 )
+{
+    const struct request_stats *s1 = p1, *s2 = p2;
+
+    if (s1->time != s2->time) return s1->time > s2->time ? -1 : 1;
+    if (s1->count != s2->count) return s1->count > s2->count ? -1 : 1;
+    return strcmp( s1->profile->name, s2->profile->name );
+}
+
+/* approximate a latency percentile in microseconds from the histogram */
+static unsigned int get_percentile( const struct request_stats *stat, unsigned int percent )
+{
+    unsigned int i, total = 0, limit = (stat->count * (ULONGLONG)percent + 99) / 100;
+
+    for (i = 0; i < REQUEST_PROFILE_BUCKETS - 1; i++)
+        if ((total += stat->histogram[i]) >= limit) break;
+    return 1u << i;
+}
+
+static void print_stats( const struct request_profile *cur, unsigned int nb_cur,
+                         const struct request_profile *prev, unsigned int nb_prev, double elapsed )
+{
+    unsigned int i, j, count = 0;
+    ULONGLONG total_time = 0, total_count = 0;
+
+    for (i = 0; i < nb_cur; i++)
+    {
+        const struct request_profile *old = find_profile( prev, nb_prev, cur[i].req );
+        struct request_stats *stat = &stats[count];
+
+        stat->profile = &cur[i];
+        stat->count = cur[i].count - (old ? old->count : 0);
+        stat->time  = cur[i].time - (old ? old->time : 0);
+        for (j = 0; j < REQUEST_PROFILE_BUCKETS; j++)
+            stat->histogram[j] = cur[i].histogram[j] - (old ? old->histogram[j] : 0);
+        if (!stat->count) continue;
+        total_count += stat->count;
+        total_time += stat->time;
+        count++;
+    }
+    qsort( stats, count, sizeof(stats[0]), compare_stats );
+
+    if (!once) printf( "\033[H\033[2J" );
+    printf( "%s: %.0f requests/s, %.1f%% of the time in handlers (%.1fs sample)\n\n",
+            process ? "process" : "wineserver", total_count / elapsed,
+            total_time / elapsed / 1e7, elapsed );
+    printf( "%-32s %10s %10s %10s %8s %8s %8s\n",
+            "request", "calls", "calls/s", "time (ms)", "avg (us)", "p50 (us)", "p99 (us)" );
+    for (i = 0; i < count && i < max_lines; i++)
+    {
+        printf( "%-32.32s %10u %10.0f %10.2f %8.2f %7s%u %7s%u\n",
+                stats[i].profile->name, stats[i].count, stats[i].count / elapsed,
+                stats[i].time / 1e6, stats[i].time / 1e3 / stats[i].count,
+                "<", get_percentile( &stats[i], 50 ), "<", get_percentile( &stats[i], 99 ));
+    }
+    fflush( stdout );
+}
+
+int main( int argc, char *argv[] )
+{
+    ULONGLONG start_time, now;
+    LARGE_INTEGER counter, frequency, last_counter;
+    unsigned int cur = 0, pid = 0, flags = 0;
+    NTSTATUS status;
+    BOOL enabled;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp( argv[i], "-p" ) && i + 1 < argc) pid = strtoul( argv[++i], NULL, 0 );
+        else if (!strcmp( argv[i], "-n" ) && i + 1 < argc) max_lines = atoi( argv[++i] );
+        else if (!strcmp( argv[i], "-d" ) && i + 1 < argc) delay = max( atoi( argv[++i] ), 1 );
+        else if (!strcmp( argv[i], "-1" )) once = TRUE;
+        else if (!strcmp( argv[i], "-r" )) reset = TRUE;
+        else if (!strcmp( argv[i], "-x" ))
+        {
+            if ((status = set_profile_state( REQUEST_PROFILE_DISABLE, NULL, NULL, NULL )))
+            {
+                fprintf( stderr, "wineserverstat: cannot disable request profiling (status %08x)\n", status );
+                return 1;
+            }
+            return 0;
+        }
+        else usage();
+    }
+
+    if (pid && !(process = OpenProcess( PROCESS_QUERY_INFORMATION, FALSE, pid )))
+    {
+        fprintf( stderr, "wineserverstat: cannot open process %04x (error %u)\n", pid, GetLastError() );
+        return 1;
+    }
+
+    if ((status = get_profile( 0, profiles[cur], &nb_profiles[cur], &start_time, &enabled )))
+    {
+        fprintf( stderr, "wineserverstat: cannot get the request statistics (status %08x)\n", status );
+        return 1;
+    }
+
+    /* a one-shot run only reports what has been collected, without changing anything */
+    if (once)
+    {
+        if (!enabled && !nb_profiles[cur])
+        {
+            fprintf( stderr, "wineserverstat: request profiling is not enabled\n" );
+            return 1;
+        }
+        NtQuerySystemTime( (LARGE_INTEGER *)&now );
+        print_stats( profiles[cur], nb_profiles[cur], NULL, 0,
+                     now > start_time ? (now - start_time) / 1e7 : 1.0 );
+        return 0;
+    }
+
+    /* the statistics are shared, leave them alone if another instance already enabled them */
+    if (!enabled) flags |= REQUEST_PROFILE_ENABLE;
+    if (reset) flags |= REQUEST_PROFILE_RESET;
+    if (flags)
+    {
+        if ((status = set_profile_state( flags, profiles[cur], &nb_profiles[cur], &start_time )))
+        {
+            fprintf( stderr, "wineserverstat: cannot enable request profiling (status %08x)\n", status );
+            return 1;
+        }
+        enabled_here = !enabled;
+    }
+
+    SetConsoleCtrlHandler( ctrl_handler, TRUE );
+    QueryPerformanceFrequency( &frequency );
+    QueryPerformanceCounter( &last_counter );
+    for (;;)
+    {
+        Sleep( delay * 1000 );
+        if (get_profile( 0, profiles[!cur], &nb_profiles[!cur], NULL, NULL )) break;
+        QueryPerformanceCounter( &counter );
+        print_stats( profiles[!cur], nb_profiles[!cur], profiles[cur], nb_profiles[cur],
+                     (double)(counter.QuadPart - last_counter.QuadPart) / frequency.QuadPart );
+        last_counter = counter;
+        cur = !cur;
+    }
+    disable_profiling();
+    return 0;
+}
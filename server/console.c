@@ -1252,6 +1252,158 @@ static int write_console_output( struct screen_buffer *screen_buffer, data_size_
     return i;
 }
 
+/* state of a text write to a screen buffer */
+struct text_cursor
+{
+    int x, y;              /* cursor position */
+    int start;             /* start of the current run of characters when not wrapping */
+    int top, bottom;       /* rows modified so far */
+};
+
+/* move the text cursor to the start of the next line, scrolling the buffer if needed */
+static void text_new_line( struct screen_buffer *screen_buffer, struct text_cursor *cur )
+{
+    char_info_t *last;
+    int i;
+
+    cur->x = cur->start = 0;
+    if (++cur->y < screen_buffer->height) return;
+
+    cur->y = screen_buffer->height - 1;
+    last = screen_buffer->data + cur->y * screen_buffer->width;
+    memmove( screen_buffer->data, screen_buffer->data + screen_buffer->width,
+             cur->y * screen_buffer->width * sizeof(*last) );
+    for (i = 0; i < screen_buffer->width; i++)
+    {
+        last[i].ch   = ' ';
+        last[i].attr = screen_buffer->attr;
+    }
+    cur->top = 0;
+    cur->bottom = screen_buffer->height - 1;
+}
+
+/* store a character at the text cursor */
+static void text_put_char( struct screen_buffer *screen_buffer, struct text_cursor *cur, WCHAR ch )
+{
+    char_info_t *dest;
+
+    /* without wrapping, the characters past the end of line overwrite the start of the run */
+    if (cur->x >= screen_buffer->width) cur->x = cur->start;
+
+    dest = screen_buffer->data + cur->y * screen_buffer->width + cur->x++;
+    dest->ch   = ch;
+    dest->attr = screen_buffer->attr;
+    cur->top    = min( cur->top, cur->y );
+    cur->bottom = max( cur->bottom, cur->y );
+
+    if (cur->x == screen_buffer->width && (screen_buffer->mode & ENABLE_WRAP_AT_EOL_OUTPUT))
+        text_new_line( screen_buffer, cur );
+}
+
+/* scroll the visible window of a screen buffer to make the cursor visible */
+static void show_cursor( struct screen_buffer *screen_buffer )
+{
+    struct console_renderer_event evt;
+    int w = screen_buffer->win.right - screen_buffer->win.left + 1;
+    int h = screen_buffer->win.bottom - screen_buffer->win.top + 1;
+    int left = screen_buffer->win.left, top = screen_buffer->win.top;
+
+    if (screen_buffer->cursor_x < left)
+        left = min( screen_buffer->cursor_x, screen_buffer->width - w );
+    else if (screen_buffer->cursor_x > screen_buffer->win.right)
+        left = max( screen_buffer->cursor_x, w ) - w + 1;
+
+    if (screen_buffer->cursor_y < top)
+        top = min( screen_buffer->cursor_y, screen_buffer->height - h );
+    else if (screen_buffer->cursor_y > screen_buffer->win.bottom)
+        top = max( screen_buffer->cursor_y, h ) - h + 1;
+
+    if (left == screen_buffer->win.left && top == screen_buffer->win.top) return;
+
+    screen_buffer->win.left   = left;
+    screen_buffer->win.top    = top;
+    screen_buffer->win.right  = left + w - 1;
+    screen_buffer->win.bottom = top + h - 1;
+    evt.event = CONSOLE_RENDERER_DISPLAY_EVENT;
+    memset( &evt.u, 0, sizeof(evt.u) );
+    evt.u.display.left   = left;
+    evt.u.display.top    = top;
+    evt.u.display.width  = w;
+    evt.u.display.height = h;
+    console_input_events_append( screen_buffer->input, &evt );
+}
+
+/* write text at the cursor of a screen buffer, returns the number of bells to ring */
+static unsigned int write_console_text( struct screen_buffer *screen_buffer, const WCHAR *text,
+                                        data_size_t len )
+{
+    struct console_renderer_event evt;
+    struct text_cursor cur;
+    unsigned int bells = 0;
+    data_size_t i;
+    int count;
+
+    cur.x = cur.start = screen_buffer->cursor_x;
+    cur.y = screen_buffer->cursor_y;
+    cur.top = screen_buffer->height;
+    cur.bottom = -1;
+
+    for (i = 0; i < len; i++)
+    {
+        if (screen_buffer->mode & ENABLE_PROCESSED_OUTPUT)
+        {
+            switch (text[i])
+            {
+            case '\b':
+                cur.x = min( cur.x, screen_buffer->width - 1 );
+                if (cur.x > 0) cur.x--;
+                cur.start = cur.x;
+                continue;
+            case '\t':
+                cur.start = cur.x;
+                for (count = ((cur.x + 8) & ~7) - cur.x; count > 0; count--)
+                    text_put_char( screen_buffer, &cur, ' ' );
+                cur.start = cur.x;
+                continue;
+            case '\n':
+                text_new_line( screen_buffer, &cur );
+                continue;
+            case '\a':
+                bells++;
+                cur.start = cur.x;
+                continue;
+            case '\r':
+                cur.x = cur.start = 0;
+                continue;
+            }
+        }
+        text_put_char( screen_buffer, &cur, text[i] );
+    }
+
+    if (cur.top <= cur.bottom && screen_buffer == screen_buffer->input->active)
+    {
+        evt.event = CONSOLE_RENDERER_UPDATE_EVENT;
+        memset( &evt.u, 0, sizeof(evt.u) );
+        evt.u.update.top    = cur.top;
+        evt.u.update.bottom = cur.bottom;
+        console_input_events_append( screen_buffer->input, &evt );
+    }
+
+    cur.x = min( cur.x, screen_buffer->width - 1 );
+    if (screen_buffer->cursor_x != cur.x || screen_buffer->cursor_y != cur.y)
+    {
+        screen_buffer->cursor_x = cur.x;
+        screen_buffer->cursor_y = cur.y;
+        evt.event = CONSOLE_RENDERER_CURSOR_POS_EVENT;
+        memset( &evt.u, 0, sizeof(evt.u) );
+        evt.u.cursor_pos.x = cur.x;
+        evt.u.cursor_pos.y = cur.y;
+        console_input_events_append( screen_buffer->input, &evt );
+    }
+    show_cursor( screen_buffer );
+    return bells;
+}
+
 /* fill a screen buffer with uniform data */
 static int fill_console_output( struct screen_buffer *screen_buffer, char_info_t data,
                                 enum char_info_mode mode, int x, int y, int count, int wrap )
@@ -1752,6 +1904,26 @@ DECL_HANDLER(write_console_output)
     }
 }
 
+/* write text at the cursor of a screen buffer */
+DECL_HANDLER(write_console_text)
+{
+    struct screen_buffer *screen_buffer;
+
+    if ((screen_buffer = (struct screen_buffer*)get_handle_obj( current->process, req->handle,
+                                                                FILE_WRITE_DATA, &screen_buffer_ops)))
+    {
+        if (console_input_is_bare( screen_buffer->input ))
+        {
+            set_error( STATUS_OBJECT_TYPE_MISMATCH );
+            release_object( screen_buffer );
+            return;
+        }
+        reply->written = get_req_data_size() / sizeof(WCHAR);
+        reply->bells   = write_console_text( screen_buffer, get_req_data(), reply->written );
+        release_object( screen_buffer );
+    }
+}
+
 /* fill a screen buffer with constant data (chars and/or attributes) */
 DECL_HANDLER(fill_console_output)
 {
@@ -533,6 +533,7 @@ struct thread *create_process( int fd, struct thread *parent_thread, int inherit
     process->trace_data      = 0;
     process->rawinput_mouse  = NULL;
     process->rawinput_kbd    = NULL;
+    process->profile         = NULL;
     list_init( &process->thread_list );
     list_init( &process->locks );
     list_init( &process->asyncs );
@@ -634,6 +635,7 @@ static void process_destroy( struct object *obj )
     if (process->id) free_ptid( process->id );
     if (process->token) release_object( process->token );
     free( process->dir_cache );
+    free( process->profile );
 }
 
 /* dump a process on stdout for debugging purposes */
@@ -1438,6 +1440,24 @@ DECL_HANDLER(write_process_memory)
     }
 }
 
+/* get the Unix pid of a process for direct access to its address space */
+DECL_HANDLER(get_process_vm_access)
+{
+    struct process *process;
+
+    reply->unix_pid = -1;
+    if (!req->access || (req->access & ~(PROCESS_VM_READ | PROCESS_VM_WRITE)))
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if ((process = get_process_from_handle( req->handle, req->access )))
+    {
+        if (process->running_threads) reply->unix_pid = process->unix_pid;
+        release_object( process );
+    }
+}
+
 /* notify the server that a dll has been loaded */
 DECL_HANDLER(load_dll)
 {
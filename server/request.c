@@ -286,6 +286,88 @@ static void send_reply( union generic_reply *reply )
         fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
 }
 
+/* request profiling data */
+struct process_profile
+{
+    unsigned int           generation;                /* profiling generation of the data */
+    struct request_profile requests[REQ_NB_REQUESTS];
+};
+
+static int profiling;                        /* are we collecting request statistics? */
+static unsigned int profile_generation;      /* incremented when the statistics are reset */
+static timeout_t profile_start_time;         /* time at which profiling was enabled or reset */
+static struct process_profile *server_profile;
+
+/* get a timestamp for profiling, in nanoseconds */
+static timeout_t get_profile_time(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts ))
+        return (timeout_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+
+    if (!timebase.denom) mach_timebase_info( &timebase );
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#endif
+    {
+        struct timeval tv;
+        gettimeofday( &tv, NULL );
+        return (timeout_t)tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+    }
+}
+
+/* get the profile data of a process, clearing it if it's from an older generation */
+static struct process_profile *get_process_profile( struct process *process, int alloc )
+{
+    if (!process->profile)
+    {
+        if (!alloc || !(process->profile = mem_alloc( sizeof(*process->profile) ))) return NULL;
+        process->profile->generation = profile_generation - 1;
+    }
+    if (process->profile->generation != profile_generation)
+    {
+        memset( process->profile->requests, 0, sizeof(process->profile->requests) );
+        process->profile->generation = profile_generation;
+    }
+    return process->profile;
+}
+
+static void add_profile_sample( struct process_profile *profile, enum request req, timeout_t time )
+{
+    struct request_profile *stats = &profile->requests[req];
+    timeout_t us = time / 1000;
+    unsigned int bucket = 0;
+
+    while (us && bucket < REQUEST_PROFILE_BUCKETS - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+    stats->count++;
+    stats->time += time;
+    stats->histogram[bucket]++;
+}
+
+/* call a request handler, recording the time it took */
+static void call_profiled_req_handler( enum request req, union generic_reply *reply )
+{
+    struct process *process = (struct process *)grab_object( current->process );
+    struct process_profile *profile;
+    timeout_t start = get_profile_time(), time;
+
+    req_handlers[req]( &current->req, reply );
+
+    time = get_profile_time() - start;
+    if (profiling)  /* the handler may have disabled it */
+    {
+        add_profile_sample( server_profile, req, time );
+        if ((profile = get_process_profile( process, 1 ))) add_profile_sample( profile, req, time );
+    }
+    release_object( process );
+}
+
 /* call a request handler */
 static void call_req_handler( struct thread *thread )
 {
@@ -300,7 +382,10 @@ static void call_req_handler( struct thread *thread )
     if (debug_level) trace_request();
 
     if (req < REQ_NB_REQUESTS)
-        req_handlers[req]( &current->req, &reply );
+    {
+        if (profiling) call_profiled_req_handler( req, &reply );
+        else req_handlers[req]( &current->req, &reply );
+    }
     else
         set_error( STATUS_NOT_IMPLEMENTED );
 
@@ -897,3 +982,66 @@ void close_master_socket( timeout_t timeout )
 
     master_timeout = add_timeout_user( timeout, close_socket_timeout, NULL );
 }
+
+/* retrieve the request profiling statistics */
+DECL_HANDLER(get_request_profile)
+{
+    struct process_profile *profile = server_profile;
+    struct process *process = NULL;
+    struct request_profile *data;
+    const char *name;
+    unsigned int i, count = 0, flags = req->flags;
+
+    /* changing the profiling state affects all the processes */
+    if ((flags & (REQUEST_PROFILE_ENABLE | REQUEST_PROFILE_DISABLE | REQUEST_PROFILE_RESET)) &&
+        !thread_single_check_privilege( current, &SeSystemProfilePrivilege ))
+    {
+        set_error( STATUS_PRIVILEGE_NOT_HELD );
+        return;
+    }
+
+    if (req->handle && !(process = get_process_from_handle( req->handle, PROCESS_QUERY_INFORMATION )))
+        return;
+
+    if (flags & REQUEST_PROFILE_ENABLE)
+    {
+        if (!server_profile)
+        {
+            if (!(server_profile = mem_alloc( sizeof(*server_profile) ))) goto done;
+            flags |= REQUEST_PROFILE_RESET;
+        }
+        profiling = 1;
+    }
+    if (flags & REQUEST_PROFILE_DISABLE) profiling = 0;
+    if ((flags & REQUEST_PROFILE_RESET) && server_profile)
+    {
+        memset( server_profile->requests, 0, sizeof(server_profile->requests) );
+        profile_generation++;
+        profile_start_time = current_time;
+    }
+
+    reply->enabled = profiling;
+    reply->start_time = profile_start_time;
+
+    if (process) profile = get_process_profile( process, 0 );
+    if (!profile) goto done;
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++) if (profile->requests[i].count) count++;
+    count = min( count, get_reply_max_size() / sizeof(*data) );
+    if (!(data = set_reply_data_size( count * sizeof(*data) ))) goto done;
+
+    for (i = 0; i < REQ_NB_REQUESTS && count; i++)
+    {
+        if (!profile->requests[i].count) continue;
+        name = get_request_name( i );
+        *data = profile->requests[i];
+        data->req = i;
+        memset( data->name, 0, sizeof(data->name) );
+        memcpy( data->name, name, min( strlen(name), sizeof(data->name) - 1 ));
+        data++;
+        count--;
+    }
+
+done:
+    if (process) release_object( process );
+}
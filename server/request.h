@@ -64,6 +64,7 @@ extern int server_dir_fd, config_dir_fd;
 
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern const char *get_request_name( enum request req );
 
 /* get the request vararg data */
 static inline const void *get_req_data(void)
@@ -186,6 +187,7 @@ DECL_HANDLER(get_console_output_info);
 DECL_HANDLER(write_console_input);
 DECL_HANDLER(read_console_input);
 DECL_HANDLER(write_console_output);
+DECL_HANDLER(write_console_text);
 DECL_HANDLER(fill_console_output);
 DECL_HANDLER(read_console_output);
 DECL_HANDLER(move_console_output);
@@ -209,6 +211,7 @@ DECL_HANDLER(debug_break);
 DECL_HANDLER(set_debugger_kill_on_exit);
 DECL_HANDLER(read_process_memory);
 DECL_HANDLER(write_process_memory);
+DECL_HANDLER(get_process_vm_access);
 DECL_HANDLER(create_key);
 DECL_HANDLER(open_key);
 DECL_HANDLER(delete_key);
@@ -395,6 +398,7 @@ DECL_HANDLER(process_in_job);
 DECL_HANDLER(set_job_limits);
 DECL_HANDLER(set_job_completion_port);
 DECL_HANDLER(terminate_job);
+DECL_HANDLER(get_request_profile);
 
 #ifdef WANT_REQUEST_HANDLERS
 
@@ -475,6 +479,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_write_console_input,
     (req_handler)req_read_console_input,
     (req_handler)req_write_console_output,
+    (req_handler)req_write_console_text,
     (req_handler)req_fill_console_output,
     (req_handler)req_read_console_output,
     (req_handler)req_move_console_output,
@@ -498,6 +503,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_set_debugger_kill_on_exit,
     (req_handler)req_read_process_memory,
     (req_handler)req_write_process_memory,
+    (req_handler)req_get_process_vm_access,
     (req_handler)req_create_key,
     (req_handler)req_open_key,
     (req_handler)req_delete_key,
@@ -684,6 +690,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_set_job_limits,
     (req_handler)req_set_job_completion_port,
     (req_handler)req_terminate_job,
+    (req_handler)req_get_request_profile,
 };
 
 C_ASSERT( sizeof(affinity_t) == 8 );
@@ -1194,6 +1201,11 @@ C_ASSERT( FIELD_OFFSET(struct write_console_output_reply, written) == 8 );
 C_ASSERT( FIELD_OFFSET(struct write_console_output_reply, width) == 12 );
 C_ASSERT( FIELD_OFFSET(struct write_console_output_reply, height) == 16 );
 C_ASSERT( sizeof(struct write_console_output_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct write_console_text_request, handle) == 12 );
+C_ASSERT( sizeof(struct write_console_text_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct write_console_text_reply, written) == 8 );
+C_ASSERT( FIELD_OFFSET(struct write_console_text_reply, bells) == 12 );
+C_ASSERT( sizeof(struct write_console_text_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct fill_console_output_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct fill_console_output_request, x) == 16 );
 C_ASSERT( FIELD_OFFSET(struct fill_console_output_request, y) == 20 );
@@ -1328,6 +1340,11 @@ C_ASSERT( sizeof(struct read_process_memory_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct write_process_memory_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct write_process_memory_request, addr) == 16 );
 C_ASSERT( sizeof(struct write_process_memory_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_process_vm_access_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_process_vm_access_request, access) == 16 );
+C_ASSERT( sizeof(struct get_process_vm_access_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_process_vm_access_reply, unix_pid) == 8 );
+C_ASSERT( sizeof(struct get_process_vm_access_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, options) == 16 );
 C_ASSERT( sizeof(struct create_key_request) == 24 );
@@ -1630,7 +1647,9 @@ C_ASSERT( FIELD_OFFSET(struct get_named_pipe_info_reply, maxinstances) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_named_pipe_info_reply, instances) == 20 );
 C_ASSERT( FIELD_OFFSET(struct get_named_pipe_info_reply, outsize) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_named_pipe_info_reply, insize) == 28 );
-C_ASSERT( sizeof(struct get_named_pipe_info_reply) == 32 );
+C_ASSERT( FIELD_OFFSET(struct get_named_pipe_info_reply, client_pid) == 32 );
+C_ASSERT( FIELD_OFFSET(struct get_named_pipe_info_reply, server_pid) == 36 );
+C_ASSERT( sizeof(struct get_named_pipe_info_reply) == 40 );
 C_ASSERT( FIELD_OFFSET(struct set_named_pipe_info_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_named_pipe_info_request, flags) == 16 );
 C_ASSERT( sizeof(struct set_named_pipe_info_request) == 24 );
@@ -2366,6 +2385,12 @@ C_ASSERT( sizeof(struct set_job_completion_port_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct terminate_job_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct terminate_job_request, status) == 16 );
 C_ASSERT( sizeof(struct terminate_job_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_request_profile_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_request_profile_request, flags) == 16 );
+C_ASSERT( sizeof(struct get_request_profile_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_request_profile_reply, start_time) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_request_profile_reply, enabled) == 16 );
+C_ASSERT( sizeof(struct get_request_profile_reply) == 24 );
 
 #endif  /* WANT_REQUEST_HANDLERS */
 
@@ -415,6 +415,24 @@ static void dump_varargs_uints( const char *prefix, data_size_t size )
     remove_data( size );
 }
 
+static void dump_varargs_request_profiles( const char *prefix, data_size_t size )
+{
+    const struct request_profile *profile = cur_data;
+    data_size_t len = size / sizeof(*profile);
+
+    fprintf( stderr, "%s{", prefix );
+    while (len > 0)
+    {
+        fprintf( stderr, "{%.*s,count=%u", (int)sizeof(profile->name), profile->name, profile->count );
+        dump_uint64( ",time=", (const unsigned __int64 *)&profile->time );
+        fputc( '}', stderr );
+        profile++;
+        if (--len) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+    remove_data( size );
+}
+
 static void dump_varargs_uints64( const char *prefix, data_size_t size )
 {
     const unsigned __int64 *data = cur_data;
@@ -2111,6 +2129,18 @@ static void dump_write_console_output_reply( const struct write_console_output_r
     fprintf( stderr, ", height=%d", req->height );
 }
 
+static void dump_write_console_text_request( const struct write_console_text_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    dump_varargs_unicode_str( ", data=", cur_size );
+}
+
+static void dump_write_console_text_reply( const struct write_console_text_reply *req )
+{
+    fprintf( stderr, " written=%u", req->written );
+    fprintf( stderr, ", bells=%08x", req->bells );
+}
+
 static void dump_fill_console_output_request( const struct fill_console_output_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -2371,6 +2401,17 @@ static void dump_write_process_memory_request( const struct write_process_memory
     dump_varargs_bytes( ", data=", cur_size );
 }
 
+static void dump_get_process_vm_access_request( const struct get_process_vm_access_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_get_process_vm_access_reply( const struct get_process_vm_access_reply *req )
+{
+    fprintf( stderr, " unix_pid=%d", req->unix_pid );
+}
+
 static void dump_create_key_request( const struct create_key_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2965,6 +3006,8 @@ static void dump_get_named_pipe_info_reply( const struct get_named_pipe_info_rep
     fprintf( stderr, ", instances=%08x", req->instances );
     fprintf( stderr, ", outsize=%08x", req->outsize );
     fprintf( stderr, ", insize=%08x", req->insize );
+    fprintf( stderr, ", client_pid=%04x", req->client_pid );
+    fprintf( stderr, ", server_pid=%04x", req->server_pid );
 }
 
 static void dump_set_named_pipe_info_request( const struct set_named_pipe_info_request *req )
@@ -4459,6 +4502,19 @@ static void dump_terminate_job_request( const struct terminate_job_request *req
     fprintf( stderr, ", status=%d", req->status );
 }
 
+static void dump_get_request_profile_request( const struct get_request_profile_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", flags=%08x", req->flags );
+}
+
+static void dump_get_request_profile_reply( const struct get_request_profile_reply *req )
+{
+    dump_timeout( " start_time=", &req->start_time );
+    fprintf( stderr, ", enabled=%d", req->enabled );
+    dump_varargs_request_profiles( ", profiles=", cur_size );
+}
+
 static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_new_process_request,
     (dump_func)dump_get_new_process_info_request,
@@ -4534,6 +4590,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_write_console_input_request,
     (dump_func)dump_read_console_input_request,
     (dump_func)dump_write_console_output_request,
+    (dump_func)dump_write_console_text_request,
     (dump_func)dump_fill_console_output_request,
     (dump_func)dump_read_console_output_request,
     (dump_func)dump_move_console_output_request,
@@ -4557,6 +4614,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_set_debugger_kill_on_exit_request,
     (dump_func)dump_read_process_memory_request,
     (dump_func)dump_write_process_memory_request,
+    (dump_func)dump_get_process_vm_access_request,
     (dump_func)dump_create_key_request,
     (dump_func)dump_open_key_request,
     (dump_func)dump_delete_key_request,
@@ -4743,6 +4801,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_set_job_limits_request,
     (dump_func)dump_set_job_completion_port_request,
     (dump_func)dump_terminate_job_request,
+    (dump_func)dump_get_request_profile_request,
 };
 
 static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
@@ -4820,6 +4879,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_write_console_input_reply,
     (dump_func)dump_read_console_input_reply,
     (dump_func)dump_write_console_output_reply,
+    (dump_func)dump_write_console_text_reply,
     (dump_func)dump_fill_console_output_reply,
     (dump_func)dump_read_console_output_reply,
     NULL,
@@ -4843,6 +4903,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_read_process_memory_reply,
     NULL,
+    (dump_func)dump_get_process_vm_access_reply,
     (dump_func)dump_create_key_reply,
     (dump_func)dump_open_key_reply,
     NULL,
@@ -5029,6 +5090,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     NULL,
+    (dump_func)dump_get_request_profile_reply,
 };
 
 static const char * const req_names[REQ_NB_REQUESTS] = {
@@ -5106,6 +5168,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "write_console_input",
     "read_console_input",
     "write_console_output",
+    "write_console_text",
     "fill_console_output",
     "read_console_output",
     "move_console_output",
@@ -5129,6 +5192,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "set_debugger_kill_on_exit",
     "read_process_memory",
     "write_process_memory",
+    "get_process_vm_access",
     "create_key",
     "open_key",
     "delete_key",
@@ -5315,6 +5379,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "set_job_limits",
     "set_job_completion_port",
     "terminate_job",
+    "get_request_profile",
 };
 
 static const struct
@@ -5453,6 +5518,11 @@ static const char *get_status_name( unsigned int status )
     return buffer;
 }
 
+const char *get_request_name( enum request req )
+{
+    return req < REQ_NB_REQUESTS ? req_names[req] : NULL;
+}
+
 void trace_request(void)
 {
     enum request req = current->req.request_header.req;
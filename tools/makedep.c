@@ -30,6 +30,12 @@
 #include <stdarg.h>
 #include <signal.h>
 #include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_WAIT_H
+# include <sys/wait.h>
+#endif
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
@@ -58,6 +64,8 @@ struct file
     char              *name;          /* full file name relative to cwd */
     void              *args;          /* custom arguments for makefile rule */
     unsigned int       flags;         /* flags (see below) */
+    off_t              size;          /* file size when it was parsed */
+    time_t             mtime;         /* modification time when it was parsed (0 if unknown) */
     unsigned int       deps_count;    /* files in use */
     unsigned int       deps_size;     /* total allocated size */
     struct dependency *deps;          /* all header dependencies */
@@ -111,7 +119,10 @@ static const struct
 
 #define HASH_SIZE 997
 
+#define CACHE_VERSION 1  /* increment when the format of the cache changes */
+
 static struct list files[HASH_SIZE];
+static struct list cached_files[HASH_SIZE];  /* files from the cache that have not been loaded yet */
 
 struct strarray
 {
@@ -187,11 +198,14 @@ struct makefile
 static struct makefile *top_makefile;
 
 static const char separator[] = "### Dependencies";
+static const char cache_file_name[] = "makedep.cache";
 static const char *output_makefile_name = "Makefile";
 static const char *input_file_name;
 static const char *output_file_name;
 static const char *temp_file_name;
 static int relative_dir_mode;
+static unsigned int jobs = 1;
+static time_t start_time;
 static int input_line;
 static int output_column;
 static FILE *output_file;
@@ -200,7 +214,8 @@ static const char Usage[] =
     "Usage: makedep [options] [directories]\n"
     "Options:\n"
     "   -R from to  Compute the relative path between two directories\n"
-    "   -fxxx       Store output in file 'xxx' (default: Makefile)\n";
+    "   -fxxx       Store output in file 'xxx' (default: Makefile)\n"
+    "   -jN         Use N processes to output the makefiles (default: number of CPUs)\n";
 
 
 #ifndef __GNUC__
@@ -1202,15 +1217,37 @@ static const struct
 static struct file *load_file( const char *name )
 {
     struct file *file;
+    struct stat st;
     FILE *f;
     unsigned int i, hash = hash_filename( name );
 
     LIST_FOR_EACH_ENTRY( file, &files[hash], struct file, entry )
         if (!strcmp( name, file->name )) return file;
 
+    if (stat( name, &st ) == -1) return NULL;
+    if (!S_ISREG( st.st_mode )) st.st_mtime = 0;
+
+    /* use the cached dependencies if the file didn't change since it was parsed */
+    if (st.st_mtime)
+    {
+        LIST_FOR_EACH_ENTRY( file, &cached_files[hash], struct file, entry )
+        {
+            if (strcmp( name, file->name )) continue;
+            list_remove( &file->entry );
+            if (file->size == st.st_size && file->mtime == st.st_mtime)
+            {
+                list_add_tail( &files[hash], &file->entry );
+                return file;
+            }
+            break;
+        }
+    }
+
     if (!(f = fopen( name, "r" ))) return NULL;
 
     file = add_file( name );
+    file->size = st.st_size;
+    file->mtime = st.st_mtime;
     list_add_tail( &files[hash], &file->entry );
     input_file_name = file->name;
     input_line = 0;
@@ -2488,25 +2525,27 @@ static struct strarray output_sources( const struct makefile *make )
         else if (!strcmp( ext, "idl" ))  /* IDL file */
         {
             struct strarray targets = empty_strarray;
+            unsigned int flags = source->file->flags;
             char *dest;
 
-            if (!source->file->flags) source->file->flags |= FLAG_IDL_HEADER | FLAG_INSTALL;
-            if (find_include_file( make, strmake( "%s.h", obj ))) source->file->flags |= FLAG_IDL_HEADER;
+            /* don't modify the file flags, other makefiles may use the same file */
+            if (!flags) flags |= FLAG_IDL_HEADER | FLAG_INSTALL;
+            if (find_include_file( make, strmake( "%s.h", obj ))) flags |= FLAG_IDL_HEADER;
 
             for (i = 0; i < sizeof(idl_outputs) / sizeof(idl_outputs[0]); i++)
             {
-                if (!(source->file->flags & idl_outputs[i].flag)) continue;
+                if (!(flags & idl_outputs[i].flag)) continue;
                 dest = strmake( "%s%s", obj, idl_outputs[i].ext );
                 if (!find_src_file( make, dest )) strarray_add( &clean_files, dest );
                 strarray_add( &targets, dest );
             }
-            if (source->file->flags & FLAG_IDL_PROXY) strarray_add( &dlldata_files, source->name );
-            if (source->file->flags & FLAG_INSTALL)
+            if (flags & FLAG_IDL_PROXY) strarray_add( &dlldata_files, source->name );
+            if (flags & FLAG_INSTALL)
             {
                 strarray_add( &install_rules[INSTALL_DEV], xstrdup( source->name ));
                 strarray_add( &install_rules[INSTALL_DEV],
                               strmake( "D$(includedir)/%s.idl", get_include_install_path( obj ) ));
-                if (source->file->flags & FLAG_IDL_HEADER)
+                if (flags & FLAG_IDL_HEADER)
                 {
                     strarray_add( &install_rules[INSTALL_DEV], strmake( "%s.h", obj ));
                     strarray_add( &install_rules[INSTALL_DEV],
@@ -3129,6 +3168,7 @@ static struct strarray output_sources( const struct makefile *make )
         struct strarray distclean_files = get_expanded_make_var_array( make, "CONFIGURE_TARGETS" );
 
         strarray_add( &distclean_files, obj_dir_path( make, output_makefile_name ));
+        if (!make->base_dir) strarray_add( &distclean_files, obj_dir_path( make, cache_file_name ));
         if (!make->src_dir) strarray_add( &distclean_files, obj_dir_path( make, ".gitignore" ));
         for (i = 0; i < make->subdirs.count; i++)
         {
@@ -3408,6 +3448,7 @@ static void output_dependencies( const struct makefile *make )
 
     strarray_add( &ignore_files, ".gitignore" );
     strarray_add( &ignore_files, "Makefile" );
+    if (!make->base_dir) strarray_add( &ignore_files, cache_file_name );
     if (make->testdll)
     {
         output_testlist( make );
@@ -3534,6 +3575,190 @@ static void load_sources( struct makefile *make )
 }
 
 
+/*******************************************************************
+ *         get_cache_header
+ *
+ * The cache is invalidated when makedep itself is modified.
+ */
+static char *get_cache_header(void)
+{
+    struct stat st;
+
+    if (stat( root_dir_path( "tools/makedep.c" ), &st ) == -1) st.st_mtime = 0;
+    return strmake( "makedep cache %u %lu", CACHE_VERSION, (unsigned long)st.st_mtime );
+}
+
+
+/*******************************************************************
+ *         load_cache
+ *
+ * Load the dependencies of the files parsed by a previous run.
+ */
+static void load_cache(void)
+{
+    struct file *file = NULL;
+    char *buffer, *p;
+    unsigned int i;
+    FILE *f;
+
+    if (!(f = fopen( cache_file_name, "r" ))) return;
+
+    input_file_name = cache_file_name;
+    input_line = 0;
+    if (!(buffer = get_line( f )) || strcmp( buffer, get_cache_header() )) goto done;
+
+    while ((buffer = get_line( f )))
+    {
+        if (!strncmp( buffer, "file ", 5 ))
+        {
+            off_t size = strtoul( buffer + 5, &p, 10 );
+            time_t mtime = strtoul( p, &p, 10 );
+            unsigned int flags = strtoul( p, &p, 10 );
+
+            if (*p++ != ' ' || !*p) break;
+            file = add_file( p );
+            file->size = size;
+            file->mtime = mtime;
+            file->flags = flags;
+            list_add_tail( &cached_files[hash_filename( file->name )], &file->entry );
+        }
+        else if (!strncmp( buffer, "dep ", 4 ) && file)
+        {
+            int line = strtol( buffer + 4, &p, 10 );
+            enum incl_type type = strtoul( p, &p, 10 );
+            int cur_line = input_line;
+
+            if (*p++ != ' ' || !*p) break;
+            input_line = line;
+            add_dependency( file, p, type );
+            input_line = cur_line;
+        }
+        else if (!strncmp( buffer, "arg ", 4 ) && file)
+        {
+            if (strendswith( file->name, ".sfd" ))
+            {
+                struct strarray *array = file->args;
+
+                if (!array)
+                {
+                    file->args = array = xmalloc( sizeof(*array) );
+                    *array = empty_strarray;
+                }
+                strarray_add( array, xstrdup( buffer + 4 ));
+            }
+            else file->args = xstrdup( buffer + 4 );
+        }
+        else break;
+    }
+
+    if (buffer)  /* invalid cache, ignore it */
+    {
+        fprintf( stderr, "%s:%d: warning: invalid cache entry, ignoring the cache\n",
+                 cache_file_name, input_line );
+        for (i = 0; i < HASH_SIZE; i++) list_init( &cached_files[i] );
+    }
+
+done:
+    fclose( f );
+    input_file_name = NULL;
+}
+
+
+/*******************************************************************
+ *         save_cache_entry
+ */
+static void save_cache_entry( FILE *f, const struct file *file )
+{
+    unsigned int i;
+
+    fprintf( f, "file %lu %lu %u %s\n", (unsigned long)file->size,
+             (unsigned long)file->mtime, file->flags, file->name );
+    for (i = 0; i < file->deps_count; i++)
+        fprintf( f, "dep %d %u %s\n", file->deps[i].line, file->deps[i].type, file->deps[i].name );
+    if (!file->args) return;
+    if (strendswith( file->name, ".sfd" ))
+    {
+        const struct strarray *array = file->args;
+        for (i = 0; i < array->count; i++) fprintf( f, "arg %s\n", array->str[i] );
+    }
+    else fprintf( f, "arg %s\n", (const char *)file->args );
+}
+
+
+/*******************************************************************
+ *         save_cache
+ *
+ * Save the dependencies of all the parsed files, and keep the cached ones
+ * that were not needed in this run. Files modified since makedep was started
+ * are not saved, since they may have changed after being parsed without
+ * their modification time changing.
+ */
+static void save_cache(void)
+{
+    struct file *file;
+    unsigned int i;
+    FILE *f;
+
+    f = create_temp_file( cache_file_name );
+    fprintf( f, "%s\n", get_cache_header() );
+    for (i = 0; i < HASH_SIZE; i++)
+    {
+        LIST_FOR_EACH_ENTRY( file, &files[i], struct file, entry )
+            if (file->mtime && file->mtime < start_time) save_cache_entry( f, file );
+        LIST_FOR_EACH_ENTRY( file, &cached_files[i], struct file, entry )
+            save_cache_entry( f, file );
+    }
+    if (fclose( f )) fatal_perror( "write" );
+    rename_temp_file( cache_file_name );
+}
+
+
+/*******************************************************************
+ *         output_subdirs
+ *
+ * Output the makefiles of all the subdirectories, split between the worker
+ * processes. Each makefile is written by a single process, so the output
+ * doesn't depend on the number of workers.
+ */
+static void output_subdirs( const struct makefile *make )
+{
+    unsigned int i, worker, workers = 1;
+#if defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H)
+    pid_t *pids;
+    int status, failed = 0;
+
+    workers = jobs < make->subdirs.count ? jobs : make->subdirs.count;
+    if (workers <= 1)
+#endif
+    {
+        for (i = 0; i < make->subdirs.count; i++) output_dependencies( make->submakes[i] );
+        return;
+    }
+
+#if defined(HAVE_FORK) && defined(HAVE_SYS_WAIT_H)
+    pids = xmalloc( workers * sizeof(*pids) );
+    fflush( stdout );
+    fflush( stderr );
+    for (worker = 1; worker < workers; worker++)
+    {
+        if ((pids[worker] = fork()) == -1) fatal_perror( "fork" );
+        if (pids[worker]) continue;
+        for (i = worker; i < make->subdirs.count; i += workers) output_dependencies( make->submakes[i] );
+        exit( 0 );
+    }
+    for (i = 0; i < make->subdirs.count; i += workers) output_dependencies( make->submakes[i] );
+
+    for (worker = 1; worker < workers; worker++)
+    {
+        if (waitpid( pids[worker], &status, 0 ) == -1) fatal_perror( "waitpid" );
+        if (!WIFEXITED( status ) || WEXITSTATUS( status )) failed = 1;
+    }
+    free( pids );
+    if (failed) exit( 1 );  /* the worker already printed the error */
+#endif
+}
+
+
 /*******************************************************************
  *         parse_makeflags
  */
@@ -3575,6 +3800,9 @@ static int parse_option( const char *opt )
     case 'R':
         relative_dir_mode = 1;
         break;
+    case 'j':
+        if (atoi( opt + 2 ) > 0) jobs = atoi( opt + 2 );
+        break;
     default:
         fprintf( stderr, "Unknown option '%s'\n%s", opt, Usage );
         exit(1);
@@ -3591,6 +3819,10 @@ int main( int argc, char *argv[] )
     const char *makeflags = getenv( "MAKEFLAGS" );
     int i, j;
 
+    start_time = time( NULL );
+#ifdef _SC_NPROCESSORS_ONLN
+    if (sysconf( _SC_NPROCESSORS_ONLN ) > 1) jobs = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
     if (makeflags) parse_makeflags( makeflags );
 
     i = 1;
@@ -3626,6 +3858,7 @@ int main( int argc, char *argv[] )
 #endif
 
     for (i = 0; i < HASH_SIZE; i++) list_init( &files[i] );
+    for (i = 0; i < HASH_SIZE; i++) list_init( &cached_files[i] );
 
     top_makefile = parse_makefile( NULL );
 
@@ -3658,6 +3891,8 @@ int main( int argc, char *argv[] )
     if (!tools_ext) tools_ext = "";
     if (!man_ext) man_ext = "3w";
 
+    load_cache();
+
     if (argc == 1)
     {
         disabled_dirs = get_expanded_make_var_array( top_makefile, "DISABLED_SUBDIRS" );
@@ -3670,10 +3905,9 @@ int main( int argc, char *argv[] )
         load_sources( top_makefile );
         for (i = 0; i < top_makefile->subdirs.count; i++)
             load_sources( top_makefile->submakes[i] );
+        save_cache();
 
-        for (i = 0; i < top_makefile->subdirs.count; i++)
-            output_dependencies( top_makefile->submakes[i] );
-
+        output_subdirs( top_makefile );
         output_dependencies( top_makefile );
         return 0;
     }
@@ -3684,5 +3918,6 @@ int main( int argc, char *argv[] )
         load_sources( make );
         output_dependencies( make );
     }
+    save_cache();
     return 0;
 }